@@ -0,0 +1,43 @@
+#include "Bench.h"
+
+#include <random>
+
+#include <TlsfAllocator.h>
+
+namespace {
+
+// Frees a random live range and allocates another of random size in its place, with as many
+// ranges live as the argument, so that the free lists are fragmented as in steady state
+void tlsfAllocateFree(bench::State &state) {
+  auto liveCount = static_cast<size_t>(state.getArg());
+
+  std::mt19937                            random(42);
+  std::uniform_int_distribution<uint64_t> sizeDistribution(256, 256 * 1024);
+  std::uniform_int_distribution<size_t>   slotDistribution(0, liveCount - 1);
+
+  // Room for the live ranges at their largest, half of the time
+  TlsfAllocator                      allocator(2 * liveCount * 256 * 1024);
+  std::vector<TlsfAllocator::Handle> handles;
+  for (size_t i = 0; i < liveCount; ++i) {
+    handles.push_back(allocator.allocate(sizeDistribution(random), 256));
+  }
+
+  // Drawn ahead, so that only the allocator is timed
+  std::vector<std::pair<size_t, uint64_t>> operations(4096);
+  for (auto &[slot, size] : operations) {
+    slot = slotDistribution(random);
+    size = sizeDistribution(random);
+  }
+
+  size_t i = 0;
+  for (auto _ : state) {
+    const auto &[slot, size] = operations[i];
+    allocator.free(handles[slot]);
+    handles[slot] = allocator.allocate(size, 256);
+    i             = (i + 1) % operations.size();
+  }
+  bench::doNotOptimize(allocator.getUsedSize());
+}
+BENCHMARK(tlsfAllocateFree, 64, 4096);
+
+} // namespace
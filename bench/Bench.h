@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Minimal microbenchmark harness in the manner of Google Benchmark, without the dependency. A
+// benchmark is a function looping over its state, registered with BENCHMARK, which the runner
+// calls with growing iteration counts until the loop runs long enough to be timed:
+//
+//   void cameraUpdate(bench::State &state) {
+//     for (auto _ : state) {
+//       camera.update(1.0f / 60.0f);
+//     }
+//   }
+//   BENCHMARK(cameraUpdate);
+//
+// The runner reports the time and the heap allocations per iteration.
+namespace bench {
+
+class State {
+public:
+  State(int64_t arg, uint64_t iterationCount) : mArg{arg}, mIterationCount{iterationCount} {}
+
+  // Counts the iterations down for range-based loops, and stops the timing once they are done
+  struct Iterator {
+    State   *state;
+    uint64_t remaining;
+
+    bool operator!=(const Iterator & /* end */) {
+      if (remaining > 0) {
+        return true;
+      }
+      state->pauseTiming();
+      return false;
+    }
+    void operator++() { --remaining; }
+    int  operator*() const { return 0; }
+  };
+
+  // Starts the timing, the setup before the loop being left out
+  Iterator begin();
+  Iterator end() { return {this, 0}; }
+
+  // Leave the work in between out of the timing, e.g. to reset the state of an iteration
+  void pauseTiming();
+  void resumeTiming();
+
+  // The argument the benchmark was registered with, 0 if none
+  [[nodiscard]] int64_t  getArg() const { return mArg; }
+  [[nodiscard]] uint64_t getIterationCount() const { return mIterationCount; }
+  [[nodiscard]] double   getNanoseconds() const { return mNanoseconds; }
+  [[nodiscard]] uint64_t getAllocationCount() const { return mAllocationCount; }
+
+private:
+  int64_t  mArg;
+  uint64_t mIterationCount;
+  bool     mRunning         = false;
+  int64_t  mStartTime       = 0;
+  uint64_t mStartAllocation = 0;
+  double   mNanoseconds     = 0.0;
+  uint64_t mAllocationCount = 0;
+};
+
+using Function = void (*)(State &state);
+
+/**
+ * @brief Registers a benchmark, once per argument
+ * @param name The name of the benchmark
+ * @param function The function looping over its state
+ * @param args The arguments to run it with, e.g. sizes, none to run it once with 0
+ * @returns true, to initialize a static variable with
+ */
+bool registerBenchmark(const char *name, Function function, std::vector<int64_t> args = {});
+
+// Keeps the compiler from optimizing out the computation of a value
+template <typename T> void doNotOptimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static volatile const void *sink;
+  sink = &value;
+#endif
+}
+
+} // namespace bench
+
+// Registers a benchmark function at static initialization, with its arguments if any
+#define BENCHMARK(fn, ...)                                                                         \
+  static bool fn##Registered = bench::registerBenchmark(#fn, fn, {__VA_ARGS__})
@@ -0,0 +1,58 @@
+#include "Bench.h"
+
+#include <FreeCamera.h>
+#include <InputEvent.h>
+#include <OrbitCamera.h>
+
+namespace {
+
+// A frame at 60 Hz
+constexpr float TIME_STEP = 1.0f / 60.0f;
+
+// Makes the view matrix update callable from the benchmark
+class ViewCamera : public Camera {
+public:
+  using Camera::updateViewMatrix;
+
+  void move(float distance) { mPosition.x += distance; }
+};
+
+// Moving forward and turning, as while a key of each is held down
+void freeCameraUpdate(bench::State &state) {
+  FreeCamera camera;
+  camera.setPerspective(60.0f, 4.0f / 3.0f, 0.5f, 50.0f);
+  camera.handleEvent(KeyInputEvent(KeyCode::W, KeyAction::DOWN));
+  camera.handleEvent(KeyInputEvent(KeyCode::LEFT, KeyAction::DOWN));
+
+  for (auto _ : state) {
+    camera.update(TIME_STEP);
+    bench::doNotOptimize(camera.getViewMatrix());
+  }
+}
+BENCHMARK(freeCameraUpdate);
+
+// Orbiting, as while an arrow key is held down
+void orbitCameraUpdate(bench::State &state) {
+  OrbitCamera camera;
+  camera.setPerspective(60.0f, 4.0f / 3.0f, 0.5f, 50.0f);
+  camera.handleEvent(KeyInputEvent(KeyCode::UP, KeyAction::DOWN));
+
+  for (auto _ : state) {
+    camera.update(TIME_STEP);
+    bench::doNotOptimize(camera.getViewMatrix());
+  }
+}
+BENCHMARK(orbitCameraUpdate);
+
+void cameraUpdateViewMatrix(bench::State &state) {
+  ViewCamera camera;
+
+  for (auto _ : state) {
+    camera.move(1e-6f);
+    camera.updateViewMatrix();
+    bench::doNotOptimize(camera.getViewMatrix());
+  }
+}
+BENCHMARK(cameraUpdateViewMatrix);
+
+} // namespace
@@ -0,0 +1,94 @@
+#include "Bench.h"
+
+#include <memory>
+#include <random>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <FreeCamera.h>
+#include <Frustum.h>
+#include <Scene.h>
+#include <model/Model.h>
+
+namespace {
+
+// A model with bounds only, without any device or buffers
+class BoundsModel : public Model {
+public:
+  BoundsModel() : Model(nullptr) { setBounds(glm::vec3(-0.5f), glm::vec3(0.5f)); }
+};
+
+// Looking down the z axis from the origin, at spheres spread around it
+Frustum createFrustum() {
+  FreeCamera camera(glm::vec3(0.0f));
+  camera.setPerspective(60.0f, 4.0f / 3.0f, 0.5f, 50.0f);
+  return Frustum(camera);
+}
+
+glm::vec3 randomPosition(std::mt19937 &random) {
+  std::uniform_real_distribution<float> distribution(-50.0f, 50.0f);
+  return {distribution(random), distribution(random), distribution(random)};
+}
+
+// As many spheres as the argument, per iteration
+void frustumCullSpheres(bench::State &state) {
+  auto count = static_cast<size_t>(state.getArg());
+
+  std::mt19937         random(42);
+  std::vector<float>   x(count), y(count), z(count), radius(count, 1.0f);
+  std::vector<uint8_t> visible(count);
+  for (size_t i = 0; i < count; ++i) {
+    auto position = randomPosition(random);
+    x[i]          = position.x;
+    y[i]          = position.y;
+    z[i]          = position.z;
+  }
+  auto frustum = createFrustum();
+
+  for (auto _ : state) {
+    bench::doNotOptimize(
+        frustum.cullSpheres(x.data(), y.data(), z.data(), radius.data(), count, visible.data()));
+  }
+}
+BENCHMARK(frustumCullSpheres, 1024, 65536);
+
+// A root with as many models as the argument below it
+Scene::NodeId createScene(Scene &scene, const Model &model, size_t count) {
+  std::mt19937 random(42);
+  auto         root = scene.addNode(Scene::INVALID_NODE, glm::mat4(1.0f));
+  for (size_t i = 0; i < count; ++i) {
+    scene.addNode(root, glm::translate(glm::mat4(1.0f), randomPosition(random)), &model);
+  }
+  scene.update();
+  return root;
+}
+
+void sceneCull(bench::State &state) {
+  BoundsModel model;
+  Scene       scene;
+  createScene(scene, model, static_cast<size_t>(state.getArg()));
+  auto frustum = createFrustum();
+
+  for (auto _ : state) {
+    bench::doNotOptimize(scene.cull(frustum));
+  }
+}
+BENCHMARK(sceneCull, 1024, 65536);
+
+// Moving the root, which dirties every node
+void sceneUpdate(bench::State &state) {
+  BoundsModel model;
+  Scene       scene;
+  auto        root = createScene(scene, model, static_cast<size_t>(state.getArg()));
+
+  float offset = 0.0f;
+  for (auto _ : state) {
+    offset += 1e-3f;
+    scene.setLocalTransform(root, glm::translate(glm::mat4(1.0f), glm::vec3(offset, 0.0f, 0.0f)));
+    scene.update();
+  }
+  bench::doNotOptimize(scene.getWorldTransform(root));
+}
+BENCHMARK(sceneUpdate, 1024, 65536);
+
+} // namespace
@@ -0,0 +1,31 @@
+#include "Bench.h"
+
+#include <filesystem>
+#include <fstream>
+
+#include <FileSystem.h>
+#include <Log.h>
+
+namespace {
+
+// Reads a whole file of the size of the argument, which stays in the page cache
+void fileSystemRead(bench::State &state) {
+  auto size = static_cast<size_t>(state.getArg());
+  auto path = (std::filesystem::temp_directory_path() / fmt::format("shuang_bench_{}.bin", size))
+                  .string();
+  {
+    std::vector<char> data(size, 'x');
+    std::ofstream     file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    file.write(data.data(), static_cast<std::streamsize>(size));
+  }
+
+  for (auto _ : state) {
+    auto data = filesystem::read(path);
+    bench::doNotOptimize(data.data());
+  }
+
+  std::filesystem::remove(path);
+}
+BENCHMARK(fileSystemRead, 4 << 10, 1 << 20, 16 << 20);
+
+} // namespace
@@ -0,0 +1,34 @@
+#include "Bench.h"
+
+#include <Vertex.h>
+#include <model/Cube.h>
+#include <model/Grid.h>
+
+namespace {
+
+// The vectors are reused across iterations, as their capacity would be
+void gridGenerate(bench::State &state) {
+  std::vector<Vertex>   vertices;
+  std::vector<uint32_t> indices;
+
+  for (auto _ : state) {
+    Grid::generate(static_cast<int>(state.getArg()), vertices, indices);
+    bench::doNotOptimize(vertices.data());
+    bench::doNotOptimize(indices.data());
+  }
+}
+BENCHMARK(gridGenerate, 1, 5, 50);
+
+void cubeGenerate(bench::State &state) {
+  std::vector<Vertex>   vertices;
+  std::vector<uint32_t> indices;
+
+  for (auto _ : state) {
+    Cube::generate(vertices, indices);
+    bench::doNotOptimize(vertices.data());
+    bench::doNotOptimize(indices.data());
+  }
+}
+BENCHMARK(cubeGenerate);
+
+} // namespace
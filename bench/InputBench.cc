@@ -0,0 +1,23 @@
+#include "Bench.h"
+
+#include <iterator>
+
+#include <InputEvent.h>
+#include <Window.h>
+
+namespace {
+
+// GLFW key codes, the letters being their ASCII codes: WASD, the arrows and an unhandled key
+constexpr int KEYS[] = {'W', 'A', 'S', 'D', 262, 263, 264, 265, 'Z'};
+
+// Looks up a key per iteration, as done for every key event
+void windowMapKeyCode(bench::State &state) {
+  size_t i = 0;
+  for (auto _ : state) {
+    bench::doNotOptimize(Window::mapKeyCode(KEYS[i]));
+    i = i + 1 < std::size(KEYS) ? i + 1 : 0;
+  }
+}
+BENCHMARK(windowMapKeyCode);
+
+} // namespace
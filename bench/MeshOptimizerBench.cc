@@ -0,0 +1,122 @@
+#include "Bench.h"
+
+#include <algorithm>
+#include <random>
+
+#include <MeshOptimizer.h>
+
+namespace {
+
+// A heightfield of n x n quads as a triangle soup in random order, each triangle having vertices
+// of its own, as exported by tools which don't index meshes
+void generateSoup(uint32_t n, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+  std::vector<uint32_t> corners;
+  for (uint32_t i = 0; i < n; ++i) {
+    for (uint32_t j = 0; j < n; ++j) {
+      auto a = i * (n + 1) + j, b = a + 1, c = a + n + 1, d = c + 1;
+      corners.insert(corners.end(), {a, c, b, b, c, d});
+    }
+  }
+
+  // Shuffle whole triangles
+  std::mt19937          random(42);
+  std::vector<uint32_t> order(corners.size() / 3);
+  for (uint32_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::shuffle(order.begin(), order.end(), random);
+
+  vertices.clear();
+  indices.clear();
+  for (auto triangle : order) {
+    for (uint32_t k = 0; k < 3; ++k) {
+      auto corner = corners[triangle * 3 + k];
+      auto x      = static_cast<float>(corner % (n + 1));
+      auto z      = static_cast<float>(corner / (n + 1));
+      indices.push_back(static_cast<uint32_t>(vertices.size()));
+      vertices.push_back({glm::vec3(x, 0.0f, z), glm::vec3(0.5f)});
+    }
+  }
+}
+
+// Welding a soup of 2 n^2 triangles
+void meshWeldVertices(bench::State &state) {
+  auto                  n = static_cast<uint32_t>(state.getArg());
+  std::vector<Vertex>   soupVertices, vertices;
+  std::vector<uint32_t> soupIndices, indices;
+  generateSoup(n, soupVertices, soupIndices);
+
+  for (auto _ : state) {
+    state.pauseTiming();
+    vertices = soupVertices;
+    indices  = soupIndices;
+    state.resumeTiming();
+    MeshOptimizer::weldVertices(vertices, indices);
+    bench::doNotOptimize(vertices.data());
+  }
+}
+BENCHMARK(meshWeldVertices, 32, 256);
+
+// The vertex cache step alone, over the welded soup
+void meshOptimizeVertexCache(bench::State &state) {
+  auto                  n = static_cast<uint32_t>(state.getArg());
+  std::vector<Vertex>   vertices;
+  std::vector<uint32_t> weldedIndices, indices;
+  generateSoup(n, vertices, weldedIndices);
+  MeshOptimizer::weldVertices(vertices, weldedIndices);
+
+  for (auto _ : state) {
+    state.pauseTiming();
+    indices = weldedIndices;
+    state.resumeTiming();
+    MeshOptimizer::optimizeVertexCache(indices.data(), indices.size());
+    bench::doNotOptimize(indices.data());
+  }
+}
+BENCHMARK(meshOptimizeVertexCache, 32, 256);
+
+// The overdraw step alone, over the welded soup optimized for the vertex cache
+void meshOptimizeOverdraw(bench::State &state) {
+  auto                  n = static_cast<uint32_t>(state.getArg());
+  std::vector<Vertex>   vertices;
+  std::vector<uint32_t> cacheIndices, indices;
+  generateSoup(n, vertices, cacheIndices);
+  MeshOptimizer::weldVertices(vertices, cacheIndices);
+  MeshOptimizer::optimizeVertexCache(cacheIndices.data(), cacheIndices.size());
+
+  for (auto _ : state) {
+    state.pauseTiming();
+    indices = cacheIndices;
+    state.resumeTiming();
+    MeshOptimizer::optimizeOverdraw(indices.data(), indices.size(), vertices);
+    bench::doNotOptimize(indices.data());
+  }
+}
+BENCHMARK(meshOptimizeOverdraw, 32, 256);
+
+// Strips of the welded soup optimized for the vertex cache, as a single range
+void meshGenerateStrips(bench::State &state) {
+  auto                  n = static_cast<uint32_t>(state.getArg());
+  std::vector<Vertex>   vertices;
+  std::vector<uint32_t> cacheIndices, indices;
+  generateSoup(n, vertices, cacheIndices);
+  MeshOptimizer::weldVertices(vertices, cacheIndices);
+  MeshOptimizer::optimizeVertexCache(cacheIndices.data(), cacheIndices.size());
+
+  auto indexCount  = static_cast<uint32_t>(cacheIndices.size());
+  auto vertexCount = static_cast<uint32_t>(vertices.size());
+
+  std::vector<IndexRange> ranges;
+  std::vector<Submesh>    submeshes;
+  for (auto _ : state) {
+    state.pauseTiming();
+    indices = cacheIndices;
+    ranges  = {{0, indexCount, 0, vertexCount}};
+    state.resumeTiming();
+    MeshOptimizer::generateStrips(indices, ranges, submeshes);
+    bench::doNotOptimize(indices.data());
+  }
+}
+BENCHMARK(meshGenerateStrips, 32, 256);
+
+} // namespace
@@ -0,0 +1,66 @@
+#include "Bench.h"
+
+#include <cmath>
+
+#include <MeshSimplifier.h>
+
+namespace {
+
+// An indexed heightfield of n x n quads of rolling hills, which simplifies unevenly, unlike a
+// plane
+void generateHills(uint32_t n, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+  vertices.clear();
+  indices.clear();
+  for (uint32_t i = 0; i <= n; ++i) {
+    for (uint32_t j = 0; j <= n; ++j) {
+      auto x = static_cast<float>(j), z = static_cast<float>(i);
+      auto y = 2.0f * std::sin(x * 0.15f) * std::cos(z * 0.1f);
+      vertices.push_back({glm::vec3(x, y, z), glm::vec3(0.5f)});
+    }
+  }
+  for (uint32_t i = 0; i < n; ++i) {
+    for (uint32_t j = 0; j < n; ++j) {
+      auto a = i * (n + 1) + j, b = a + 1, c = a + n + 1, d = c + 1;
+      indices.insert(indices.end(), {a, c, b, b, c, d});
+    }
+  }
+}
+
+// Simplification of the hills to a quarter of their triangles
+void meshSimplify(bench::State &state) {
+  auto                  n = static_cast<uint32_t>(state.getArg());
+  std::vector<Vertex>   vertices;
+  std::vector<uint32_t> indices;
+  generateHills(n, vertices, indices);
+
+  for (auto _ : state) {
+    auto simplified = MeshSimplifier::simplify(vertices.data(), vertices.size(), indices.data(),
+                                               indices.size(), indices.size() / 12 * 3);
+    bench::doNotOptimize(simplified.data());
+  }
+}
+BENCHMARK(meshSimplify, 32, 256);
+
+// The whole chain of levels of detail of the hills, as a single range
+void meshGenerateLods(bench::State &state) {
+  auto                  n = static_cast<uint32_t>(state.getArg());
+  std::vector<Vertex>   vertices;
+  std::vector<uint32_t> hillIndices, indices;
+  generateHills(n, vertices, hillIndices);
+
+  auto indexCount  = static_cast<uint32_t>(hillIndices.size());
+  auto vertexCount = static_cast<uint32_t>(vertices.size());
+
+  std::vector<IndexRange> ranges;
+  for (auto _ : state) {
+    state.pauseTiming();
+    indices = hillIndices;
+    ranges  = {{0, indexCount, 0, vertexCount}};
+    state.resumeTiming();
+    auto lods = MeshSimplifier::generateLods(vertices, indices, ranges);
+    bench::doNotOptimize(lods.data());
+  }
+}
+BENCHMARK(meshGenerateLods, 32, 256);
+
+} // namespace
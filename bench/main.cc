@@ -0,0 +1,136 @@
+#include "Bench.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <Log.h>
+
+// Shortest time the iterations of a measurement must take, in seconds
+#define BENCH_MIN_TIME 0.5
+// The iteration count grows by up to this factor between attempts
+#define BENCH_MAX_GROWTH 10.0
+
+namespace {
+
+// Heap allocations of all the threads, through the replaced operator new below
+std::atomic<uint64_t> gAllocationCount{0};
+
+int64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct Benchmark {
+  std::string     name;
+  bench::Function function;
+  int64_t         arg;
+  bool            hasArg;
+};
+
+std::vector<Benchmark> &getBenchmarks() {
+  static std::vector<Benchmark> benchmarks;
+  return benchmarks;
+}
+
+// Grows the iteration count until a run lasts the minimum time, the last run being the result
+bench::State measure(const Benchmark &benchmark, double minTime) {
+  uint64_t iterationCount = 1;
+  for (;;) {
+    bench::State state(benchmark.arg, iterationCount);
+    benchmark.function(state);
+
+    auto seconds = state.getNanoseconds() * 1e-9;
+    if (seconds >= minTime || iterationCount >= UINT64_MAX / 16) {
+      return state;
+    }
+    // Aims a bit past the minimum, from the time of this run
+    auto growth    = seconds > 0.0 ? 1.4 * minTime / seconds : BENCH_MAX_GROWTH;
+    iterationCount = static_cast<uint64_t>(
+        static_cast<double>(iterationCount) * std::clamp(growth, 2.0, BENCH_MAX_GROWTH));
+  }
+}
+
+} // namespace
+
+void *operator new(size_t size) {
+  gAllocationCount.fetch_add(1, std::memory_order_relaxed);
+  if (auto *pointer = std::malloc(size ? size : 1)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+
+void operator delete(void *pointer, size_t /* size */) noexcept { std::free(pointer); }
+
+namespace bench {
+
+State::Iterator State::begin() {
+  resumeTiming();
+  return {this, mIterationCount};
+}
+
+void State::pauseTiming() {
+  if (!mRunning) {
+    return;
+  }
+  mNanoseconds += static_cast<double>(now() - mStartTime);
+  mAllocationCount += gAllocationCount.load(std::memory_order_relaxed) - mStartAllocation;
+  mRunning = false;
+}
+
+void State::resumeTiming() {
+  if (mRunning) {
+    return;
+  }
+  mRunning         = true;
+  mStartAllocation = gAllocationCount.load(std::memory_order_relaxed);
+  mStartTime       = now();
+}
+
+bool registerBenchmark(const char *name, Function function, std::vector<int64_t> args) {
+  if (args.empty()) {
+    getBenchmarks().push_back({name, function, 0, false});
+  }
+  for (auto arg : args) {
+    getBenchmarks().push_back({name, function, arg, true});
+  }
+  return true;
+}
+
+} // namespace bench
+
+int main(int argc, char **argv) {
+  // Usage: shuang_bench [--filter <name substring>] [--min-time <seconds>]
+  std::string filter;
+  double      minTime = BENCH_MIN_TIME;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+      minTime = std::stod(argv[++i]);
+    }
+  }
+  spdlog::set_pattern("%v");
+
+  log_info("{:<40} {:>14} {:>14} {:>12}", "benchmark", "ns/op", "allocs/op", "iterations");
+  for (const auto &benchmark : getBenchmarks()) {
+    auto name = benchmark.hasArg ? fmt::format("{}/{}", benchmark.name, benchmark.arg)
+                                 : benchmark.name;
+    if (name.find(filter) == std::string::npos) {
+      continue;
+    }
+
+    auto state      = measure(benchmark, minTime);
+    auto iterations = static_cast<double>(state.getIterationCount());
+    log_info("{:<40} {:>14.2f} {:>14.2f} {:>12}", name, state.getNanoseconds() / iterations,
+             static_cast<double>(state.getAllocationCount()) / iterations,
+             state.getIterationCount());
+  }
+}
@@ -0,0 +1,365 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Application.h>
+#include <Camera.h>
+#include <Log.h>
+
+namespace {
+
+double getMilliseconds(std::chrono::steady_clock::time_point startTime) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime)
+      .count();
+}
+
+// Circles around the origin at a fixed pace, rising and sinking twice per turn, so that runs with
+// the same time step see the same frames
+class PathCamera : public Camera {
+public:
+  explicit PathCamera(float radius) : mRadius{radius} { update(0.0f); }
+
+  void update(float timeStep) override {
+    mTime += timeStep;
+
+    auto angle  = glm::radians(360.0f) * mTime / PATH_PERIOD;
+    auto height = 0.5f * mRadius * (1.0f + 0.5f * std::sin(2.0f * angle));
+    mPosition   = glm::vec3(mRadius * std::cos(angle), height, mRadius * std::sin(angle));
+
+    // Looking at the origin, as the orbit camera does
+    auto forward = glm::normalize(-mPosition);
+    auto up      = glm::vec3(0.0f, -1.0f, 0.0f);
+    auto right   = glm::cross(forward, up);
+    up           = glm::cross(right, forward);
+    mRotation    = glm::quatLookAt(forward, up);
+    updateViewMatrix();
+  }
+
+private:
+  // Seconds per turn
+  static constexpr float PATH_PERIOD = 10.0f;
+
+  float mRadius;
+  float mTime = 0.0f;
+};
+
+struct Summary {
+  double mean = 0.0;
+  double p50  = 0.0;
+  double p95  = 0.0;
+  double p99  = 0.0;
+  double max  = 0.0;
+};
+
+// Nearest-rank percentiles
+Summary summarize(std::vector<double> values) {
+  Summary summary;
+  if (values.empty()) {
+    return summary;
+  }
+  std::sort(values.begin(), values.end());
+  auto percentile = [&](double p) {
+    auto rank = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(values.size())));
+    return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+  };
+  for (auto value : values) {
+    summary.mean += value;
+  }
+  summary.mean /= static_cast<double>(values.size());
+  summary.p50 = percentile(50.0);
+  summary.p95 = percentile(95.0);
+  summary.p99 = percentile(99.0);
+  summary.max = values.back();
+  return summary;
+}
+
+std::string toJson(const Summary &summary) {
+  return fmt::format(R"({{"mean": {:.4f}, "p50": {:.4f}, "p95": {:.4f}, "p99": {:.4f}, )"
+                     R"("max": {:.4f}}})",
+                     summary.mean, summary.p50, summary.p95, summary.p99, summary.max);
+}
+
+// Reads the objects of numbers the benchmark writes, flattened into "object.key" entries. Strings
+// are skipped.
+class JsonReader {
+public:
+  explicit JsonReader(std::string text) : mText{std::move(text)} {}
+
+  std::map<std::string, double> read() {
+    std::map<std::string, double> values;
+    readValue("", values);
+    return values;
+  }
+
+private:
+  void readValue(const std::string &key, std::map<std::string, double> &values) {
+    skipSpaces();
+    if (peek() == '{') {
+      ++mPosition;
+      skipSpaces();
+      while (peek() != '}') {
+        auto name = readString();
+        skipSpaces();
+        expect(':');
+        readValue(key.empty() ? name : key + "." + name, values);
+        skipSpaces();
+        if (peek() == ',') {
+          ++mPosition;
+          skipSpaces();
+        }
+      }
+      ++mPosition;
+    } else if (peek() == '"') {
+      readString();
+    } else {
+      size_t length = 0;
+      values[key]   = std::stod(mText.substr(mPosition), &length);
+      mPosition += length;
+    }
+  }
+
+  std::string readString() {
+    expect('"');
+    auto end = mText.find('"', mPosition);
+    if (end == std::string::npos) {
+      throw std::runtime_error("Unterminated string in benchmark results");
+    }
+    auto string = mText.substr(mPosition, end - mPosition);
+    mPosition   = end + 1;
+    return string;
+  }
+
+  void expect(char c) {
+    if (peek() != c) {
+      throw std::runtime_error(
+          fmt::format("Expected '{}' at offset {} of benchmark results", c, mPosition));
+    }
+    ++mPosition;
+  }
+
+  void skipSpaces() {
+    while (mPosition < mText.size() && std::isspace(static_cast<unsigned char>(mText[mPosition]))) {
+      ++mPosition;
+    }
+  }
+
+  [[nodiscard]] char peek() const { return mPosition < mText.size() ? mText[mPosition] : '\0'; }
+
+  std::string mText;
+  size_t      mPosition = 0;
+};
+
+std::map<std::string, double> readResults(const std::string &path) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open file: " + path);
+  }
+  std::stringstream text;
+  text << file.rdbuf();
+  return JsonReader(text.str()).read();
+}
+
+/**
+ * @brief Logs the metrics of two runs side by side
+ * @param baselinePath The results of the reference run
+ * @param path The results of the run to check
+ * @param threshold The percentage by which a time or a memory size may grow
+ * @returns The number of metrics which grew by more than the threshold
+ */
+int compare(const std::string &baselinePath, const std::string &path, double threshold) {
+  auto baseline = readResults(baselinePath);
+  auto results  = readResults(path);
+
+  int regressionCount = 0;
+  log_info("{:<32} {:>14} {:>14} {:>9}", "metric", "baseline", "current", "change");
+  for (const auto &[key, baselineValue] : baseline) {
+    auto iter = results.find(key);
+    if (iter == results.end()) {
+      log_warn("{:<32} missing from {}", key, path);
+      continue;
+    }
+
+    auto value  = iter->second;
+    auto change = baselineValue != 0.0 ? (value - baselineValue) / baselineValue * 100.0
+                                       : (value != 0.0 ? 100.0 : 0.0);
+    // Times and memory are better lower, the other metrics describe the workload
+    auto measured = key.rfind("frame_ms.", 0) == 0 || key.rfind("cpu_ms.", 0) == 0 ||
+                    key.rfind("gpu_ms.", 0) == 0 || key.rfind("memory.", 0) == 0;
+    if (measured && change > threshold) {
+      ++regressionCount;
+      log_error("{:<32} {:>14.4f} {:>14.4f} {:>+8.2f}% regression", key, baselineValue, value,
+                change);
+    } else if (!measured && value != baselineValue) {
+      log_warn("{:<32} {:>14.4f} {:>14.4f} {:>+8.2f}% different workload", key, baselineValue,
+               value, change);
+    } else {
+      log_info("{:<32} {:>14.4f} {:>14.4f} {:>+8.2f}%", key, baselineValue, value, change);
+    }
+  }
+
+  if (regressionCount > 0) {
+    log_error("{} regressions above {:.1f}%", regressionCount, threshold);
+  }
+  return regressionCount;
+}
+
+} // namespace
+
+// Renders headless along the camera path with a fixed time step, timing each frame once warmed up
+class Benchmark : public Application {
+public:
+  Benchmark(const Setting &setting, uint32_t warmupFrameCount, float pathRadius)
+      : Application(setting), mWarmupFrameCount{warmupFrameCount}, mPathRadius{pathRadius} {
+    mTitle = "Benchmark";
+  }
+
+  void run() {
+    setup(false);
+    auto camera = std::make_shared<PathCamera>(mPathRadius);
+    camera->setPerspective(60.0f, (float)mWidth / (float)mHeight, 0.5f, 50.0f);
+    setCamera(camera);
+    mainLoop();
+  }
+
+  void writeResults(const std::string &path) {
+    auto memory = getDevice()->getMemoryAllocator().getStatistics();
+
+    double visibleCount = 0.0;
+    double drawCount    = 0.0;
+    for (size_t i = 0; i < mVisibleCounts.size(); ++i) {
+      visibleCount += mVisibleCounts[i];
+      drawCount += mDrawCounts[i];
+    }
+    auto frameCount = std::max<size_t>(mVisibleCounts.size(), 1);
+    // Kept a plain JSON string, Windows paths with forward slashes work as well
+    auto modelPath = mSetting.modelPath;
+    std::replace(modelPath.begin(), modelPath.end(), '\\', '/');
+
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file.is_open()) {
+      throw std::runtime_error("Failed to open file: " + path);
+    }
+    file << "{\n"
+         << fmt::format(R"(  "model": "{}",)", modelPath) << '\n'
+         << fmt::format(R"(  "frames": {},)", mFrameMilliseconds.size()) << '\n'
+         << fmt::format(R"(  "time_step": {:.6f},)", mSetting.fixedTimeStep) << '\n'
+         << R"(  "frame_ms": )" << toJson(summarize(mFrameMilliseconds)) << ",\n"
+         << R"(  "cpu_ms": )" << toJson(summarize(mCpuMilliseconds)) << ",\n"
+         << R"(  "gpu_ms": )" << toJson(summarize(mGpuMilliseconds)) << ",\n"
+         << fmt::format(R"(  "draws": {{"visible_models": {:.2f}, "draw_calls": {:.2f}}},)",
+                        visibleCount / frameCount, drawCount / frameCount)
+         << '\n'
+         << fmt::format(R"(  "memory": {{"block_bytes": {}, "allocation_bytes": {}, )"
+                        R"("allocation_count": {}}})",
+                        memory.blockBytes, memory.allocationBytes, memory.allocationCount)
+         << "\n}\n";
+    file.close();
+    if (file.fail()) {
+      throw std::runtime_error("Failed to write file: " + path);
+    }
+
+    auto frame = summarize(mFrameMilliseconds);
+    log_info("{} frames: p50 {:.4f} ms, p95 {:.4f} ms, p99 {:.4f} ms, written to {}",
+             mFrameMilliseconds.size(), frame.p50, frame.p95, frame.p99, path);
+  }
+
+protected:
+  void update(float timeStep) override {
+    auto startTime = std::chrono::steady_clock::now();
+    Application::update(timeStep);
+    auto milliseconds = getMilliseconds(startTime);
+
+    if (++mFrameNumber <= mWarmupFrameCount) {
+      return;
+    }
+    mFrameMilliseconds.push_back(milliseconds);
+    // The rest of the frame is the CPU waiting for the GPU to be done with a frame in flight
+    mCpuMilliseconds.push_back(milliseconds - getFrameScheduler().getWaitMilliseconds());
+    if (const auto *gpuProfiler = getGpuProfiler()) {
+      mGpuMilliseconds.push_back(gpuProfiler->getFrameMilliseconds());
+    }
+    mVisibleCounts.push_back(mCullStatistics.visibleCount);
+    mDrawCounts.push_back(static_cast<uint32_t>(getDrawCount()));
+  }
+
+private:
+  uint32_t              mWarmupFrameCount;
+  float                 mPathRadius;
+  uint32_t              mFrameNumber = 0;
+  std::vector<double>   mFrameMilliseconds;
+  std::vector<double>   mCpuMilliseconds;
+  std::vector<double>   mGpuMilliseconds;
+  std::vector<uint32_t> mVisibleCounts;
+  std::vector<uint32_t> mDrawCounts;
+};
+
+int main(int argc, char **argv) {
+  // Usage: benchmark [--frames <count>] [--warmup <count>] [--model <obj, gltf or mesh path>]
+  //                  [--instances <grid size>] [--gpu-driven] [--packed] [--optimize] [--strips]
+  //                  [--lods] [--radius <camera path radius>] [--output <json path>]
+  //        benchmark --compare <baseline json path> <json path> [--threshold <percent>]
+  Application::Setting setting{};
+  setting.headless      = true;
+  setting.gpuProfiling  = true;
+  setting.fixedTimeStep = 1.0f / 60.0f;
+
+  uint32_t    frameCount       = 1000;
+  uint32_t    warmupFrameCount = 100;
+  float       pathRadius       = 6.0f;
+  std::string outputPath       = "benchmark.json";
+  std::string baselinePath;
+  std::string comparedPath;
+  double      threshold = 5.0;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      frameCount = std::stoul(argv[++i]);
+    } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+      warmupFrameCount = std::stoul(argv[++i]);
+    } else if (strcmp(argv[i], "--model") == 0 && i + 1 < argc) {
+      setting.modelPath = argv[++i];
+    } else if (strcmp(argv[i], "--instances") == 0 && i + 1 < argc) {
+      setting.instanceGridSize = std::stoul(argv[++i]);
+    } else if (strcmp(argv[i], "--gpu-driven") == 0) {
+      setting.gpuDriven = true;
+    } else if (strcmp(argv[i], "--packed") == 0) {
+      setting.packedVertices = true;
+    } else if (strcmp(argv[i], "--optimize") == 0) {
+      setting.optimizeMeshes = true;
+    } else if (strcmp(argv[i], "--strips") == 0) {
+      setting.triangleStrips = true;
+    } else if (strcmp(argv[i], "--lods") == 0) {
+      setting.generateLods = true;
+    } else if (strcmp(argv[i], "--radius") == 0 && i + 1 < argc) {
+      pathRadius = std::stof(argv[++i]);
+    } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+      outputPath = argv[++i];
+    } else if (strcmp(argv[i], "--compare") == 0 && i + 2 < argc) {
+      baselinePath = argv[++i];
+      comparedPath = argv[++i];
+    } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+      threshold = std::stod(argv[++i]);
+    }
+  }
+
+  try {
+    if (!baselinePath.empty()) {
+      return compare(baselinePath, comparedPath, threshold) > 0 ? 1 : 0;
+    }
+
+    setting.frameCount = warmupFrameCount + frameCount;
+    auto benchmark     = std::make_unique<Benchmark>(setting, warmupFrameCount, pathRadius);
+    benchmark->run();
+    benchmark->writeResults(outputPath);
+  } catch (const std::exception &e) {
+    log_error("exception caught: {}", e.what());
+    return 1;
+  }
+}
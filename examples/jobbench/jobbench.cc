@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <JobSystem.h>
+#include <Log.h>
+
+namespace {
+
+double getMilliseconds(std::chrono::steady_clock::time_point startTime) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime)
+      .count();
+}
+
+// Queues empty jobs from the main thread and waits for them, the cost being pure scheduling
+double measureJobOverhead(JobSystem &jobSystem, uint32_t jobCount) {
+  auto startTime = std::chrono::steady_clock::now();
+
+  JobSystem::Counter counter;
+  for (uint32_t i = 0; i < jobCount; ++i) {
+    jobSystem.run([]() {}, &counter);
+  }
+  jobSystem.wait(counter);
+
+  return getMilliseconds(startTime) * 1e6 / jobCount;
+}
+
+// Spreads a compute bound loop over the threads with parallelFor
+double measureParallelFor(JobSystem &jobSystem, size_t itemCount, size_t grainSize) {
+  std::vector<double> sums((itemCount + grainSize - 1) / grainSize);
+
+  auto startTime = std::chrono::steady_clock::now();
+  jobSystem.parallelFor(itemCount, grainSize, [&](size_t begin, size_t end) {
+    double sum = 0.0;
+    for (auto i = begin; i < end; ++i) {
+      sum += std::sqrt(static_cast<double>(i)) * std::sin(static_cast<double>(i));
+    }
+    sums[begin / grainSize] = sum;
+  });
+  auto milliseconds = getMilliseconds(startTime);
+
+  // Keeps the loop from being optimized out
+  double total = 0.0;
+  for (auto sum : sums) {
+    total += sum;
+  }
+  log_debug("parallelFor checksum {}", total);
+  return milliseconds;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  // Usage: jobbench [--threads <max thread count>]
+  auto maxThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      maxThreadCount = std::stoul(argv[++i]);
+    }
+  }
+
+  const uint32_t jobCount  = 1 << 20;
+  const size_t   itemCount = size_t{1} << 26;
+  const size_t   grainSize = 1 << 14;
+
+  // Thread counts doubling up to the maximum, which is measured too
+  std::vector<uint32_t> threadCounts;
+  for (uint32_t threadCount = 1; threadCount < maxThreadCount; threadCount *= 2) {
+    threadCounts.push_back(threadCount);
+  }
+  threadCounts.push_back(maxThreadCount);
+
+  double baseMilliseconds = 0.0;
+  log_info("threads  ns/job  parallelFor ms  speedup");
+  for (auto threadCount : threadCounts) {
+    JobSystem jobSystem(threadCount - 1);
+
+    // Warm up the workers and the allocator first
+    measureJobOverhead(jobSystem, jobCount / 16);
+    auto nanosecondsPerJob = measureJobOverhead(jobSystem, jobCount);
+    auto milliseconds      = measureParallelFor(jobSystem, itemCount, grainSize);
+    if (threadCount == 1) {
+      baseMilliseconds = milliseconds;
+    }
+
+    log_info("{:7}  {:6.1f}  {:14.2f}  {:7.2f}", threadCount, nanosecondsPerJob, milliseconds,
+             baseMilliseconds / milliseconds);
+  }
+}
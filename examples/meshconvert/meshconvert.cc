@@ -0,0 +1,41 @@
+#include <Log.h>
+#include <MeshImporter.h>
+
+#include <cstring>
+
+int main(int argc, char **argv) {
+  // Usage: meshconvert [--packed] [--optimize] [--strips] [--lods] <obj or gltf path> <mesh path>
+  auto vertexFormat = VertexFormat::FLOAT;
+  auto optimize     = false;
+  auto strips       = false;
+  auto lods         = false;
+  for (; argc > 3 && argv[1][0] == '-'; ++argv, --argc) {
+    if (strcmp(argv[1], "--packed") == 0) {
+      // Quantized positions and colors, half the size of float vertices
+      vertexFormat = VertexFormat::PACKED;
+    } else if (strcmp(argv[1], "--optimize") == 0) {
+      // Welded and reordered for the vertex cache, overdraw and vertex fetch
+      optimize = true;
+    } else if (strcmp(argv[1], "--strips") == 0) {
+      // Triangle strips separated by primitive restarts, fewer indices than triangle lists
+      strips = true;
+    } else if (strcmp(argv[1], "--lods") == 0) {
+      // A chain of simplified levels of detail, drawn depending on the size on screen
+      lods = true;
+    } else {
+      break;
+    }
+  }
+  if (argc != 3) {
+    log_error("Usage: meshconvert [--packed] [--optimize] [--strips] [--lods] <obj or gltf path> "
+              "<mesh path>");
+    return 1;
+  }
+
+  try {
+    MeshImporter::convert(argv[1], argv[2], vertexFormat, optimize, strips, lods);
+  } catch (const std::exception &e) {
+    log_error("exception caught: {}", e.what());
+    return 1;
+  }
+}
@@ -1,10 +1,11 @@
+#include <cstring>
 #include <memory>
 
 #include <Application.h>
 
 class Example : public Application {
 public:
-  Example() : Application() {
+  explicit Example(const Setting &setting) : Application(setting) {
     mTitle = "Example: Basic triangle";
 
     // Values not set here are initialized in the base class constructor
@@ -13,9 +14,40 @@ public:
   ~Example() override { log_debug(__func__); }
 };
 
-int main() {
+int main(int argc, char **argv) {
+  // Usage: triangle [--headless [frame count]] [--model <obj, gltf or mesh path>]
+  //                 [--instances <grid size>] [--gpu-driven] [--packed] [--optimize] [--strips]
+  //                 [--lods] [--gpu-profiling] [--trace <Chrome trace path>]
+  Application::Setting setting{};
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--headless") == 0) {
+      setting.headless = true;
+      if (i + 1 < argc && argv[i + 1][0] != '-') {
+        setting.frameCount = std::stoul(argv[++i]);
+      }
+    } else if (strcmp(argv[i], "--model") == 0 && i + 1 < argc) {
+      setting.modelPath = argv[++i];
+    } else if (strcmp(argv[i], "--instances") == 0 && i + 1 < argc) {
+      setting.instanceGridSize = std::stoul(argv[++i]);
+    } else if (strcmp(argv[i], "--gpu-driven") == 0) {
+      setting.gpuDriven = true;
+    } else if (strcmp(argv[i], "--packed") == 0) {
+      setting.packedVertices = true;
+    } else if (strcmp(argv[i], "--optimize") == 0) {
+      setting.optimizeMeshes = true;
+    } else if (strcmp(argv[i], "--strips") == 0) {
+      setting.triangleStrips = true;
+    } else if (strcmp(argv[i], "--lods") == 0) {
+      setting.generateLods = true;
+    } else if (strcmp(argv[i], "--gpu-profiling") == 0) {
+      setting.gpuProfiling = true;
+    } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      setting.tracePath = argv[++i];
+    }
+  }
+
   try {
-    auto example = std::make_unique<Example>();
+    auto example = std::make_unique<Example>(setting);
     example->setup();
     example->mainLoop();
   } catch (const std::exception &e) {
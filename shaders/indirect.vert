@@ -0,0 +1,36 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform vs_ubo_t {
+    mat4 view;
+    mat4 proj;
+} vs_ubo;
+
+struct Object {
+    mat4 transform;
+    vec4 color;
+    uint drawIndex;
+    uint lod;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer Objects {
+    Object objects[];
+};
+
+// Maps the positions of the vertex buffer back to model space, the identity unless quantized
+layout(push_constant) uniform Dequantization {
+    vec4 offset;
+    vec4 scale;
+} dequantization;
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+    vec3 modelPosition = position * dequantization.scale.xyz + dequantization.offset.xyz;
+    // The first instance of each indirect command is the index of its object
+    Object object = objects[gl_InstanceIndex];
+    gl_Position = vs_ubo.proj * vs_ubo.view * object.transform * vec4(modelPosition, 1.0);
+    fragColor = color * object.color.rgb;
+}
@@ -0,0 +1,29 @@
+#version 450
+
+layout(binding = 0) uniform vs_ubo_t {
+    mat4 view;
+    mat4 proj;
+} vs_ubo;
+
+// Maps the positions of the vertex buffer back to model space, the identity unless quantized, and
+// the model matrix of the draw
+layout(push_constant) uniform DrawConstants {
+    vec4 offset;
+    vec4 scale;
+    mat4 model;
+} draw;
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+
+// Per instance, relative to the model matrix
+layout(location = 2) in mat4 instanceTransform;
+layout(location = 6) in vec4 instanceColor;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+    vec3 modelPosition = position * draw.scale.xyz + draw.offset.xyz;
+    gl_Position = vs_ubo.proj * vs_ubo.view * draw.model * instanceTransform * vec4(modelPosition, 1.0);
+    fragColor = color * instanceColor.rgb;
+}
@@ -4,6 +4,25 @@ layout(location = 0) in vec3 fragColor;
 
 layout(location = 0) out vec4 outColor;
 
+// Cross-fade between two levels of detail, after the constants of the vertex shaders: the
+// level fading in keeps the pixels whose threshold is under the fade, and the level fading out,
+// drawn with the fade minus 1, the others. A fade of 1 keeps every pixel.
+layout(push_constant) uniform LodFade {
+    layout(offset = 96) float fade;
+} lodFade;
+
+// Thresholds of a 4x4 ordered dither, in (0, 1)
+const float DITHER[16] = float[](
+    0.5, 8.5, 2.5, 10.5,
+    12.5, 4.5, 14.5, 6.5,
+    3.5, 11.5, 1.5, 9.5,
+    15.5, 7.5, 13.5, 5.5);
+
 void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy) & 3;
+    float threshold = DITHER[pixel.y * 4 + pixel.x] / 16.0;
+    if (lodFade.fade >= 0.0 ? threshold >= lodFade.fade : threshold < lodFade.fade + 1.0) {
+        discard;
+    }
     outColor = vec4(fragColor, 1.0);
 }
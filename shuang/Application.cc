@@ -1,10 +1,14 @@
 #include "Application.h"
-#include "FileSystem.h"
 #include "FreeCamera.h"
+#include "Frustum.h"
 #include "Initializer.h"
+#include "JobSystem.h"
 #include "Macros.h"
+#include "MeshImporter.h"
 #include "OrbitCamera.h"
-#include "Vertex.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include "VertexLayout.h"
 #include "model/Cube.h"
 #include "model/Grid.h"
 #include "model/Triangle.h"
@@ -12,20 +16,35 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <array>
+
+// The camera, written once per frame and bound once per command buffer, the model matrices being
+// pushed along with the draws
 struct alignas(16) vs_ubo_t {
-  glm::mat4 model;
   glm::mat4 view;
   glm::mat4 proj;
 };
 
-Application::Application(const Setting &setting) { spdlog::set_level(spdlog::level::debug); }
+// Room for the uniforms of a frame
+#define UNIFORM_RING_FRAME_SIZE (64 * 1024)
+// Fewest draws worth a recording thread of their own
+#define DRAWS_PER_RECORDING_THREAD 256
+
+Application::Application() : Application(Setting{}) {}
+
+Application::Application(const Setting &setting) : mSetting{setting} {
+  spdlog::set_level(spdlog::level::debug);
+}
 
 Application::~Application() {
   log_func;
 
   vkDestroyPipeline(mDevice->getHandle(), mPipelines.grid, nullptr);
   vkDestroyPipeline(mDevice->getHandle(), mPipelines.model, nullptr);
+  vkDestroyPipeline(mDevice->getHandle(), mPipelines.indirect, nullptr);
   vkDestroyPipelineLayout(mDevice->getHandle(), mPipelineLayouts.model, nullptr);
+  vkDestroyPipelineLayout(mDevice->getHandle(), mPipelineLayouts.indirect, nullptr);
 }
 
 void Application::handleEvent(const InputEvent &inputEvent) {
@@ -54,51 +73,100 @@ void Application::resize(const int width, const int height) {
   mSwapchain = std::make_shared<Swapchain>(mDevice, mSurface);
   mSwapchain->createDepthStencil();
   mSwapchain->createFramebuffers(mRenderPass);
+  mFrameScheduler->resetImages(mSwapchain->getImageCount());
 }
 
 void Application::setFocus(bool focus) { mWindow->setFocused(focus); }
 
 void Application::mainLoop() {
-  while (!mWindow->shouldClose()) {
+  PROFILE_THREAD("main");
+  while (!shouldClose()) {
     static int  frames   = 0;
-    static auto lastTime = mWindow->getTime();
+    static auto lastTime = getTime();
+    PROFILE_FRAME(mFrameNumber);
 
     { // update
-      static auto lastTime    = mWindow->getTime();
-      auto        currentTime = mWindow->getTime();
-      update(static_cast<float>(currentTime - lastTime));
+      static auto lastTime    = getTime();
+      auto        currentTime = getTime();
+      update(mSetting.fixedTimeStep > 0.0f ? mSetting.fixedTimeStep
+                                           : static_cast<float>(currentTime - lastTime));
       lastTime = currentTime;
     }
+    ++mFrameNumber;
 
-    mWindow->pollEvents();
+    if (mWindow) {
+      mWindow->pollEvents();
+    }
+    // Jobs pinned to the main thread by the workers
+    {
+      PROFILE_SCOPE("main thread jobs");
+      JobSystem::getInstance().runMainThreadJobs();
+    }
 
     if (++frames >= 60) {
-      auto currentTime = mWindow->getTime();
+      auto currentTime = getTime();
       auto deltaTime   = currentTime - lastTime;
       auto fps         = frames / deltaTime;
 
       log_debug("FPS {:.2f} {:.4f} ms", fps, deltaTime / frames * 1e3);
+      if (mGpuProfiler) {
+        for (const auto &result : mGpuProfiler->getResults()) {
+          if (result.hasStatistics) {
+            const auto &statistics = result.statistics;
+            log_debug("GPU {} {:.4f} ms, {} primitives, {} vertices, {} clipped, {} fragments",
+                      result.name, result.milliseconds, statistics.inputAssemblyPrimitives,
+                      statistics.vertexShaderInvocations, statistics.clippingPrimitives,
+                      statistics.fragmentShaderInvocations);
+          } else {
+            log_debug("GPU {} {:.4f} ms", result.name, result.milliseconds);
+          }
+        }
+      }
 
       frames   = 0;
       lastTime = currentTime;
     }
   }
   mDevice->waitIdle();
+
+  if (!mSetting.tracePath.empty()) {
+#ifdef SHUANG_PROFILING
+    Profiler::getInstance().writeChromeTrace(mSetting.tracePath);
+#else
+    log_warn("No trace written to {}, built without SHUANG_PROFILING", mSetting.tracePath);
+#endif
+  }
 }
 
 bool Application::setup(bool enableValidation) {
-  const std::vector<const char *> extensions{};
-  mInstance       = std::make_shared<Instance>(mTitle.c_str(), extensions, enableValidation);
-  mWindow         = std::make_unique<Window>(this, mWidth, mHeight, mTitle.c_str());
-  mSurface        = std::make_shared<Surface>(mInstance, mWindow);
+  PROFILE_FUNCTION();
+  std::vector<const char *> extensions{};
+  if (!mSetting.headless) {
+    mWindow    = std::make_unique<Window>(this, mWidth, mHeight, mTitle.c_str());
+    extensions = mWindow->getRequiredInstanceExtensions();
+  }
+  mInstance = std::make_shared<Instance>(mTitle.c_str(), extensions, enableValidation);
+  if (mWindow) {
+    mSurface = std::make_shared<Surface>(mInstance, mWindow);
+  }
   mPhysicalDevice = std::make_shared<PhysicalDevice>(mInstance);
   mDevice         = std::make_shared<Device>(mPhysicalDevice, mSurface);
-  mSwapchain      = std::make_shared<Swapchain>(mDevice, mSurface);
-  auto imageCount = mSwapchain->getImageCount();
-  mRenderPass     = std::make_shared<RenderPass>(mDevice, mSwapchain->getImageFormat(),
-                                             mSwapchain->getDepthFormat());
-  mSwapchain->createDepthStencil();
-  mSwapchain->createFramebuffers(mRenderPass);
+  // One recording thread per thread of the job system, as many as parallel::forEach runs at most
+  mFrameScheduler = std::make_unique<FrameScheduler>(
+      mDevice, mSetting.framesInFlight, JobSystem::getInstance().getThreadCount());
+  if (mSetting.gpuProfiling) {
+    mGpuProfiler = std::make_unique<GpuProfiler>(mDevice, mFrameScheduler->getFramesInFlight());
+  }
+  if (mSetting.headless) {
+    setupOffscreen();
+  } else {
+    mSwapchain  = std::make_shared<Swapchain>(mDevice, mSurface);
+    mRenderPass = std::make_shared<RenderPass>(mDevice, mSwapchain->getImageFormat(),
+                                               mSwapchain->getDepthFormat());
+    mSwapchain->createDepthStencil();
+    mSwapchain->createFramebuffers(mRenderPass);
+    mFrameScheduler->resetImages(mSwapchain->getImageCount());
+  }
 
   //  mCamera = std::make_shared<FreeCamera>();
   mCamera = std::make_shared<OrbitCamera>();
@@ -108,71 +176,114 @@ bool Application::setup(bool enableValidation) {
 
   setupDescriptorSetLayouts();
   setupPipelines();
-  mDescriptorPool = std::make_shared<DescriptorPool>(mDevice, imageCount, imageCount);
+  mDescriptorPool = std::make_shared<DescriptorPool>(
+      mDevice, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, 1);
 
+  // A single set serves every draw of every frame, the dynamic offset selects the uniforms
   auto setLayouts = {mDescriptorSetLayouts.model->getHandle()};
-  auto bufferInfo = createDescriptorBufferInfo(mUniformBuffer->getHandle(), sizeof(vs_ubo_t));
+  auto bufferInfo = createDescriptorBufferInfo(mUniformRing->getHandle(), sizeof(vs_ubo_t));
   mDescriptorSets.model =
-      std::make_unique<DescriptorSet>(mDevice, mDescriptorPool, 1, setLayouts, bufferInfo);
+      std::make_unique<DescriptorSet>(mDevice, mDescriptorPool, 1, setLayouts,
+                                      VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, bufferInfo);
 
   return true;
 }
 
+void Application::setupOffscreen() {
+  const VkFormat colorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+  const VkFormat depthFormat = mPhysicalDevice->getSuitableDepthFormat();
+
+  // Leave the color attachment ready to be copied out once the frame is rendered
+  mRenderPass = std::make_shared<RenderPass>(mDevice, colorFormat, depthFormat,
+                                             VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+
+  // One target per frame in flight, so that consecutive frames don't overwrite each other
+  for (uint32_t i = 0; i < mFrameScheduler->getFramesInFlight(); ++i) {
+    auto renderTarget = std::make_unique<RenderTarget>(mDevice, VkExtent2D{mWidth, mHeight},
+                                                       colorFormat, depthFormat);
+    renderTarget->createFramebuffer(mRenderPass);
+    mRenderTargets.push_back(std::move(renderTarget));
+  }
+}
+
 void Application::setupDescriptorSetLayouts() {
-  mDescriptorSetLayouts.model = std::make_unique<DescriptorSetLayout>(mDevice);
+  mDescriptorSetLayouts.model =
+      std::make_unique<DescriptorSetLayout>(mDevice, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
 }
 
 void Application::setupPipelines() {
+  // Every draw pushes the dequantization of the positions and the model matrix of its model, and
+  // the fade of its level of detail
+  std::array<VkPushConstantRange, 2> pushConstantRanges{};
+  pushConstantRanges[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+  pushConstantRanges[0].size       = sizeof(DrawPushConstants);
+  pushConstantRanges[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+  pushConstantRanges[1].offset     = sizeof(DrawPushConstants);
+  pushConstantRanges[1].size       = sizeof(float);
+
   { // Create pipeline layout
     std::vector<VkDescriptorSetLayout> setLayouts{mDescriptorSetLayouts.model->getHandle()};
 
     VkPipelineLayoutCreateInfo createInfo{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
-    createInfo.pSetLayouts    = setLayouts.data();
-    createInfo.setLayoutCount = setLayouts.size();
+    createInfo.pSetLayouts            = setLayouts.data();
+    createInfo.setLayoutCount         = setLayouts.size();
+    createInfo.pushConstantRangeCount = pushConstantRanges.size();
+    createInfo.pPushConstantRanges    = pushConstantRanges.data();
     vkOK(vkCreatePipelineLayout(mDevice->getHandle(), &createInfo, nullptr,
                                 &mPipelineLayouts.model));
   }
 
-  // Vertex binding and attributes
-
-  // Binding descriptions
-  VkVertexInputBindingDescription binding{
-      .binding   = 0,
-      .stride    = sizeof(Vertex),
-      .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
-  };
-  std::vector<VkVertexInputBindingDescription> bindings = {
-      binding,
-  };
+  // Vertex binding and attributes, generated from the vertex layout of the model drawn by each
+  // pipeline
+  std::vector<VkVertexInputBindingDescription>   bindings;
+  std::vector<VkVertexInputAttributeDescription> attributes;
+  VkPipelineVertexInputStateCreateInfo           vertexInputState{
+      VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+  auto setVertexInput = [&](VertexFormat vertexFormat, bool instanced) {
+    const auto &layout = VertexLayout::get(vertexFormat);
+    bindings           = {layout.getBindingDescription(0)};
+    attributes.clear();
+    layout.appendAttributeDescriptions(0, attributes);
+
+    if (instanced) {
+      // Every draw reads its instances at this rate, models drawn once use a single identity
+      // instance
+      bindings.push_back({
+          .binding   = 1,
+          .stride    = sizeof(InstanceData),
+          .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE,
+      });
+      // A mat4 takes four locations, one per column
+      for (uint32_t i = 0; i < 4; ++i) {
+        auto offset = offsetof(InstanceData, transform) + i * sizeof(glm::vec4);
+        attributes.push_back({
+            .location = 2 + i,
+            .binding  = 1,
+            .format   = VK_FORMAT_R32G32B32A32_SFLOAT,
+            .offset   = static_cast<uint32_t>(offset),
+        });
+      }
+      attributes.push_back({
+          .location = 6,
+          .binding  = 1,
+          .format   = VK_FORMAT_R32G32B32A32_SFLOAT,
+          .offset   = offsetof(InstanceData, color),
+      });
+    }
 
-  // Attribute descriptions
-  VkVertexInputAttributeDescription attribute_position = {
-      .location = 0,
-      .binding  = 0,
-      .format   = VK_FORMAT_R32G32B32_SFLOAT,
-      .offset   = offsetof(Vertex, position),
-  };
-  VkVertexInputAttributeDescription attribute_color = {
-      .location = 1,
-      .binding  = 0,
-      .format   = VK_FORMAT_R32G32B32_SFLOAT,
-      .offset   = offsetof(Vertex, color),
+    vertexInputState.pVertexBindingDescriptions      = bindings.data();
+    vertexInputState.vertexBindingDescriptionCount   = static_cast<uint32_t>(bindings.size());
+    vertexInputState.pVertexAttributeDescriptions    = attributes.data();
+    vertexInputState.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
   };
-  std::vector<VkVertexInputAttributeDescription> attributes = {
-      attribute_position,
-      attribute_color,
-  };
-
-  VkPipelineVertexInputStateCreateInfo vertexInputState{
-      VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
-  vertexInputState.pVertexBindingDescriptions      = bindings.data();
-  vertexInputState.vertexBindingDescriptionCount   = static_cast<uint32_t>(bindings.size());
-  vertexInputState.pVertexAttributeDescriptions    = attributes.data();
-  vertexInputState.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
 
+  // Topology of the model drawn by each pipeline, whose strips are separated by restart indices
   VkPipelineInputAssemblyStateCreateInfo inputAssemblyState{
       VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
-  inputAssemblyState.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+  auto setInputAssembly = [&](VkPrimitiveTopology topology) {
+    inputAssemblyState.topology               = topology;
+    inputAssemblyState.primitiveRestartEnable = topology == VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+  };
 
   // Specify rasterization state.
   VkPipelineRasterizationStateCreateInfo rasterizationState{
@@ -224,7 +335,7 @@ void Application::setupPipelines() {
 
   // Load SPIR-V shaders
   std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages{
-      loadShader("shaders/triangle.vert.spv", VK_SHADER_STAGE_VERTEX_BIT),
+      loadShader("shaders/instanced.vert.spv", VK_SHADER_STAGE_VERTEX_BIT),
       loadShader("shaders/triangle.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT),
   };
 
@@ -242,74 +353,172 @@ void Application::setupPipelines() {
   createInfo.renderPass          = mRenderPass->getHandle();
   createInfo.layout              = mPipelineLayouts.model;
 
-  vkOK(vkCreateGraphicsPipelines(mDevice->getHandle(), VK_NULL_HANDLE, 1, &createInfo, nullptr,
-                                 &mPipelines.grid));
+  auto &pipelineCache = mDevice->getPipelineCache();
+  setVertexInput(mModels.grid->getVertexFormat(), true);
+  setInputAssembly(mModels.grid->getTopology());
+  mPipelines.grid = pipelineCache.createGraphicsPipeline(createInfo, "grid");
+
+  setVertexInput(mModels.model->getVertexFormat(), true);
+  setInputAssembly(mModels.model->getTopology());
+  mPipelines.model = pipelineCache.createGraphicsPipeline(createInfo, "model");
+
+  if (mIndirectRenderer) {
+    // The objects are read from their storage buffer instead of an instance rate binding
+    std::vector<VkDescriptorSetLayout> setLayouts{mDescriptorSetLayouts.model->getHandle(),
+                                                  mIndirectRenderer->getObjectSetLayout()};
 
-  inputAssemblyState.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-  vkOK(vkCreateGraphicsPipelines(mDevice->getHandle(), VK_NULL_HANDLE, 1, &createInfo, nullptr,
-                                 &mPipelines.model));
+    VkPipelineLayoutCreateInfo layoutCreateInfo{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    layoutCreateInfo.pSetLayouts            = setLayouts.data();
+    layoutCreateInfo.setLayoutCount         = setLayouts.size();
+    layoutCreateInfo.pushConstantRangeCount = pushConstantRanges.size();
+    layoutCreateInfo.pPushConstantRanges    = pushConstantRanges.data();
+    vkOK(vkCreatePipelineLayout(mDevice->getHandle(), &layoutCreateInfo, nullptr,
+                                &mPipelineLayouts.indirect));
 
-  // Pipeline is baked, we can delete the shader modules now.
-  vkDestroyShaderModule(mDevice->getHandle(), shaderStages[0].module, nullptr);
-  vkDestroyShaderModule(mDevice->getHandle(), shaderStages[1].module, nullptr);
+    // The vertices only, every object drawn being an instance of the model
+    setVertexInput(mModels.model->getVertexFormat(), false);
+
+    shaderStages[0] = loadShader("shaders/indirect.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+
+    createInfo.layout   = mPipelineLayouts.indirect;
+    mPipelines.indirect = pipelineCache.createGraphicsPipeline(createInfo, "indirect");
+  }
 }
 
 void Application::setupModels() {
-  mModels.grid = std::make_unique<Grid>(mDevice, 5);
-  mModels.cube = std::make_unique<Cube>(mDevice);
-  //  mModels.push_back(std::make_unique<Triangle>(mDevice));
+  auto vertexFormat = mSetting.packedVertices ? VertexFormat::PACKED : VertexFormat::FLOAT;
+  mModels.grid      = std::make_unique<Grid>(mDevice, 5);
+  if (mSetting.modelPath.empty()) {
+    mModels.model = std::make_unique<Cube>(mDevice, vertexFormat);
+  } else {
+    mModels.model =
+        MeshImporter(mDevice).import(mSetting.modelPath, vertexFormat, mSetting.optimizeMeshes,
+                                     mSetting.triangleStrips, mSetting.generateLods);
+  }
 
-  // Uniform buffer
-  mUniformBuffer = std::make_unique<UniformBuffer>(
-      mDevice, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-      sizeof(vs_ubo_t));
+  mInstances.single = std::make_unique<InstanceBuffer>(
+      mDevice, std::vector<InstanceData>{{glm::mat4(1.0f), glm::vec4(1.0f)}});
+  std::vector<InstanceData> instances{{glm::mat4(1.0f), glm::vec4(1.0f)}};
+  if (mSetting.instanceGridSize > 1) {
+    // Spaced by the size of the model, centered on the origin and shaded along the grid
+    auto n       = mSetting.instanceGridSize;
+    auto spacing = 2.0f * mModels.model->getBoundingSphereRadius();
+    instances.clear();
+    instances.reserve(n * n);
+    for (uint32_t i = 0; i < n; ++i) {
+      for (uint32_t j = 0; j < n; ++j) {
+        auto offset = glm::vec3(i, 0.0f, j) - glm::vec3(n - 1, 0.0f, n - 1) * 0.5f;
+        auto color  = glm::vec4(0.5f + 0.5f * i / (n - 1), 1.0f, 0.5f + 0.5f * j / (n - 1), 1.0f);
+        instances.push_back({glm::translate(glm::mat4(1.0f), offset * spacing), color});
+      }
+    }
+  }
 
-  updateUniformBuffer();
-}
+  if (mSetting.gpuDriven) {
+    // Every instance is an object of its own, culled on the GPU
+    auto objectCount  = static_cast<uint32_t>(instances.size());
+    auto rangeCount   = static_cast<uint32_t>(mModels.model->getIndexRanges().size());
+    mIndirectRenderer = std::make_unique<IndirectRenderer>(mDevice, objectCount, rangeCount,
+                                                           objectCount * rangeCount,
+                                                           mFrameScheduler->getFramesInFlight());
+    for (const auto &instance : instances) {
+      mIndirectRenderer->addObject(*mModels.model, instance.transform, instance.color);
+    }
+  } else {
+    if (instances.size() > 1) {
+      mInstances.model = std::make_unique<InstanceBuffer>(mDevice, instances);
+    }
+    mScene.addNode(Scene::INVALID_NODE, glm::mat4(1.0f), mModels.model.get(),
+                   mInstances.model.get());
+  }
+  //  mModels.push_back(std::make_unique<Triangle>(mDevice));
 
-void Application::updateUniformBuffer() {
-  static auto startTime   = std::chrono::high_resolution_clock::now();
-  auto        currentTime = std::chrono::high_resolution_clock::now();
-  auto        time =
-      std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+  // Uniform ring
+  mUniformRing = std::make_unique<UniformRing>(mDevice, UNIFORM_RING_FRAME_SIZE,
+                                               mFrameScheduler->getFramesInFlight());
+}
 
+void Application::writeUniforms() {
   vs_ubo_t ubo{};
-  ubo.model = glm::mat4(1.f);
-  ubo.view  = mCamera->getViewMatrix();
-  ubo.proj  = mCamera->getProjectionMatrix();
+  ubo.view = mCamera->getViewMatrix();
+  ubo.proj = mCamera->getProjectionMatrix();
 
-  mUniformBuffer->copy(&ubo, sizeof(ubo));
+  mUniformOffset = mUniformRing->push(ubo);
 }
 
-void Application::update(float timeStep) {
-  uint32_t imageIndex;
-
-  auto result = mSwapchain->acquireNextImage(imageIndex);
-  if (result == VK_SUBOPTIMAL_KHR || result == VK_ERROR_OUT_OF_DATE_KHR) {
-    resize(mSwapchain->getImageExtent().width, mSwapchain->getImageExtent().height);
-    result = mSwapchain->acquireNextImage(imageIndex);
-  }
+void Application::bindUniforms(const VkCommandBuffer &commandBuffer) {
+  // The layouts of the model and indirect pipelines are compatible up to the uniforms
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayouts.model, 0,
+                          1, &mDescriptorSets.model->getHandle(), 1, &mUniformOffset);
+}
 
-  if (result != VK_SUCCESS) {
-    vkQueueWaitIdle(mDevice->getGraphicsQueue());
-    return;
+void Application::update(float timeStep) {
+  PROFILE_FUNCTION();
+  mFrameScheduler->beginFrame();
+
+  uint32_t imageIndex = mFrameScheduler->getFrameIndex();
+  if (mSwapchain) {
+    auto result = acquireNextImage(imageIndex);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+      // Nothing has been submitted, the frame will be recorded again once resized.
+      resize(mSwapchain->getImageExtent().width, mSwapchain->getImageExtent().height);
+      return;
+    }
+    if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+      mDevice->getGraphicsQueue().waitIdle();
+      return;
+    }
+    mFrameScheduler->bindImage(imageIndex);
   }
 
-  updateUniformBuffer();
+  // The GPU is done with the frame, so is it with its uniforms
+  mUniformRing->beginFrame(mFrameScheduler->getFrameIndex());
 
   updateScene(timeStep);
+  writeUniforms();
+
+  // Submit the uploads recorded since the last frame ahead of it, in a single batch, and hand the
+  // streamed data copied meanwhile over to the graphics queue
+  mDevice->getStreamingBatcher().flush();
+  mDevice->getUploadBatcher().flush();
 
   vkOK(render(imageIndex));
-  vkOK(present(imageIndex));
+
+  if (mSwapchain) {
+    auto result = present(imageIndex);
+    if (result == VK_SUBOPTIMAL_KHR || result == VK_ERROR_OUT_OF_DATE_KHR) {
+      resize(mSwapchain->getImageExtent().width, mSwapchain->getImageExtent().height);
+    } else {
+      vkOK(result);
+    }
+  }
+
+  mFrameScheduler->endFrame();
 }
 
-void Application::updateScene(float timeStep) { mCamera->update(timeStep); }
+VkResult Application::acquireNextImage(uint32_t &imageIndex) {
+  PROFILE_FUNCTION();
+  return mSwapchain->acquireNextImage(mFrameScheduler->getFrame().acquiredSemaphore, imageIndex);
+}
+
+void Application::updateScene(float timeStep) {
+  PROFILE_FUNCTION();
+  mCamera->update(timeStep);
+  mScene.update();
+  mScene.updateLods(LodSelector(*mCamera, static_cast<float>(getRenderExtent().height)), timeStep);
+  if (mIndirectRenderer) {
+    mObjectsUploaded = mIndirectRenderer->update();
+  }
+}
 
 VkResult Application::render(const uint32_t imageIndex) {
-  auto &frame = mSwapchain->getFrames()[imageIndex];
+  PROFILE_FUNCTION();
+  auto &frame = mFrameScheduler->getFrame();
 
   // Render to this framebuffer.
-  auto &framebuffer = mSwapchain->getFramebuffers()[imageIndex];
+  auto framebuffer = mSwapchain ? mSwapchain->getFramebuffers()[imageIndex]
+                                : mRenderTargets[imageIndex]->getFramebuffer();
+  auto extent = getRenderExtent();
 
   // Allocate or re-use a primary command buffer.
   auto commandBuffer = frame.primaryCommandBuffer;
@@ -319,6 +528,25 @@ VkResult Application::render(const uint32_t imageIndex) {
   commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
   // Begin command recording
   vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+  if (mGpuProfiler) {
+    // The fence of the frame was waited for, its previous results are available
+    mGpuProfiler->beginFrame(commandBuffer, mFrameScheduler->getFrameIndex());
+  }
+
+  // Compute work can't be recorded within a render pass. With a compute queue of its own, it is
+  // submitted ahead of the frame instead, whose draws wait for it.
+  Frustum                  frustum(*mCamera);
+  LodSelector              lodSelector(*mCamera, static_cast<float>(extent.height));
+  std::vector<Queue::Wait> waits;
+  if (mIndirectRenderer && frame.computeCommandBuffer != VK_NULL_HANDLE) {
+    submitCompute(frustum, lodSelector);
+    waits.push_back({frame.computeSemaphore, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT});
+  } else if (mIndirectRenderer) {
+    auto scope = beginGpuScope(commandBuffer, "cull");
+    mIndirectRenderer->cull(commandBuffer, frustum, lodSelector,
+                            mFrameScheduler->getFrameIndex());
+    endGpuScope(commandBuffer, scope);
+  }
 
   // Set clear color values.
   std::array<VkClearValue, 2> clearValues{};
@@ -329,69 +557,86 @@ VkResult Application::render(const uint32_t imageIndex) {
   VkRenderPassBeginInfo renderPassBeginInfo{VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
   renderPassBeginInfo.renderPass               = mRenderPass->getHandle();
   renderPassBeginInfo.framebuffer              = framebuffer;
-  renderPassBeginInfo.renderArea.extent.width  = mSwapchain->getImageExtent().width;
-  renderPassBeginInfo.renderArea.extent.height = mSwapchain->getImageExtent().height;
+  renderPassBeginInfo.renderArea.extent.width  = extent.width;
+  renderPassBeginInfo.renderArea.extent.height = extent.height;
   renderPassBeginInfo.clearValueCount          = clearValues.size();
   renderPassBeginInfo.pClearValues             = clearValues.data();
-  // We will add draw commands in the same command buffer.
-  vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-  VkViewport viewport{};
-  viewport.width    = static_cast<float>(mSwapchain->getImageExtent().width);
-  viewport.height   = static_cast<float>(mSwapchain->getImageExtent().height);
-  viewport.minDepth = 0.0f;
-  viewport.maxDepth = 1.0f;
-  // Set viewport dynamically
-  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-
-  VkRect2D scissor{};
-  scissor.extent = mSwapchain->getImageExtent();
-  // Set scissor dynamically
-  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-
-  // Draw grid
-  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelines.grid);
-  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayouts.model, 0,
-                          1, &mDescriptorSets.model->getHandle(), 0, nullptr);
-
-  draw(commandBuffer, mModels.grid.get());
-
-  // Draw model
-  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelines.model);
-  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayouts.model, 0,
-                          1, &mDescriptorSets.model->getHandle(), 0, nullptr);
-
-  draw(commandBuffer, mModels.cube.get());
+  // Draws are recorded into secondary command buffers, by several threads at once
+  auto renderPassScope = beginGpuScope(commandBuffer, "render pass");
+  vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo,
+                       VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+  // Gather the models of the scene in view, to be split across the recording threads. Streamed
+  // models are skipped until they are handed over to the graphics queue.
+  auto &streamingBatcher = mDevice->getStreamingBatcher();
+  mCullStatistics        = mScene.cull(frustum);
+  mDrawList.clear();
+  mScene.forEachVisibleModel([&](const Model &model, const glm::mat4 &transform,
+                                 const InstanceBuffer *instances, const LodSelector::State &lod) {
+    instances = instances ? instances : mInstances.single.get();
+    if (streamingBatcher.isAvailable(model.getUploadToken()) &&
+        streamingBatcher.isAvailable(instances->getUploadToken())) {
+      mDrawList.push_back({&model, &transform, instances, &lod});
+    }
+  });
+
+  auto drawCount   = mDrawList.size();
+  auto threadCount = std::clamp<size_t>(
+      (drawCount + DRAWS_PER_RECORDING_THREAD - 1) / DRAWS_PER_RECORDING_THREAD, 1,
+      frame.secondaryCommandBuffers.size());
+  parallel::forEach(threadCount, [&](size_t i) {
+    recordDraws(frame.secondaryCommandBuffers[i], framebuffer, extent, drawCount * i / threadCount,
+                drawCount * (i + 1) / threadCount);
+  });
+  vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(threadCount),
+                       frame.secondaryCommandBuffers.data());
 
   // Complete render pass.
   vkCmdEndRenderPass(commandBuffer);
+  endGpuScope(commandBuffer, renderPassScope);
 
   // Complete the command buffer.
   vkOK(vkEndCommandBuffer(commandBuffer));
 
-  // Submit it to the queue with a release semaphore.
-  if (frame.releasedSemaphore == VK_NULL_HANDLE) {
-    VkSemaphoreCreateInfo semaphoreCreateInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
-    vkOK(vkCreateSemaphore(mDevice->getHandle(), &semaphoreCreateInfo, nullptr,
-                           &frame.releasedSemaphore));
+  // Offscreen frames are neither acquired nor presented, so there is nothing to wait or signal.
+  std::vector<VkSemaphore> signalSemaphores;
+  if (mSwapchain) {
+    // Submit it to the queue with a release semaphore.
+    waits.push_back({frame.acquiredSemaphore, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT});
+    signalSemaphores.push_back(frame.releasedSemaphore);
   }
 
-  VkPipelineStageFlags waitStage{VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-
-  VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
-  submitInfo.commandBufferCount   = 1;
-  submitInfo.pCommandBuffers      = &commandBuffer;
-  submitInfo.waitSemaphoreCount   = 1;
-  submitInfo.pWaitSemaphores      = &frame.acquiredSemaphore;
-  submitInfo.pWaitDstStageMask    = &waitStage;
-  submitInfo.signalSemaphoreCount = 1;
-  submitInfo.pSignalSemaphores    = &frame.releasedSemaphore;
+  // The frame is about to be reused by the GPU, no longer signaled
+  vkOK(vkResetFences(mDevice->getHandle(), 1, &frame.queueSubmittedFence));
   // Submit command buffer to graphics queue
-  return vkQueueSubmit(mDevice->getGraphicsQueue(), 1, &submitInfo, frame.queueSubmittedFence);
+  return mDevice->getGraphicsQueue().submit({commandBuffer}, waits, signalSemaphores,
+                                            frame.queueSubmittedFence);
+}
+
+void Application::submitCompute(const Frustum &frustum, const LodSelector &lodSelector) {
+  PROFILE_FUNCTION();
+  auto &frame         = mFrameScheduler->getFrame();
+  auto  commandBuffer = frame.computeCommandBuffer;
+
+  VkCommandBufferBeginInfo commandBufferBeginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+  commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkOK(vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo));
+  mIndirectRenderer->cull(commandBuffer, frustum, lodSelector, mFrameScheduler->getFrameIndex());
+  vkOK(vkEndCommandBuffer(commandBuffer));
+
+  // Objects uploaded by the graphics queue for this frame must be copied before they are culled,
+  // which otherwise doesn't wait for the previous frame
+  std::vector<Queue::Wait> waits;
+  if (mObjectsUploaded) {
+    vkOK(mDevice->getGraphicsQueue().submit({}, {}, {frame.uploadSemaphore}));
+    waits.push_back({frame.uploadSemaphore, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT});
+  }
+  vkOK(mDevice->getComputeQueue().submit({commandBuffer}, waits, {frame.computeSemaphore}));
 }
 
 VkResult Application::present(const uint32_t imageIndex) {
-  auto &frame = mSwapchain->getFrames()[imageIndex];
+  PROFILE_FUNCTION();
+  auto &frame = mFrameScheduler->getFrame();
 
   VkPresentInfoKHR presentInfo{VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
   presentInfo.swapchainCount     = 1;
@@ -399,37 +644,137 @@ VkResult Application::present(const uint32_t imageIndex) {
   presentInfo.pImageIndices      = &imageIndex;
   presentInfo.waitSemaphoreCount = 1;
   presentInfo.pWaitSemaphores    = &frame.releasedSemaphore;
-  // Present swapchain imageIndex
-  vkOK(vkQueuePresentKHR(mDevice->getGraphicsQueue(), &presentInfo));
-  return vkQueueWaitIdle(mDevice->getGraphicsQueue());
+  // Present swapchain imageIndex, without waiting for it: the frame scheduler throttles the CPU
+  return mDevice->getGraphicsQueue().present(presentInfo);
 }
 
-VkShaderModule Application::loadShader(const char *path) {
-  auto source = filesystem::read(path);
+double Application::getTime() const {
+  if (mWindow) {
+    return mWindow->getTime();
+  }
+  static const auto startTime = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
 
-  VkShaderModuleCreateInfo createInfo{VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
-  createInfo.codeSize = source.size();
-  createInfo.pCode    = reinterpret_cast<const uint32_t *>(source.data());
+bool Application::shouldClose() const {
+  if (mWindow) {
+    return mWindow->shouldClose();
+  }
+  return mSetting.frameCount > 0 && mFrameNumber >= mSetting.frameCount;
+}
 
-  VkShaderModule shaderModule;
-  vkOK(vkCreateShaderModule(mDevice->getHandle(), &createInfo, nullptr, &shaderModule));
-  return shaderModule;
+VkExtent2D Application::getRenderExtent() const {
+  return mSwapchain ? mSwapchain->getImageExtent() : mRenderTargets.front()->getExtent();
 }
 
 VkPipelineShaderStageCreateInfo Application::loadShader(const char           *path,
                                                         VkShaderStageFlagBits stage) {
   VkPipelineShaderStageCreateInfo createInfo{VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO};
   createInfo.stage  = stage;
-  createInfo.module = loadShader(path);
+  // Owned by the shader library, which keeps it for later pipelines
+  createInfo.module = mDevice->getShaderLibrary().load(path);
   createInfo.pName  = "main";
   return createInfo;
 }
 
-void Application::draw(const VkCommandBuffer &commandBuffer, const Model *model) {
-  VkDeviceSize offsets[1] = {0};
-  vkCmdBindVertexBuffers(commandBuffer, 0, 1, &model->getVertexBuffer()->getHandle(), offsets);
+void Application::recordDraws(VkCommandBuffer commandBuffer, VkFramebuffer framebuffer,
+                              VkExtent2D extent, size_t begin, size_t end) {
+  PROFILE_FUNCTION();
+  VkCommandBufferInheritanceInfo inheritanceInfo{
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+  inheritanceInfo.renderPass  = mRenderPass->getHandle();
+  inheritanceInfo.subpass     = 0;
+  inheritanceInfo.framebuffer = framebuffer;
+
+  VkCommandBufferBeginInfo commandBufferBeginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+  commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                                 VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+  commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
+  vkOK(vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo));
+
+  // Dynamic state isn't inherited from the primary command buffer
+  VkViewport viewport{};
+  viewport.width    = static_cast<float>(extent.width);
+  viewport.height   = static_cast<float>(extent.height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+  VkRect2D scissor{};
+  scissor.extent = extent;
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+  // Statistics queries can't be active in the primary command buffer while it executes these
+  auto scope = beginGpuScope(commandBuffer, fmt::format("draws [{}, {})", begin, end), true);
+
+  bindUniforms(commandBuffer);
+
+  // The grid and the objects found visible by the GPU go along with the first draws
+  if (begin == 0) {
+    auto &streamingBatcher = mDevice->getStreamingBatcher();
+    if (streamingBatcher.isAvailable(mModels.grid->getUploadToken()) &&
+        streamingBatcher.isAvailable(mInstances.single->getUploadToken())) {
+      vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelines.grid);
+      draw(commandBuffer, mPipelineLayouts.model, mModels.grid.get(), mInstances.single.get(),
+           glm::mat4(1.0f));
+    }
+
+    if (mIndirectRenderer) {
+      vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelines.indirect);
+      mIndirectRenderer->draw(commandBuffer, mPipelineLayouts.indirect,
+                              mFrameScheduler->getFrameIndex());
+    }
+  }
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelines.model);
+  for (auto i = begin; i < end; ++i) {
+    const auto &item = mDrawList[i];
+    // While fading, the levels are drawn dithered in complementary patterns
+    const auto &lod = *item.lod;
+    if (lod.fade < 1.0f) {
+      draw(commandBuffer, mPipelineLayouts.model, item.model, item.instances, *item.transform,
+           lod.previousLod, lod.fade - 1.0f);
+    }
+    draw(commandBuffer, mPipelineLayouts.model, item.model, item.instances, *item.transform,
+         lod.lod, lod.fade);
+  }
+
+  endGpuScope(commandBuffer, scope);
+  vkOK(vkEndCommandBuffer(commandBuffer));
+}
+
+uint32_t Application::beginGpuScope(VkCommandBuffer commandBuffer, std::string name,
+                                    bool statistics) {
+  return mGpuProfiler ? mGpuProfiler->beginScope(commandBuffer, std::move(name), statistics)
+                      : UINT32_MAX;
+}
+
+void Application::endGpuScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+  if (mGpuProfiler) {
+    mGpuProfiler->endScope(commandBuffer, scope);
+  }
+}
+
+void Application::draw(const VkCommandBuffer &commandBuffer, VkPipelineLayout pipelineLayout,
+                       const Model *model, const InstanceBuffer *instances,
+                       const glm::mat4 &transform, uint32_t lod, float fade) {
+  DrawPushConstants constants{model->getDequantization(), transform};
+  vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+                     sizeof(constants), &constants);
+  vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT,
+                     sizeof(constants), sizeof(fade), &fade);
+
+  // Every instance in one call per index range of the level
+  VkBuffer     buffers[2] = {model->getVertexBuffer()->getHandle(), instances->getHandle()};
+  VkDeviceSize offsets[2] = {0, 0};
+  vkCmdBindVertexBuffers(commandBuffer, 0, 2, buffers, offsets);
   vkCmdBindIndexBuffer(commandBuffer, model->getIndexBuffer()->getHandle(), 0,
-                       VK_INDEX_TYPE_UINT32);
-  vkCmdDrawIndexed(commandBuffer, model->getIndexBuffer()->getIndexCount(), 1, 0, 0, 0);
+                       model->getIndexBuffer()->getIndexType());
+  const auto &ranges = model->getIndexRanges();
+  const auto &level  = model->getLods()[lod];
+  for (auto i = level.firstRange; i < level.firstRange + level.rangeCount; ++i) {
+    vkCmdDrawIndexed(commandBuffer, ranges[i].indexCount, instances->getCount(),
+                     ranges[i].firstIndex, ranges[i].vertexOffset, 0);
+  }
   //  vkCmdDraw(commandBuffer, model->getVertexBuffer()->getCount(), 1, 0, 0);
 }
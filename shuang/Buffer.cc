@@ -2,70 +2,52 @@
 #include "Device.h"
 #include "Log.h"
 #include "Macros.h"
+#include "Profiler.h"
 
 Buffer::Buffer(const std::shared_ptr<Device> &device, VkBufferUsageFlags usage,
-               VkMemoryPropertyFlags properties, VkDeviceSize size, void *data)
+               VkMemoryPropertyFlags properties, VkDeviceSize size, void *data,
+               MemoryLifetime lifetime, const std::vector<uint32_t> &queueFamilyIndices)
     : mDevice{device}, mSize{size} {
+  PROFILE_FUNCTION();
+
   // Create the buffer handle
   VkBufferCreateInfo bufferCreateInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
   bufferCreateInfo.usage       = usage;
   bufferCreateInfo.size        = size;
   bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  if (queueFamilyIndices.size() > 1) {
+    bufferCreateInfo.sharingMode           = VK_SHARING_MODE_CONCURRENT;
+    bufferCreateInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilyIndices.size());
+    bufferCreateInfo.pQueueFamilyIndices   = queueFamilyIndices.data();
+  }
   vkOK(vkCreateBuffer(device->getHandle(), &bufferCreateInfo, nullptr, &mHandle));
 
-  // Create the memory backing up the buffer handle
+  // Sub-allocate the memory backing up the buffer handle
   VkMemoryRequirements memoryRequirements;
   vkGetBufferMemoryRequirements(device->getHandle(), mHandle, &memoryRequirements);
+  mAllocation = device->getMemoryAllocator().allocate(memoryRequirements, properties, lifetime);
 
-  VkMemoryAllocateInfo memoryAllocateInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
-  memoryAllocateInfo.allocationSize = memoryRequirements.size;
-  // Find a memory type index that fits the properties of the buffer
-  memoryAllocateInfo.memoryTypeIndex =
-      device->getPhysicalDevice()->getMemoryType(memoryRequirements.memoryTypeBits, properties);
-  vkOK(vkAllocateMemory(device->getHandle(), &memoryAllocateInfo, nullptr, &mMemory));
-
-  // If a pointer to the buffer data has been passed, map the buffer and copy data
+  // If a pointer to the buffer data has been passed, copy data into the mapped memory
   if (data != nullptr) {
-    void *mapped;
-    vkOK(vkMapMemory(device->getHandle(), mMemory, 0, size, 0, &mapped));
-    memcpy(mapped, data, static_cast<size_t>(size));
-    // If host coherency hasn't been requested, do a manual flush to make writes visible
-    if ((properties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0) {
-      VkMappedMemoryRange mappedRange{VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE};
-      mappedRange.memory = mMemory;
-      mappedRange.offset = 0;
-      mappedRange.size   = size;
-      vkFlushMappedMemoryRanges(device->getHandle(), 1, &mappedRange);
-    }
-    vkUnmapMemory(device->getHandle(), mMemory);
+    copy(data, static_cast<size_t>(size));
   }
 
   // Attach the memory to the buffer object
-  vkOK(vkBindBufferMemory(device->getHandle(), mHandle, mMemory, 0));
+  vkOK(vkBindBufferMemory(device->getHandle(), mHandle, mAllocation.memory, mAllocation.offset));
 }
 
 Buffer::~Buffer() {
   log_func;
-  vkFreeMemory(mDevice->getHandle(), mMemory, nullptr);
   vkDestroyBuffer(mDevice->getHandle(), mHandle, nullptr);
+  mDevice->getMemoryAllocator().free(mAllocation);
 }
 
-void Buffer::copy(const std::shared_ptr<Buffer> &src, VkQueue queue, VkBufferCopy *region) {
-  VkBufferCopy bufferCopy{};
-  if (!region) {
-    bufferCopy.size = src->getSize();
-  } else {
-    bufferCopy = *region;
+void Buffer::copy(const void *data, size_t size, VkDeviceSize offset) {
+  if (mAllocation.mapped == nullptr) {
+    throw std::runtime_error("Buffer is not host visible");
   }
 
-  auto copyCommand = mDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-  vkCmdCopyBuffer(copyCommand, src->getHandle(), mHandle, 1, &bufferCopy);
-  mDevice->flushCommandBuffer(copyCommand, queue);
-}
-
-void Buffer::copy(void *data, size_t size) {
-  void *mapped;
-  vkOK(vkMapMemory(mDevice->getHandle(), mMemory, 0, size, 0, &mapped));
-  memcpy(mapped, data, size);
-  vkUnmapMemory(mDevice->getHandle(), mMemory);
+  memcpy(static_cast<uint8_t *>(mAllocation.mapped) + offset, data, size);
+  // A no-op on host coherent memory, otherwise makes writes visible
+  mDevice->getMemoryAllocator().flush(mAllocation, offset, size);
 }
@@ -3,13 +3,13 @@
 #include "Log.h"
 #include "Macros.h"
 
-DescriptorPool::DescriptorPool(const std::shared_ptr<Device> &device, uint32_t descriptorCount,
-                               uint32_t maxSets)
+DescriptorPool::DescriptorPool(const std::shared_ptr<Device> &device, VkDescriptorType type,
+                               uint32_t descriptorCount, uint32_t maxSets)
     : mDevice{device} {
   std::vector<VkDescriptorPoolSize> descriptorPoolSizes{};
 
   VkDescriptorPoolSize descriptorPoolSize;
-  descriptorPoolSize.type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  descriptorPoolSize.type            = type;
   descriptorPoolSize.descriptorCount = descriptorCount;
 
   descriptorPoolSizes.push_back(descriptorPoolSize);
@@ -8,7 +8,18 @@ DescriptorSet::DescriptorSet(const std::shared_ptr<Device>            &device,
                              const std::shared_ptr<DescriptorPool>    &pool,
                              uint32_t                                  descriptorSetCount,
                              const std::vector<VkDescriptorSetLayout> &descriptorSetLayouts,
-                             const VkDescriptorBufferInfo             &bufferInfo) {
+                             VkDescriptorType                          type,
+                             const VkDescriptorBufferInfo             &bufferInfo)
+    : DescriptorSet(device, pool, descriptorSetCount, descriptorSetLayouts,
+                    std::vector<VkDescriptorType>{type},
+                    std::vector<VkDescriptorBufferInfo>{bufferInfo}) {}
+
+DescriptorSet::DescriptorSet(const std::shared_ptr<Device>             &device,
+                             const std::shared_ptr<DescriptorPool>     &pool,
+                             uint32_t                                   descriptorSetCount,
+                             const std::vector<VkDescriptorSetLayout>  &descriptorSetLayouts,
+                             const std::vector<VkDescriptorType>       &types,
+                             const std::vector<VkDescriptorBufferInfo> &bufferInfos) {
   VkDescriptorSetAllocateInfo allocateInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
   allocateInfo.descriptorPool     = pool->getHandle();
   allocateInfo.descriptorSetCount = descriptorSetCount;
@@ -16,10 +27,10 @@ DescriptorSet::DescriptorSet(const std::shared_ptr<Device>            &device,
 
   vkOK(vkAllocateDescriptorSets(device->getHandle(), &allocateInfo, &mHandle));
 
-  std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
-      // Binding 0 : vertex shader uniform buffer
-      createWriteDescriptorSet(mHandle, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &bufferInfo),
-  };
+  std::vector<VkWriteDescriptorSet> writeDescriptorSets;
+  for (uint32_t i = 0; i < types.size(); ++i) {
+    writeDescriptorSets.push_back(createWriteDescriptorSet(mHandle, types[i], i, &bufferInfos[i]));
+  }
   vkUpdateDescriptorSets(device->getHandle(), writeDescriptorSets.size(),
                          writeDescriptorSets.data(), 0, nullptr);
 }
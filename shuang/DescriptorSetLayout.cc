@@ -3,11 +3,19 @@
 #include "Log.h"
 #include "Macros.h"
 
-DescriptorSetLayout::DescriptorSetLayout(const std::shared_ptr<Device> &device) : mDevice{device} {
-  std::vector<VkDescriptorSetLayoutBinding> bindings = {
-      createDescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                                       VK_SHADER_STAGE_VERTEX_BIT, 0),
-  };
+DescriptorSetLayout::DescriptorSetLayout(const std::shared_ptr<Device> &device,
+                                         VkDescriptorType               type)
+    : DescriptorSetLayout(device, std::vector<VkDescriptorType>{type},
+                          VK_SHADER_STAGE_VERTEX_BIT) {}
+
+DescriptorSetLayout::DescriptorSetLayout(const std::shared_ptr<Device>       &device,
+                                         const std::vector<VkDescriptorType> &types,
+                                         VkShaderStageFlags                   stages)
+    : mDevice{device} {
+  std::vector<VkDescriptorSetLayoutBinding> bindings;
+  for (uint32_t i = 0; i < types.size(); ++i) {
+    bindings.push_back(createDescriptorSetLayoutBinding(types[i], stages, i));
+  }
 
   VkDescriptorSetLayoutCreateInfo createInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
   createInfo.pBindings    = bindings.data();
@@ -7,6 +7,9 @@
 #include <vulkan/vulkan_beta.h>
 
 #define FENCE_DEFAULT_TIMEOUT 100000000000 // Fence default timeout in nanoseconds
+#define STAGING_RING_SIZE (32 * 1024 * 1024)
+#define STREAMING_RING_SIZE (64 * 1024 * 1024)
+#define PIPELINE_CACHE_PATH "pipeline_cache.bin"
 
 Device::Device(const std::shared_ptr<PhysicalDevice> &physicalDevice,
                const std::shared_ptr<Surface>        &surface)
@@ -36,16 +39,20 @@ Device::Device(const std::shared_ptr<PhysicalDevice> &physicalDevice,
   // Create device
 
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos{};
-  const float                          defaultQueuePriority = 0.0f;
+  // At most two queues of a family, see the transfer queue
+  const float queuePriorities[] = {0.0f, 0.0f};
 
   // Graphics queue
+  // Without a surface (headless) there is nothing to present to, so any graphics queue will do.
   int queueFamilyIndex = -1;
   for (auto i = 0; i < mQueueFamilyProperties.size(); ++i) {
-    VkBool32 supportPresent;
-    if (vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice->getHandle(), i, surface->getHandle(),
-                                             &supportPresent);
-        !supportPresent) {
-      continue;
+    if (surface) {
+      VkBool32 supportPresent;
+      if (vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice->getHandle(), i,
+                                               surface->getHandle(), &supportPresent);
+          !supportPresent) {
+        continue;
+      }
     }
     if ((mQueueFamilyProperties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
       queueFamilyIndex = i;
@@ -53,8 +60,9 @@ Device::Device(const std::shared_ptr<PhysicalDevice> &physicalDevice,
     }
   }
   if (queueFamilyIndex == -1) {
-    throw std::runtime_error("Did not find suitable queue which supports "
-                             "graphics and presentation.");
+    throw std::runtime_error(surface ? "Did not find suitable queue which supports "
+                                       "graphics and presentation."
+                                     : "Did not find suitable queue which supports graphics.");
   }
   mQueueFamilyIndices.graphics = queueFamilyIndex;
 
@@ -62,13 +70,62 @@ Device::Device(const std::shared_ptr<PhysicalDevice> &physicalDevice,
   queueCreateInfo.sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
   queueCreateInfo.queueFamilyIndex = mQueueFamilyIndices.graphics;
   queueCreateInfo.queueCount       = 1;
-  queueCreateInfo.pQueuePriorities = &defaultQueuePriority;
+  queueCreateInfo.pQueuePriorities = queuePriorities;
   queueCreateInfos.push_back(queueCreateInfo);
 
+  // Compute queue, of a family without graphics whose work runs concurrently with the rendering.
+  // Every graphics queue supports compute work otherwise.
+  mQueueFamilyIndices.compute = mQueueFamilyIndices.graphics;
+  for (auto i = 0; i < mQueueFamilyProperties.size(); ++i) {
+    const auto &flags = mQueueFamilyProperties[i].queueFlags;
+    if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT)) {
+      mQueueFamilyIndices.compute = i;
+      break;
+    }
+  }
+  if (hasDedicatedComputeQueue()) {
+    queueCreateInfo.queueFamilyIndex = mQueueFamilyIndices.compute;
+    queueCreateInfos.push_back(queueCreateInfo);
+  }
+
+  // Transfer queue, of a family without graphics whose copies run alongside the rendering,
+  // preferably a transfer only one. Families with graphics or compute support transfers without
+  // necessarily reporting it. Images of any size must be copyable.
+  mQueueFamilyIndices.transfer = mQueueFamilyIndices.graphics;
+  for (auto i = 0; i < mQueueFamilyProperties.size(); ++i) {
+    const auto &properties  = mQueueFamilyProperties[i];
+    const auto &granularity = properties.minImageTransferGranularity;
+    if ((properties.queueFlags & VK_QUEUE_GRAPHICS_BIT) ||
+        !(properties.queueFlags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT)) ||
+        granularity.width != 1 || granularity.height != 1 || granularity.depth != 1) {
+      continue;
+    }
+    if (mQueueFamilyIndices.transfer == mQueueFamilyIndices.graphics ||
+        !(properties.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+      mQueueFamilyIndices.transfer = i;
+    }
+  }
+  // The compute family may be the one found, whose second queue is used if it has one, otherwise
+  // transfers share the compute queue
+  uint32_t transferQueueIndex = 0;
+  if (hasDedicatedTransferQueue()) {
+    if (mQueueFamilyIndices.transfer != mQueueFamilyIndices.compute) {
+      queueCreateInfo.queueFamilyIndex = mQueueFamilyIndices.transfer;
+      queueCreateInfos.push_back(queueCreateInfo);
+    } else if (mQueueFamilyProperties[mQueueFamilyIndices.transfer].queueCount > 1) {
+      queueCreateInfos.back().queueCount = 2;
+      transferQueueIndex                 = 1;
+    }
+  }
+  log_info("Queue families: graphics {}, compute {}, transfer {}", mQueueFamilyIndices.graphics,
+           mQueueFamilyIndices.compute, mQueueFamilyIndices.transfer);
+
   std::vector<const char *> deviceExtensions{
-      VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME,
       /* VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME, */
   };
+  if (surface) {
+    deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+  }
 
   // Check extensions supportability
   for (const auto &extension : deviceExtensions) {
@@ -77,27 +134,88 @@ Device::Device(const std::shared_ptr<PhysicalDevice> &physicalDevice,
     }
   }
 
+  // Must be enabled whenever the implementation is a portability one (e.g. MoltenVK), while
+  // software or desktop drivers don't expose it at all
+  if (supportsExtension(VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME)) {
+    deviceExtensions.push_back(VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME);
+  }
+
   VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures{
       VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT};
   extendedDynamicStateFeatures.extendedDynamicState = VK_TRUE;
 
+  // Indirect draws whose count is written by the GPU, reading per-object data through the first
+  // instance, are enabled where supported
+  VkPhysicalDeviceVulkan12Features supportedVulkan12Features{
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+  VkPhysicalDeviceFeatures2 supportedFeatures{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+  supportedFeatures.pNext = &supportedVulkan12Features;
+  vkGetPhysicalDeviceFeatures2(physicalDevice->getHandle(), &supportedFeatures);
+  mSupportsDrawIndirectCount = supportedVulkan12Features.drawIndirectCount &&
+                               supportedFeatures.features.drawIndirectFirstInstance;
+
+  VkPhysicalDeviceVulkan12Features vulkan12Features{
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+  vulkan12Features.pNext             = &extendedDynamicStateFeatures;
+  vulkan12Features.drawIndirectCount = mSupportsDrawIndirectCount;
+  // Counted by the GPU profiler where supported
+  mSupportsPipelineStatistics = supportedFeatures.features.pipelineStatisticsQuery;
+
+  VkPhysicalDeviceFeatures enabledFeatures{};
+  enabledFeatures.drawIndirectFirstInstance = mSupportsDrawIndirectCount;
+  enabledFeatures.pipelineStatisticsQuery   = mSupportsPipelineStatistics;
+
   VkDeviceCreateInfo deviceCreateInfo{VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
   deviceCreateInfo.queueCreateInfoCount    = static_cast<uint32_t>(queueCreateInfos.size());
   deviceCreateInfo.pQueueCreateInfos       = queueCreateInfos.data();
   deviceCreateInfo.enabledExtensionCount   = static_cast<uint32_t>(deviceExtensions.size());
   deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
-  deviceCreateInfo.pNext                   = &extendedDynamicStateFeatures;
+  deviceCreateInfo.pEnabledFeatures        = &enabledFeatures;
+  deviceCreateInfo.pNext                   = &vulkan12Features;
 
   vkOK(vkCreateDevice(physicalDevice->getHandle(), &deviceCreateInfo, nullptr, &mHandle));
 
-  vkGetDeviceQueue(mHandle, mQueueFamilyIndices.graphics, 0, &mGraphicsQueue);
+  // Queues of a family other than the graphics one are created on their own, the others share
+  // the graphics queue
+  mGraphicsQueue = std::make_shared<Queue>(*this, mQueueFamilyIndices.graphics, 0,
+                                           mQueueFamilyProperties[mQueueFamilyIndices.graphics],
+                                           surface != nullptr);
+  mComputeQueue  = mGraphicsQueue;
+  mTransferQueue = mGraphicsQueue;
+  if (hasDedicatedComputeQueue()) {
+    mComputeQueue = std::make_shared<Queue>(*this, mQueueFamilyIndices.compute, 0,
+                                            mQueueFamilyProperties[mQueueFamilyIndices.compute],
+                                            false);
+  }
+  if (hasDedicatedTransferQueue()) {
+    if (mQueueFamilyIndices.transfer == mQueueFamilyIndices.compute && transferQueueIndex == 0) {
+      mTransferQueue = mComputeQueue;
+    } else {
+      mTransferQueue = std::make_shared<Queue>(
+          *this, mQueueFamilyIndices.transfer, transferQueueIndex,
+          mQueueFamilyProperties[mQueueFamilyIndices.transfer], false);
+    }
+  }
 
-  mCommandPool = std::make_unique<CommandPool>(*this, mQueueFamilyIndices.graphics);
+  mCommandPool     = std::make_unique<CommandPool>(*this, mQueueFamilyIndices.graphics);
+  mMemoryAllocator = std::make_unique<MemoryAllocator>(*this);
+  mUploadBatcher   = std::make_unique<UploadBatcher>(*this, STAGING_RING_SIZE, *mGraphicsQueue);
+  if (hasDedicatedTransferQueue()) {
+    mStreamingBatcher =
+        std::make_unique<UploadBatcher>(*this, STREAMING_RING_SIZE, *mTransferQueue);
+  }
+  mPipelineCache   = std::make_unique<PipelineCache>(*this, PIPELINE_CACHE_PATH);
+  mShaderLibrary   = std::make_unique<ShaderLibrary>(*this);
 }
 
 Device::~Device() {
   log_func;
+  mShaderLibrary.reset();
+  mPipelineCache.reset();
   mCommandPool.reset();
+  mStreamingBatcher.reset();
+  mUploadBatcher.reset();
+  mMemoryAllocator.reset();
   vkDestroyDevice(mHandle, nullptr);
 }
 
@@ -121,25 +239,21 @@ VkCommandBuffer Device::createCommandBuffer(VkCommandBufferLevel level, bool beg
   return commandBuffer;
 }
 
-void Device::flushCommandBuffer(VkCommandBuffer commandBuffer, VkQueue queue, bool free,
+void Device::flushCommandBuffer(VkCommandBuffer commandBuffer, const Queue &queue, bool free,
                                 VkSemaphore signalSemaphore) {
   vkOK(vkEndCommandBuffer(commandBuffer));
 
-  VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
-  submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers    = &commandBuffer;
-  if (signalSemaphore) {
-    submitInfo.pSignalSemaphores    = &signalSemaphore;
-    submitInfo.signalSemaphoreCount = 1;
-  }
-
   // Create fence to ensure that the command buffer has finished executing
   VkFenceCreateInfo fenceCreateInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
   VkFence           fence;
   vkOK(vkCreateFence(mHandle, &fenceCreateInfo, nullptr, &fence));
 
   // Submit to the queue
-  vkOK(vkQueueSubmit(queue, 1, &submitInfo, fence));
+  std::vector<VkSemaphore> signalSemaphores;
+  if (signalSemaphore) {
+    signalSemaphores.push_back(signalSemaphore);
+  }
+  vkOK(queue.submit({commandBuffer}, {}, signalSemaphores, fence));
   // Wait for the fence to signal that command buffer has finished executing
   vkOK(vkWaitForFences(mHandle, 1, &fence, VK_TRUE, FENCE_DEFAULT_TIMEOUT));
 
@@ -1,9 +1,90 @@
 #include "FileSystem.h"
 
 #include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace filesystem {
 
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string &filename) {
+  mFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                      FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (mFile == INVALID_HANDLE_VALUE) {
+    mFile = nullptr;
+    throw std::runtime_error("Failed to open file: " + filename);
+  }
+
+  LARGE_INTEGER size;
+  GetFileSizeEx(mFile, &size);
+  mSize = static_cast<size_t>(size.QuadPart);
+  // Empty files can't be mapped
+  if (mSize == 0) {
+    return;
+  }
+
+  mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mMapping == nullptr) {
+    CloseHandle(mFile);
+    throw std::runtime_error("Failed to map file: " + filename);
+  }
+  mData = static_cast<const uint8_t *>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+  if (mData == nullptr) {
+    CloseHandle(mMapping);
+    CloseHandle(mFile);
+    throw std::runtime_error("Failed to map file: " + filename);
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (mData) {
+    UnmapViewOfFile(mData);
+  }
+  if (mMapping) {
+    CloseHandle(mMapping);
+  }
+  if (mFile) {
+    CloseHandle(mFile);
+  }
+}
+#else
+MappedFile::MappedFile(const std::string &filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to open file: " + filename);
+  }
+
+  struct stat status {};
+  fstat(fd, &status);
+  mSize = static_cast<size_t>(status.st_size);
+  // Empty files can't be mapped
+  if (mSize > 0) {
+    void *data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("Failed to map file: " + filename);
+    }
+    mData = static_cast<const uint8_t *>(data);
+  }
+  // The mapping holds a reference to the file of its own
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (mData) {
+    munmap(const_cast<uint8_t *>(mData), mSize);
+  }
+}
+#endif
+
 std::vector<uint8_t> read(const std::string &filename) { return read(filename, 0); }
 
 std::vector<uint8_t> read(const std::string &filename, const uint32_t count) {
@@ -0,0 +1,138 @@
+#include "FrameScheduler.h"
+#include "Device.h"
+#include "Log.h"
+#include "Macros.h"
+#include "Profiler.h"
+
+FrameScheduler::FrameScheduler(const std::shared_ptr<Device> &device, uint32_t framesInFlight,
+                               uint32_t recordingThreadCount)
+    : mDevice{device} {
+  if (framesInFlight == 0) {
+    throw std::runtime_error("At least one frame must be in flight");
+  }
+
+  mFrames.resize(framesInFlight);
+  for (auto &frame : mFrames) {
+    initFrame(frame, recordingThreadCount);
+  }
+}
+
+FrameScheduler::~FrameScheduler() {
+  log_func;
+
+  vkOK(mDevice->waitIdle());
+
+  for (auto &frame : mFrames) {
+    vkDestroySemaphore(mDevice->getHandle(), frame.releasedSemaphore, nullptr);
+    vkDestroySemaphore(mDevice->getHandle(), frame.acquiredSemaphore, nullptr);
+    vkFreeCommandBuffers(mDevice->getHandle(), frame.primaryCommandPool, 1,
+                         &frame.primaryCommandBuffer);
+    vkDestroyCommandPool(mDevice->getHandle(), frame.primaryCommandPool, nullptr);
+    // Frees the secondary command buffers along
+    for (auto commandPool : frame.secondaryCommandPools) {
+      vkDestroyCommandPool(mDevice->getHandle(), commandPool, nullptr);
+    }
+    if (frame.computeCommandPool != VK_NULL_HANDLE) {
+      vkDestroySemaphore(mDevice->getHandle(), frame.uploadSemaphore, nullptr);
+      vkDestroySemaphore(mDevice->getHandle(), frame.computeSemaphore, nullptr);
+      vkDestroyCommandPool(mDevice->getHandle(), frame.computeCommandPool, nullptr);
+    }
+    vkDestroyFence(mDevice->getHandle(), frame.queueSubmittedFence, nullptr);
+  }
+}
+
+void FrameScheduler::initFrame(Frame &frame, uint32_t recordingThreadCount) {
+  // Created signaled so that the very first wait on each frame returns immediately
+  VkFenceCreateInfo fenceCreateInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+  fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+  vkOK(vkCreateFence(mDevice->getHandle(), &fenceCreateInfo, nullptr, &frame.queueSubmittedFence));
+
+  VkSemaphoreCreateInfo semaphoreCreateInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+  vkOK(vkCreateSemaphore(mDevice->getHandle(), &semaphoreCreateInfo, nullptr,
+                         &frame.acquiredSemaphore));
+  vkOK(vkCreateSemaphore(mDevice->getHandle(), &semaphoreCreateInfo, nullptr,
+                         &frame.releasedSemaphore));
+
+  VkCommandPoolCreateInfo commandPoolCreateInfo{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+  commandPoolCreateInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = mDevice->getQueueFamilyIndices().graphics;
+  vkOK(vkCreateCommandPool(mDevice->getHandle(), &commandPoolCreateInfo, nullptr,
+                           &frame.primaryCommandPool));
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo{
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+  commandBufferAllocateInfo.commandPool        = frame.primaryCommandPool;
+  commandBufferAllocateInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  vkOK(vkAllocateCommandBuffers(mDevice->getHandle(), &commandBufferAllocateInfo,
+                                &frame.primaryCommandBuffer));
+
+  frame.secondaryCommandPools.resize(recordingThreadCount);
+  frame.secondaryCommandBuffers.resize(recordingThreadCount);
+  commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+  for (uint32_t i = 0; i < recordingThreadCount; ++i) {
+    vkOK(vkCreateCommandPool(mDevice->getHandle(), &commandPoolCreateInfo, nullptr,
+                             &frame.secondaryCommandPools[i]));
+    commandBufferAllocateInfo.commandPool = frame.secondaryCommandPools[i];
+    vkOK(vkAllocateCommandBuffers(mDevice->getHandle(), &commandBufferAllocateInfo,
+                                  &frame.secondaryCommandBuffers[i]));
+  }
+
+  if (mDevice->hasDedicatedComputeQueue()) {
+    commandPoolCreateInfo.queueFamilyIndex = mDevice->getQueueFamilyIndices().compute;
+    vkOK(vkCreateCommandPool(mDevice->getHandle(), &commandPoolCreateInfo, nullptr,
+                             &frame.computeCommandPool));
+    commandBufferAllocateInfo.commandPool = frame.computeCommandPool;
+    commandBufferAllocateInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    vkOK(vkAllocateCommandBuffers(mDevice->getHandle(), &commandBufferAllocateInfo,
+                                  &frame.computeCommandBuffer));
+    vkOK(vkCreateSemaphore(mDevice->getHandle(), &semaphoreCreateInfo, nullptr,
+                           &frame.computeSemaphore));
+    vkOK(vkCreateSemaphore(mDevice->getHandle(), &semaphoreCreateInfo, nullptr,
+                           &frame.uploadSemaphore));
+  }
+}
+
+FrameScheduler::Frame &FrameScheduler::beginFrame() {
+  PROFILE_FUNCTION();
+  auto &frame = mFrames[mFrameIndex];
+
+  // The fence is only reset right before the next submission, so that a frame which is skipped
+  // (e.g. the swapchain is out of date) doesn't deadlock the next wait.
+  auto waitTime = std::chrono::steady_clock::now();
+  vkOK(vkWaitForFences(mDevice->getHandle(), 1, &frame.queueSubmittedFence, VK_TRUE,
+                       UINT64_MAX));
+  mWaitMilliseconds =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitTime)
+          .count();
+
+  vkOK(vkResetCommandPool(mDevice->getHandle(), frame.primaryCommandPool, 0));
+  for (auto commandPool : frame.secondaryCommandPools) {
+    vkOK(vkResetCommandPool(mDevice->getHandle(), commandPool, 0));
+  }
+  // The graphics work of the frame waited for its compute work
+  if (frame.computeCommandPool != VK_NULL_HANDLE) {
+    vkOK(vkResetCommandPool(mDevice->getHandle(), frame.computeCommandPool, 0));
+  }
+
+  return frame;
+}
+
+void FrameScheduler::endFrame() { mFrameIndex = (mFrameIndex + 1) % mFrames.size(); }
+
+void FrameScheduler::bindImage(uint32_t imageIndex) {
+  if (imageIndex >= mImageFences.size()) {
+    mImageFences.resize(imageIndex + 1, VK_NULL_HANDLE);
+  }
+
+  auto &fence = mImageFences[imageIndex];
+  auto &frame = mFrames[mFrameIndex];
+  if (fence != VK_NULL_HANDLE && fence != frame.queueSubmittedFence) {
+    vkOK(vkWaitForFences(mDevice->getHandle(), 1, &fence, VK_TRUE, UINT64_MAX));
+  }
+  fence = frame.queueSubmittedFence;
+}
+
+void FrameScheduler::resetImages(uint32_t imageCount) {
+  mImageFences.assign(imageCount, VK_NULL_HANDLE);
+}
@@ -0,0 +1,97 @@
+#include "Frustum.h"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+Frustum::Frustum(const Camera &camera)
+    : Frustum(camera.getProjectionMatrix() * camera.getViewMatrix()) {}
+
+Frustum::Frustum(const glm::mat4 &viewProjection) {
+  // Gribb and Hartmann: each plane is a sum or difference of the rows of the matrix, where clip
+  // space is -w <= x, y <= w and 0 <= z <= w
+  auto row = [&](int i) {
+    return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i],
+                     viewProjection[3][i]);
+  };
+  const glm::vec4 planes[6] = {
+      row(3) + row(0), row(3) - row(0), row(3) + row(1),
+      row(3) - row(1), row(2),          row(3) - row(2),
+  };
+
+  for (int i = 0; i < 6; ++i) {
+    // Normalized so that the distance to the plane can be compared with a radius
+    auto length = glm::length(glm::vec3(planes[i]));
+    mA[i]       = planes[i].x / length;
+    mB[i]       = planes[i].y / length;
+    mC[i]       = planes[i].z / length;
+    mD[i]       = planes[i].w / length;
+  }
+}
+
+uint32_t Frustum::cullSpheres(const float *x, const float *y, const float *z, const float *radius,
+                              size_t count, uint8_t *visible) const {
+  uint32_t visibleCount = 0;
+  size_t   i            = 0;
+
+  // A sphere is visible unless it is entirely behind one of the planes
+#if defined(__AVX__)
+  for (; i + 8 <= count; i += 8) {
+    auto centerX   = _mm256_loadu_ps(x + i);
+    auto centerY   = _mm256_loadu_ps(y + i);
+    auto centerZ   = _mm256_loadu_ps(z + i);
+    auto minusR    = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(radius + i));
+    auto isVisible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (int j = 0; j < 6; ++j) {
+      auto distance = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(centerX, _mm256_set1_ps(mA[j])),
+                        _mm256_mul_ps(centerY, _mm256_set1_ps(mB[j]))),
+          _mm256_add_ps(_mm256_mul_ps(centerZ, _mm256_set1_ps(mC[j])), _mm256_set1_ps(mD[j])));
+      isVisible = _mm256_and_ps(isVisible, _mm256_cmp_ps(distance, minusR, _CMP_GE_OQ));
+    }
+
+    auto mask = _mm256_movemask_ps(isVisible);
+    for (int k = 0; k < 8; ++k) {
+      visible[i + k] = (mask >> k) & 1;
+      visibleCount += (mask >> k) & 1;
+    }
+  }
+#elif defined(__SSE2__) || defined(_M_X64)
+  for (; i + 4 <= count; i += 4) {
+    auto centerX   = _mm_loadu_ps(x + i);
+    auto centerY   = _mm_loadu_ps(y + i);
+    auto centerZ   = _mm_loadu_ps(z + i);
+    auto minusR    = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+    auto isVisible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (int j = 0; j < 6; ++j) {
+      auto distance =
+          _mm_add_ps(_mm_add_ps(_mm_mul_ps(centerX, _mm_set1_ps(mA[j])),
+                                _mm_mul_ps(centerY, _mm_set1_ps(mB[j]))),
+                     _mm_add_ps(_mm_mul_ps(centerZ, _mm_set1_ps(mC[j])), _mm_set1_ps(mD[j])));
+      isVisible = _mm_and_ps(isVisible, _mm_cmpge_ps(distance, minusR));
+    }
+
+    auto mask = _mm_movemask_ps(isVisible);
+    for (int k = 0; k < 4; ++k) {
+      visible[i + k] = (mask >> k) & 1;
+      visibleCount += (mask >> k) & 1;
+    }
+  }
+#endif
+
+  // Remaining spheres, in the same order of operations as above
+  for (; i < count; ++i) {
+    bool isVisible = true;
+    for (int j = 0; j < 6; ++j) {
+      auto distance = (x[i] * mA[j] + y[i] * mB[j]) + (z[i] * mC[j] + mD[j]);
+      isVisible     = isVisible && distance >= -radius[i];
+    }
+    visible[i] = isVisible;
+    visibleCount += isVisible;
+  }
+  return visibleCount;
+}
@@ -0,0 +1,772 @@
+#include "FileSystem.h"
+#include "Log.h"
+#include "MeshImporter.h"
+#include "Vertex.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <functional>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Number of vertices or indices converted at once by a thread
+#define GLTF_PIECE_SIZE (64 * 1024)
+
+#define GLB_MAGIC 0x46546C67u
+#define GLB_CHUNK_JSON 0x4E4F534Au
+#define GLB_CHUNK_BIN 0x004E4942u
+
+#define GLTF_BYTE 5120
+#define GLTF_UNSIGNED_BYTE 5121
+#define GLTF_SHORT 5122
+#define GLTF_UNSIGNED_SHORT 5123
+#define GLTF_UNSIGNED_INT 5125
+#define GLTF_FLOAT 5126
+#define GLTF_TRIANGLES 4
+
+namespace {
+
+// Just enough of a JSON document model to walk a glTF file
+struct Json {
+  enum class Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+  Type                                      type    = Type::NUL;
+  bool                                      boolean = false;
+  double                                    number  = 0.0;
+  std::string                               string;
+  std::vector<Json>                         array;
+  std::vector<std::pair<std::string, Json>> object;
+
+  [[nodiscard]] const Json *find(const char *key) const {
+    for (const auto &[name, value] : object) {
+      if (name == key) {
+        return &value;
+      }
+    }
+    return nullptr;
+  }
+
+  [[nodiscard]] const Json &at(const char *key) const {
+    if (auto value = find(key)) {
+      return *value;
+    }
+    throw std::runtime_error(fmt::format("Missing glTF property: {}", key));
+  }
+
+  [[nodiscard]] const Json &at(size_t index) const {
+    if (index >= array.size()) {
+      throw std::runtime_error(fmt::format("Out of range glTF index: {}", index));
+    }
+    return array[index];
+  }
+
+  [[nodiscard]] double getNumber(const char *key, double fallback) const {
+    auto value = find(key);
+    return value ? value->number : fallback;
+  }
+};
+
+class JsonParser {
+public:
+  JsonParser(const char *begin, const char *end) : mPos{begin}, mEnd{end} {}
+
+  Json parse() {
+    auto value = parseValue(0);
+    skipWhitespace();
+    if (mPos != mEnd) {
+      error("trailing characters");
+    }
+    return value;
+  }
+
+private:
+  // Guards against stack overflows on malicious input
+  static constexpr uint32_t MAX_DEPTH = 256;
+
+  [[noreturn]] static void error(const char *what) {
+    throw std::runtime_error(fmt::format("Invalid glTF JSON: {}", what));
+  }
+
+  void skipWhitespace() {
+    while (mPos < mEnd && (*mPos == ' ' || *mPos == '\t' || *mPos == '\n' || *mPos == '\r')) {
+      ++mPos;
+    }
+  }
+
+  bool consume(const char *literal) {
+    auto length = strlen(literal);
+    if (static_cast<size_t>(mEnd - mPos) >= length && memcmp(mPos, literal, length) == 0) {
+      mPos += length;
+      return true;
+    }
+    return false;
+  }
+
+  Json parseValue(uint32_t depth) {
+    if (depth > MAX_DEPTH) {
+      error("nested too deeply");
+    }
+
+    skipWhitespace();
+    if (mPos == mEnd) {
+      error("unexpected end");
+    }
+
+    Json value;
+    switch (*mPos) {
+    case '{':
+      value.type = Json::Type::OBJECT;
+      ++mPos;
+      skipWhitespace();
+      if (consume("}")) {
+        break;
+      }
+      do {
+        skipWhitespace();
+        auto key = parseString();
+        skipWhitespace();
+        if (!consume(":")) {
+          error("expected ':'");
+        }
+        value.object.emplace_back(std::move(key), parseValue(depth + 1));
+        skipWhitespace();
+      } while (consume(","));
+      if (!consume("}")) {
+        error("expected '}'");
+      }
+      break;
+    case '[':
+      value.type = Json::Type::ARRAY;
+      ++mPos;
+      skipWhitespace();
+      if (consume("]")) {
+        break;
+      }
+      do {
+        value.array.push_back(parseValue(depth + 1));
+        skipWhitespace();
+      } while (consume(","));
+      if (!consume("]")) {
+        error("expected ']'");
+      }
+      break;
+    case '"':
+      value.type   = Json::Type::STRING;
+      value.string = parseString();
+      break;
+    case 't':
+    case 'f':
+      value.type    = Json::Type::BOOLEAN;
+      value.boolean = consume("true");
+      if (!value.boolean && !consume("false")) {
+        error("invalid literal");
+      }
+      break;
+    case 'n':
+      if (!consume("null")) {
+        error("invalid literal");
+      }
+      break;
+    default:
+      value.type   = Json::Type::NUMBER;
+      value.number = parseNumber();
+      break;
+    }
+    return value;
+  }
+
+  std::string parseString() {
+    if (!consume("\"")) {
+      error("expected string");
+    }
+
+    std::string string;
+    while (mPos < mEnd && *mPos != '"') {
+      auto c = *mPos++;
+      if (c != '\\') {
+        string += c;
+        continue;
+      }
+      if (mPos == mEnd) {
+        break;
+      }
+      switch (auto escaped = *mPos++) {
+      case 'b':
+        string += '\b';
+        break;
+      case 'f':
+        string += '\f';
+        break;
+      case 'n':
+        string += '\n';
+        break;
+      case 'r':
+        string += '\r';
+        break;
+      case 't':
+        string += '\t';
+        break;
+      case 'u':
+        appendUtf8(string, parseCodePoint());
+        break;
+      default:
+        // '"', '\\' and '/' stand for themselves
+        string += escaped;
+        break;
+      }
+    }
+    if (!consume("\"")) {
+      error("unterminated string");
+    }
+    return string;
+  }
+
+  uint32_t parseHex4() {
+    if (mEnd - mPos < 4) {
+      error("invalid unicode escape");
+    }
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+      auto c = *mPos++;
+      value <<= 4;
+      if (c >= '0' && c <= '9') {
+        value |= c - '0';
+      } else if (c >= 'a' && c <= 'f') {
+        value |= c - 'a' + 10;
+      } else if (c >= 'A' && c <= 'F') {
+        value |= c - 'A' + 10;
+      } else {
+        error("invalid unicode escape");
+      }
+    }
+    return value;
+  }
+
+  uint32_t parseCodePoint() {
+    auto codePoint = parseHex4();
+    // Characters outside of the basic plane are escaped as surrogate pairs
+    if (codePoint >= 0xD800 && codePoint < 0xDC00 && consume("\\u")) {
+      auto low  = parseHex4();
+      codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+    }
+    return codePoint;
+  }
+
+  static void appendUtf8(std::string &string, uint32_t codePoint) {
+    if (codePoint < 0x80) {
+      string += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+      string += static_cast<char>(0xC0 | (codePoint >> 6));
+      string += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+      string += static_cast<char>(0xE0 | (codePoint >> 12));
+      string += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+      string += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else {
+      string += static_cast<char>(0xF0 | (codePoint >> 18));
+      string += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+      string += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+      string += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+  }
+
+  double parseNumber() {
+    auto begin = mPos;
+    while (mPos < mEnd && (isdigit(*mPos) || *mPos == '-' || *mPos == '+' || *mPos == '.' ||
+                           *mPos == 'e' || *mPos == 'E')) {
+      ++mPos;
+    }
+    if (begin == mPos) {
+      error("unexpected character");
+    }
+
+    std::string token(begin, mPos);
+    char       *tokenEnd;
+    auto        number = std::strtod(token.c_str(), &tokenEnd);
+    if (tokenEnd != token.c_str() + token.size()) {
+      error("invalid number");
+    }
+    return number;
+  }
+
+  const char *mPos;
+  const char *mEnd;
+};
+
+struct BufferData {
+  const uint8_t *data = nullptr;
+  size_t         size = 0;
+};
+
+// A typed view of buffer data
+struct Accessor {
+  const uint8_t *data           = nullptr;
+  size_t         stride         = 0;
+  uint32_t       count          = 0;
+  uint32_t       componentType  = 0;
+  uint32_t       componentCount = 0;
+  bool           normalized     = false;
+};
+
+// A triangle primitive to be merged, with where its vertices and indices go
+struct Primitive {
+  glm::mat4 matrix;
+  Accessor  positions;
+  Accessor  colors;
+  Accessor  indices;
+  uint64_t  vertexBase = 0;
+  uint64_t  indexBase  = 0;
+  uint32_t  indexCount = 0;
+};
+
+// A range of vertices or indices of a primitive, converted by a single thread
+struct Piece {
+  size_t    primitive;
+  uint32_t  first;
+  uint32_t  count;
+  // Bounds of the vertices of the piece, once converted
+  glm::vec3 boundsMin{FLT_MAX};
+  glm::vec3 boundsMax{-FLT_MAX};
+};
+
+std::vector<uint8_t> decodeBase64(const char *begin, const char *end) {
+  auto decode = [](char c) -> int {
+    if (c >= 'A' && c <= 'Z') {
+      return c - 'A';
+    }
+    if (c >= 'a' && c <= 'z') {
+      return c - 'a' + 26;
+    }
+    if (c >= '0' && c <= '9') {
+      return c - '0' + 52;
+    }
+    // Either the standard or the URL safe alphabet
+    if (c == '+' || c == '-') {
+      return 62;
+    }
+    if (c == '/' || c == '_') {
+      return 63;
+    }
+    return -1;
+  };
+
+  std::vector<uint8_t> data;
+  data.reserve((end - begin) / 4 * 3);
+  uint32_t bits = 0, bitCount = 0;
+  for (auto p = begin; p < end && *p != '='; ++p) {
+    auto value = decode(*p);
+    if (value < 0) {
+      throw std::runtime_error("Invalid base64 data in glTF buffer");
+    }
+    bits = (bits << 6) | value;
+    if ((bitCount += 6) >= 8) {
+      bitCount -= 8;
+      data.push_back(static_cast<uint8_t>(bits >> bitCount));
+    }
+  }
+  return data;
+}
+
+std::string decodeUri(const std::string &uri) {
+  std::string path;
+  for (size_t i = 0; i < uri.size(); ++i) {
+    if (uri[i] == '%' && i + 2 < uri.size()) {
+      path += static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16));
+      i += 2;
+    } else {
+      path += uri[i];
+    }
+  }
+  return path;
+}
+
+uint32_t getComponentCount(const std::string &type) {
+  if (type == "SCALAR") {
+    return 1;
+  }
+  if (type == "VEC2") {
+    return 2;
+  }
+  if (type == "VEC3") {
+    return 3;
+  }
+  if (type == "VEC4") {
+    return 4;
+  }
+  throw std::runtime_error("Unsupported glTF accessor type: " + type);
+}
+
+uint32_t getComponentSize(uint32_t componentType) {
+  switch (componentType) {
+  case GLTF_BYTE:
+  case GLTF_UNSIGNED_BYTE:
+    return 1;
+  case GLTF_SHORT:
+  case GLTF_UNSIGNED_SHORT:
+    return 2;
+  case GLTF_UNSIGNED_INT:
+  case GLTF_FLOAT:
+    return 4;
+  default:
+    throw std::runtime_error(fmt::format("Unsupported glTF component type: {}", componentType));
+  }
+}
+
+Accessor getAccessor(const Json &gltf, size_t index, const std::vector<BufferData> &buffers) {
+  const auto &json = gltf.at("accessors").at(index);
+  if (json.find("sparse") || !json.find("bufferView")) {
+    throw std::runtime_error("Unsupported sparse glTF accessor");
+  }
+
+  Accessor accessor;
+  accessor.count          = static_cast<uint32_t>(json.at("count").number);
+  accessor.componentType  = static_cast<uint32_t>(json.at("componentType").number);
+  accessor.componentCount = getComponentCount(json.at("type").string);
+  if (auto normalized = json.find("normalized")) {
+    accessor.normalized = normalized->boolean;
+  }
+
+  const auto &view = gltf.at("bufferViews").at(static_cast<size_t>(json.at("bufferView").number));
+  const auto &buffer      = buffers.at(static_cast<size_t>(view.at("buffer").number));
+  auto        elementSize = getComponentSize(accessor.componentType) * accessor.componentCount;
+  auto        viewOffset  = static_cast<size_t>(view.getNumber("byteOffset", 0));
+  auto        viewLength  = static_cast<size_t>(view.at("byteLength").number);
+  auto        offset      = static_cast<size_t>(json.getNumber("byteOffset", 0));
+  accessor.stride         = static_cast<size_t>(view.getNumber("byteStride", elementSize));
+
+  // Every element must lie within the view, and the view within the buffer
+  if (viewOffset + viewLength > buffer.size ||
+      (accessor.count > 0 &&
+       offset + accessor.stride * (accessor.count - 1) + elementSize > viewLength)) {
+    throw std::runtime_error("Out of bounds glTF accessor");
+  }
+  accessor.data = buffer.data + viewOffset + offset;
+  return accessor;
+}
+
+float readComponent(const uint8_t *data, uint32_t componentType, bool normalized) {
+  switch (componentType) {
+  case GLTF_FLOAT: {
+    float value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+  }
+  case GLTF_UNSIGNED_BYTE:
+    return normalized ? data[0] / 255.0f : data[0];
+  case GLTF_BYTE: {
+    auto value = static_cast<int8_t>(data[0]);
+    return normalized ? std::max(value / 127.0f, -1.0f) : value;
+  }
+  case GLTF_UNSIGNED_SHORT: {
+    uint16_t value;
+    memcpy(&value, data, sizeof(value));
+    return normalized ? value / 65535.0f : value;
+  }
+  case GLTF_SHORT: {
+    int16_t value;
+    memcpy(&value, data, sizeof(value));
+    return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+  }
+  default:
+    throw std::runtime_error(fmt::format("Unsupported glTF component type: {}", componentType));
+  }
+}
+
+uint32_t readIndex(const uint8_t *data, uint32_t componentType) {
+  switch (componentType) {
+  case GLTF_UNSIGNED_BYTE:
+    return data[0];
+  case GLTF_UNSIGNED_SHORT: {
+    uint16_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+  }
+  case GLTF_UNSIGNED_INT: {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+  }
+  default:
+    throw std::runtime_error(fmt::format("Unsupported glTF index type: {}", componentType));
+  }
+}
+
+glm::vec3 getVec3(const Json &json) {
+  return {static_cast<float>(json.at(size_t{0}).number), static_cast<float>(json.at(1).number),
+          static_cast<float>(json.at(2).number)};
+}
+
+glm::mat4 getLocalMatrix(const Json &node) {
+  glm::mat4 matrix(1.0f);
+  if (auto values = node.find("matrix")) {
+    // Column major, as glm
+    for (size_t i = 0; i < 16; ++i) {
+      matrix[i / 4][i % 4] = static_cast<float>(values->at(i).number);
+    }
+    return matrix;
+  }
+
+  if (auto translation = node.find("translation")) {
+    matrix = glm::translate(matrix, getVec3(*translation));
+  }
+  if (auto rotation = node.find("rotation")) {
+    // Stored as x, y, z, w
+    auto axis = getVec3(*rotation);
+    auto w    = static_cast<float>(rotation->at(3).number);
+    matrix    = matrix * glm::mat4_cast(glm::quat(w, axis.x, axis.y, axis.z));
+  }
+  if (auto scale = node.find("scale")) {
+    matrix = glm::scale(matrix, getVec3(*scale));
+  }
+  return matrix;
+}
+
+} // namespace
+
+void MeshImporter::importGltf(const std::string &path, Target &target) {
+  filesystem::MappedFile file(path);
+  auto                   directory = path.substr(0, path.find_last_of("/\\") + 1);
+
+  // Binary glTF holds the JSON and the first buffer in chunks of the same file
+  BufferData binaryChunk;
+  auto       jsonBegin = reinterpret_cast<const char *>(file.data());
+  auto       jsonEnd   = jsonBegin + file.size();
+  uint32_t   magic     = 0;
+  if (file.size() >= 12) {
+    memcpy(&magic, file.data(), sizeof(magic));
+  }
+  if (magic == GLB_MAGIC) {
+    jsonBegin = jsonEnd = nullptr;
+    for (size_t offset = 12; offset + 8 <= file.size();) {
+      uint32_t chunkHeader[2];
+      memcpy(chunkHeader, file.data() + offset, sizeof(chunkHeader));
+      auto [chunkLength, chunkType] = chunkHeader;
+      offset += 8;
+      if (offset + chunkLength > file.size()) {
+        throw std::runtime_error("Truncated glTF binary chunk: " + path);
+      }
+
+      if (chunkType == GLB_CHUNK_JSON) {
+        jsonBegin = reinterpret_cast<const char *>(file.data() + offset);
+        jsonEnd   = jsonBegin + chunkLength;
+      } else if (chunkType == GLB_CHUNK_BIN) {
+        binaryChunk = {file.data() + offset, chunkLength};
+      }
+      offset += chunkLength;
+    }
+    if (jsonBegin == nullptr) {
+      throw std::runtime_error("Missing JSON chunk in glTF binary: " + path);
+    }
+  }
+
+  auto gltf = JsonParser(jsonBegin, jsonEnd).parse();
+
+  // Buffers are embedded as base64 data URIs, external files which are mapped as well, or the
+  // binary chunk
+  std::vector<BufferData>                              buffers;
+  std::vector<std::vector<uint8_t>>                    decodedBuffers;
+  std::vector<std::unique_ptr<filesystem::MappedFile>> mappedBuffers;
+  if (auto jsonBuffers = gltf.find("buffers")) {
+    for (const auto &jsonBuffer : jsonBuffers->array) {
+      auto uri = jsonBuffer.find("uri");
+      if (uri == nullptr) {
+        buffers.push_back(binaryChunk);
+      } else if (uri->string.compare(0, 5, "data:") == 0) {
+        auto comma = uri->string.find(";base64,");
+        if (comma == std::string::npos) {
+          throw std::runtime_error("Unsupported glTF data URI: " + path);
+        }
+        auto data = uri->string.data();
+        decodedBuffers.push_back(decodeBase64(data + comma + 8, data + uri->string.size()));
+        buffers.push_back({decodedBuffers.back().data(), decodedBuffers.back().size()});
+      } else {
+        mappedBuffers.push_back(
+            std::make_unique<filesystem::MappedFile>(directory + decodeUri(uri->string)));
+        buffers.push_back({mappedBuffers.back()->data(), mappedBuffers.back()->size()});
+      }
+    }
+  }
+
+  // Gather the triangle primitives of the scene, along with their world matrix
+  std::vector<Primitive> primitives;
+  const auto            &nodes = gltf.at("nodes");
+
+  std::function<void(size_t, const glm::mat4 &, uint32_t)> visit =
+      [&](size_t index, const glm::mat4 &parentMatrix, uint32_t depth) {
+        // A node can't be its own ancestor, thus depth can't exceed the node count
+        if (depth > nodes.array.size()) {
+          throw std::runtime_error("Cyclic glTF node hierarchy: " + path);
+        }
+
+        const auto &node   = nodes.at(index);
+        auto        matrix = parentMatrix * getLocalMatrix(node);
+        if (auto mesh = node.find("mesh")) {
+          const auto &jsonMesh = gltf.at("meshes").at(static_cast<size_t>(mesh->number));
+          for (const auto &jsonPrimitive : jsonMesh.at("primitives").array) {
+            if (jsonPrimitive.getNumber("mode", GLTF_TRIANGLES) != GLTF_TRIANGLES) {
+              log_warn("Skip non triangle glTF primitive in {}", path);
+              continue;
+            }
+
+            const auto &attributes = jsonPrimitive.at("attributes");
+
+            Primitive primitive;
+            primitive.matrix    = matrix;
+            primitive.positions = getAccessor(
+                gltf, static_cast<size_t>(attributes.at("POSITION").number), buffers);
+            if (primitive.positions.componentCount != 3) {
+              throw std::runtime_error("Invalid glTF positions: " + path);
+            }
+            if (auto colors = attributes.find("COLOR_0")) {
+              primitive.colors = getAccessor(gltf, static_cast<size_t>(colors->number), buffers);
+              if (primitive.colors.count < primitive.positions.count) {
+                throw std::runtime_error("Invalid glTF colors: " + path);
+              }
+            }
+            if (auto indices = jsonPrimitive.find("indices")) {
+              primitive.indices = getAccessor(gltf, static_cast<size_t>(indices->number), buffers);
+            }
+            primitives.push_back(primitive);
+          }
+        }
+
+        if (auto children = node.find("children")) {
+          for (const auto &child : children->array) {
+            visit(static_cast<size_t>(child.number), matrix, depth + 1);
+          }
+        }
+      };
+
+  if (auto scenes = gltf.find("scenes"); scenes && !scenes->array.empty()) {
+    const auto &scene = scenes->at(static_cast<size_t>(gltf.getNumber("scene", 0)));
+    if (auto roots = scene.find("nodes")) {
+      for (const auto &root : roots->array) {
+        visit(static_cast<size_t>(root.number), glm::mat4(1.0f), 0);
+      }
+    }
+  } else {
+    // Without any scene, every node which isn't a child is a root
+    std::vector<bool> isChild(nodes.array.size());
+    for (const auto &node : nodes.array) {
+      if (auto children = node.find("children")) {
+        for (const auto &child : children->array) {
+          isChild.at(static_cast<size_t>(child.number)) = true;
+        }
+      }
+    }
+    for (size_t i = 0; i < nodes.array.size(); ++i) {
+      if (!isChild[i]) {
+        visit(i, glm::mat4(1.0f), 0);
+      }
+    }
+  }
+
+  // Lay the primitives out one after the other, and split them into pieces to convert in
+  // parallel
+  uint64_t           vertexCount = 0, indexCount = 0;
+  std::vector<Piece> vertexPieces, indexPieces;
+  for (size_t i = 0; i < primitives.size(); ++i) {
+    auto &primitive = primitives[i];
+
+    primitive.vertexBase = vertexCount;
+    primitive.indexBase  = indexCount;
+    primitive.indexCount =
+        primitive.indices.data ? primitive.indices.count : primitive.positions.count;
+    // Everything past the import reads whole triangles
+    if (primitive.indexCount % 3 != 0) {
+      throw std::runtime_error(
+          fmt::format("Invalid glTF primitive of {} indices: {}", primitive.indexCount, path));
+    }
+    vertexCount += primitive.positions.count;
+    indexCount += primitive.indexCount;
+
+    for (uint32_t first = 0; first < primitive.positions.count; first += GLTF_PIECE_SIZE) {
+      vertexPieces.push_back(
+          {i, first, std::min<uint32_t>(GLTF_PIECE_SIZE, primitive.positions.count - first)});
+    }
+    for (uint32_t first = 0; first < primitive.indexCount; first += GLTF_PIECE_SIZE) {
+      indexPieces.push_back(
+          {i, first, std::min<uint32_t>(GLTF_PIECE_SIZE, primitive.indexCount - first)});
+    }
+  }
+  if (indexCount == 0) {
+    throw std::runtime_error("No triangle in mesh: " + path);
+  }
+  if (vertexCount > UINT32_MAX || indexCount > UINT32_MAX) {
+    throw std::runtime_error("Too many vertices or indices in mesh: " + path);
+  }
+
+  target.create(static_cast<uint32_t>(vertexCount), static_cast<uint32_t>(indexCount));
+
+  // Convert the vertices into the target
+  std::vector<VkDeviceSize> offsets;
+  for (const auto &piece : vertexPieces) {
+    offsets.push_back((primitives[piece.primitive].vertexBase + piece.first) * sizeof(Vertex));
+  }
+  offsets.push_back(vertexCount * sizeof(Vertex));
+  target.write(Stream::VERTEX, offsets, [&](size_t i, void *data) {
+    auto       &piece     = vertexPieces[i];
+    const auto &primitive = primitives[piece.primitive];
+    const auto &positions = primitive.positions;
+    const auto &colors    = primitive.colors;
+    auto        vertex    = static_cast<Vertex *>(data);
+    for (uint32_t j = piece.first; j < piece.first + piece.count; ++j) {
+      glm::vec3 position;
+      auto      data = positions.data + positions.stride * j;
+      auto      size = getComponentSize(positions.componentType);
+      for (int k = 0; k < 3; ++k) {
+        position[k] = readComponent(data + size * k, positions.componentType, positions.normalized);
+      }
+
+      glm::vec3 color = DEFAULT_COLOR;
+      if (colors.data) {
+        data = colors.data + colors.stride * j;
+        size = getComponentSize(colors.componentType);
+        for (int k = 0; k < 3; ++k) {
+          color[k] = readComponent(data + size * k, colors.componentType, colors.normalized);
+        }
+      }
+
+      position        = glm::vec3(primitive.matrix * glm::vec4(position, 1.0f));
+      piece.boundsMin = glm::min(piece.boundsMin, position);
+      piece.boundsMax = glm::max(piece.boundsMax, position);
+      *vertex++       = {position, color};
+    }
+  });
+
+  // Convert the indices into the target, offset by the vertices of the previous primitives
+  offsets.clear();
+  for (const auto &piece : indexPieces) {
+    offsets.push_back((primitives[piece.primitive].indexBase + piece.first) * sizeof(uint32_t));
+  }
+  offsets.push_back(indexCount * sizeof(uint32_t));
+  target.write(Stream::INDEX, offsets, [&](size_t i, void *data) {
+    const auto &piece     = indexPieces[i];
+    const auto &primitive = primitives[piece.primitive];
+    const auto &indices   = primitive.indices;
+    auto        index     = static_cast<uint32_t *>(data);
+    for (uint32_t j = piece.first; j < piece.first + piece.count; ++j) {
+      auto vertex =
+          indices.data ? readIndex(indices.data + indices.stride * j, indices.componentType) : j;
+      if (vertex >= primitive.positions.count) {
+        throw std::runtime_error(fmt::format("Invalid vertex index {} in mesh {}", vertex, path));
+      }
+      *index++ = static_cast<uint32_t>(primitive.vertexBase + vertex);
+    }
+  });
+
+  // Each primitive makes a submesh, bounded by its pieces
+  std::vector<Submesh> submeshes;
+  for (const auto &primitive : primitives) {
+    submeshes.push_back({static_cast<uint32_t>(primitive.indexBase), primitive.indexCount,
+                         glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)});
+  }
+  for (const auto &piece : vertexPieces) {
+    auto &submesh     = submeshes[piece.primitive];
+    submesh.boundsMin = glm::min(submesh.boundsMin, piece.boundsMin);
+    submesh.boundsMax = glm::max(submesh.boundsMax, piece.boundsMax);
+  }
+  target.setSubmeshes(std::move(submeshes));
+}
@@ -0,0 +1,137 @@
+#include "GpuProfiler.h"
+#include "Device.h"
+#include "Log.h"
+#include "Macros.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Counted by the statistics queries, in the order of GpuProfiler::Statistics which is the one of
+// the bits
+constexpr VkQueryPipelineStatisticFlags STATISTICS_FLAGS =
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+} // namespace
+
+GpuProfiler::GpuProfiler(const std::shared_ptr<Device> &device, uint32_t framesInFlight,
+                         uint32_t maxScopeCount)
+    : mDevice{device}, mMaxScopeCount{maxScopeCount},
+      mSupportsStatistics{device->supportsPipelineStatistics()} {
+  auto validBits = device->getGraphicsQueue().getProperties().timestampValidBits;
+  if (validBits == 0) {
+    throw std::runtime_error("The graphics queue doesn't support timestamps");
+  }
+  mTimestampMask   = validBits >= 64 ? UINT64_MAX : (uint64_t{1} << validBits) - 1;
+  mTimestampPeriod = device->getPhysicalDevice()->getProperties().limits.timestampPeriod;
+
+  // Each scope begins and ends with a timestamp
+  VkQueryPoolCreateInfo timestampPoolCreateInfo{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+  timestampPoolCreateInfo.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+  timestampPoolCreateInfo.queryCount = 2 * maxScopeCount;
+
+  VkQueryPoolCreateInfo statisticsPoolCreateInfo{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+  statisticsPoolCreateInfo.queryType          = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+  statisticsPoolCreateInfo.queryCount         = maxScopeCount;
+  statisticsPoolCreateInfo.pipelineStatistics = STATISTICS_FLAGS;
+
+  for (uint32_t i = 0; i < framesInFlight; ++i) {
+    auto frame = std::make_unique<Frame>();
+    vkOK(vkCreateQueryPool(device->getHandle(), &timestampPoolCreateInfo, nullptr,
+                           &frame->timestampPool));
+    if (mSupportsStatistics) {
+      vkOK(vkCreateQueryPool(device->getHandle(), &statisticsPoolCreateInfo, nullptr,
+                             &frame->statisticsPool));
+    }
+    frame->scopes.resize(maxScopeCount);
+    mFrames.push_back(std::move(frame));
+  }
+}
+
+GpuProfiler::~GpuProfiler() {
+  log_func;
+
+  for (const auto &frame : mFrames) {
+    vkDestroyQueryPool(mDevice->getHandle(), frame->timestampPool, nullptr);
+    if (frame->statisticsPool != VK_NULL_HANDLE) {
+      vkDestroyQueryPool(mDevice->getHandle(), frame->statisticsPool, nullptr);
+    }
+  }
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+  auto &frame      = *mFrames[frameIndex];
+  auto  scopeCount = std::min(frame.scopeCount.load(std::memory_order_relaxed), mMaxScopeCount);
+
+  // Not ready if the frame was recorded but never submitted, the previous results are kept then
+  if (scopeCount > 0) {
+    std::vector<uint64_t> timestamps(2 * scopeCount);
+    auto result = vkGetQueryPoolResults(mDevice->getHandle(), frame.timestampPool, 0,
+                                        2 * scopeCount, timestamps.size() * sizeof(uint64_t),
+                                        timestamps.data(), sizeof(uint64_t),
+                                        VK_QUERY_RESULT_64_BIT);
+    if (result == VK_SUCCESS) {
+      mResults.clear();
+      uint64_t frameTicks = 0;
+      for (uint32_t i = 0; i < scopeCount; ++i) {
+        const auto &scope = frame.scopes[i];
+        auto        ticks = (timestamps[2 * i + 1] - timestamps[2 * i]) & mTimestampMask;
+        // Relative to the first scope, which began before any other
+        frameTicks = std::max(frameTicks, (timestamps[2 * i + 1] - timestamps[0]) & mTimestampMask);
+
+        Result scopeResult{scope.name, ticks * mTimestampPeriod * 1e-6, scope.statistics, {}};
+        if (scope.statistics &&
+            vkGetQueryPoolResults(mDevice->getHandle(), frame.statisticsPool, i, 1,
+                                  sizeof(Statistics), &scopeResult.statistics, sizeof(Statistics),
+                                  VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+          scopeResult.hasStatistics = false;
+        }
+        mResults.push_back(std::move(scopeResult));
+      }
+      mFrameMilliseconds = frameTicks * mTimestampPeriod * 1e-6;
+    } else if (result != VK_NOT_READY) {
+      vkOK(result);
+    }
+  }
+
+  // Queries must be reset before being written again
+  vkCmdResetQueryPool(commandBuffer, frame.timestampPool, 0, 2 * mMaxScopeCount);
+  if (frame.statisticsPool != VK_NULL_HANDLE) {
+    vkCmdResetQueryPool(commandBuffer, frame.statisticsPool, 0, mMaxScopeCount);
+  }
+  frame.scopeCount.store(0, std::memory_order_relaxed);
+  mFrame = &frame;
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer commandBuffer, std::string name,
+                                 bool statistics) {
+  auto scope = mFrame->scopeCount.fetch_add(1, std::memory_order_relaxed);
+  if (scope >= mMaxScopeCount) {
+    return UINT32_MAX;
+  }
+
+  statistics            = statistics && mSupportsStatistics;
+  mFrame->scopes[scope] = {std::move(name), statistics};
+  vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, mFrame->timestampPool,
+                      2 * scope);
+  if (statistics) {
+    vkCmdBeginQuery(commandBuffer, mFrame->statisticsPool, scope, 0);
+  }
+  return scope;
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+  if (scope == UINT32_MAX) {
+    return;
+  }
+
+  if (mFrame->scopes[scope].statistics) {
+    vkCmdEndQuery(commandBuffer, mFrame->statisticsPool, scope);
+  }
+  vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mFrame->timestampPool,
+                      2 * scope + 1);
+}
@@ -1 +1,37 @@
 #include "Image.h"
+#include "Device.h"
+#include "Log.h"
+#include "Macros.h"
+#include "Profiler.h"
+
+Image::Image(const std::shared_ptr<Device> &device, VkFormat format, const VkExtent2D &extent,
+             VkImageUsageFlags usage, VkMemoryPropertyFlags properties)
+    : mDevice{device}, mFormat{format}, mExtent{extent} {
+  PROFILE_FUNCTION();
+
+  VkImageCreateInfo imageCreateInfo{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+  imageCreateInfo.imageType     = VK_IMAGE_TYPE_2D;
+  imageCreateInfo.format        = format;
+  imageCreateInfo.extent        = {extent.width, extent.height, 1};
+  imageCreateInfo.mipLevels     = 1;
+  imageCreateInfo.arrayLayers   = 1;
+  imageCreateInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+  imageCreateInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+  imageCreateInfo.usage         = usage;
+  imageCreateInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+  imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  vkOK(vkCreateImage(device->getHandle(), &imageCreateInfo, nullptr, &mHandle));
+
+  VkMemoryRequirements memoryRequirements{};
+  vkGetImageMemoryRequirements(device->getHandle(), mHandle, &memoryRequirements);
+
+  mAllocation = device->getMemoryAllocator().allocate(memoryRequirements, properties,
+                                                      MemoryLifetime::LONG_LIVED, true);
+  vkOK(vkBindImageMemory(device->getHandle(), mHandle, mAllocation.memory, mAllocation.offset));
+}
+
+Image::~Image() {
+  log_func;
+  vkDestroyImage(mDevice->getHandle(), mHandle, nullptr);
+  mDevice->getMemoryAllocator().free(mAllocation);
+}
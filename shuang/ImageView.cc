@@ -1 +1,25 @@
 #include "ImageView.h"
+#include "Device.h"
+#include "Image.h"
+#include "Log.h"
+#include "Macros.h"
+
+ImageView::ImageView(const std::shared_ptr<Device> &device, const Image &image,
+                     VkImageAspectFlags aspectMask)
+    : mDevice{device} {
+  VkImageViewCreateInfo imageViewCreateInfo{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+  imageViewCreateInfo.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+  imageViewCreateInfo.image                           = image.getHandle();
+  imageViewCreateInfo.format                          = image.getFormat();
+  imageViewCreateInfo.subresourceRange.baseMipLevel   = 0;
+  imageViewCreateInfo.subresourceRange.levelCount     = 1;
+  imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+  imageViewCreateInfo.subresourceRange.layerCount     = 1;
+  imageViewCreateInfo.subresourceRange.aspectMask     = aspectMask;
+  vkOK(vkCreateImageView(device->getHandle(), &imageViewCreateInfo, nullptr, &mHandle));
+}
+
+ImageView::~ImageView() {
+  log_func;
+  vkDestroyImageView(mDevice->getHandle(), mHandle, nullptr);
+}
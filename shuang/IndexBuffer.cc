@@ -1,7 +1,52 @@
 #include "IndexBuffer.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
 
 IndexBuffer::IndexBuffer(const std::shared_ptr<Device> &device, VkBufferUsageFlags usage,
-                         VkMemoryPropertyFlags properties, uint32_t indexCount, VkDeviceSize size,
-                         void *data)
-    : Buffer(device, usage | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, properties, size, data),
-      mIndexCount{indexCount} {}
+                         VkMemoryPropertyFlags properties, uint32_t indexCount,
+                         VkIndexType indexType, void *data)
+    : Buffer(device, usage | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, properties,
+             static_cast<VkDeviceSize>(indexCount) * getIndexSize(indexType), data),
+      mIndexCount{indexCount}, mIndexType{indexType} {}
+
+VkIndexType IndexBuffer::selectIndexType(uint32_t vertexCount) {
+  return vertexCount <= MAX_SHORT_INDEXED_VERTEX_COUNT ? VK_INDEX_TYPE_UINT16
+                                                       : VK_INDEX_TYPE_UINT32;
+}
+
+VkIndexType IndexBuffer::selectIndexType(const std::vector<IndexRange> &ranges) {
+  uint32_t vertexCount = 0;
+  for (const auto &range : ranges) {
+    vertexCount = std::max(vertexCount, range.vertexCount);
+  }
+  return selectIndexType(vertexCount);
+}
+
+uint32_t IndexBuffer::getIndexSize(VkIndexType indexType) {
+  switch (indexType) {
+  case VK_INDEX_TYPE_UINT16:
+    return sizeof(uint16_t);
+  case VK_INDEX_TYPE_UINT32:
+    return sizeof(uint32_t);
+  default:
+    throw std::runtime_error(
+        fmt::format("Unsupported index type {}", static_cast<int>(indexType)));
+  }
+}
+
+void IndexBuffer::encode(const uint32_t *indices, size_t count, VkIndexType indexType,
+                         void *dst) {
+  if (indexType == VK_INDEX_TYPE_UINT32) {
+    memcpy(dst, indices, count * sizeof(uint32_t));
+    return;
+  }
+
+  // The restart index truncates to the 16 bit one
+  auto shortIndices = static_cast<uint16_t *>(dst);
+  for (size_t i = 0; i < count; ++i) {
+    shortIndices[i] = static_cast<uint16_t>(indices[i]);
+  }
+}
@@ -0,0 +1,294 @@
+#include "IndirectRenderer.h"
+#include "Device.h"
+#include "Frustum.h"
+#include "Initializer.h"
+#include "LodSelector.h"
+#include "Log.h"
+#include "Macros.h"
+#include "model/Model.h"
+
+// Must match the local size of the cull shader
+#define CULL_GROUP_SIZE 64
+
+namespace {
+
+// Push constants of the cull shader
+struct CullConstants {
+  glm::vec4 planes[6];
+  // Position of the camera, and the size in pixels of a unit at a unit distance from it
+  glm::vec4 camera;
+  uint32_t  objectCount;
+};
+
+} // namespace
+
+IndirectRenderer::IndirectRenderer(const std::shared_ptr<Device> &device, uint32_t maxObjectCount,
+                                   uint32_t maxDrawCount, uint32_t maxCommandCount,
+                                   uint32_t frameCount)
+    : mDevice{device}, mMaxObjectCount{maxObjectCount}, mMaxDrawCount{maxDrawCount},
+      mMaxCommandCount{maxCommandCount} {
+  if (!device->supportsDrawIndirectCount()) {
+    throw std::runtime_error("GPU driven rendering requires draw indirect count");
+  }
+
+  // Uploaded and drawn by the graphics queue, culled by the compute queue
+  std::vector<uint32_t> queueFamilyIndices;
+  if (device->hasDedicatedComputeQueue()) {
+    queueFamilyIndices = {device->getQueueFamilyIndices().graphics,
+                          device->getQueueFamilyIndices().compute};
+  }
+
+  mObjectBuffer = std::make_unique<Buffer>(
+      mDevice, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, maxObjectCount * sizeof(ObjectData), nullptr,
+      MemoryLifetime::LONG_LIVED, queueFamilyIndices);
+  mDrawBuffer   = std::make_unique<Buffer>(
+      mDevice, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, maxDrawCount * sizeof(DrawData), nullptr,
+      MemoryLifetime::LONG_LIVED, queueFamilyIndices);
+  for (uint32_t i = 0; i < frameCount; ++i) {
+    // Every object may be visible at once
+    mDrawCommandBuffers.push_back(std::make_unique<Buffer>(
+        mDevice, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        maxCommandCount * sizeof(VkDrawIndexedIndirectCommand), nullptr,
+        MemoryLifetime::LONG_LIVED, queueFamilyIndices));
+    mDrawCountBuffers.push_back(std::make_unique<Buffer>(
+        mDevice,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, maxDrawCount * sizeof(uint32_t), nullptr,
+        MemoryLifetime::LONG_LIVED, queueFamilyIndices));
+  }
+
+  // The cull sets bind the four buffers, the object set the objects only
+  std::vector<VkDescriptorType> cullTypes(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+  mDescriptorPool  = std::make_shared<DescriptorPool>(mDevice, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                      cullTypes.size() * frameCount + 1,
+                                                      frameCount + 1);
+  mCullSetLayout   = std::make_unique<DescriptorSetLayout>(mDevice, cullTypes,
+                                                           VK_SHADER_STAGE_COMPUTE_BIT);
+  mObjectSetLayout = std::make_unique<DescriptorSetLayout>(
+      mDevice, std::vector<VkDescriptorType>{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER},
+      VK_SHADER_STAGE_VERTEX_BIT);
+
+  for (uint32_t i = 0; i < frameCount; ++i) {
+    std::vector<VkDescriptorBufferInfo> bufferInfos = {
+        createDescriptorBufferInfo(mObjectBuffer->getHandle(), VK_WHOLE_SIZE),
+        createDescriptorBufferInfo(mDrawBuffer->getHandle(), VK_WHOLE_SIZE),
+        createDescriptorBufferInfo(mDrawCommandBuffers[i]->getHandle(), VK_WHOLE_SIZE),
+        createDescriptorBufferInfo(mDrawCountBuffers[i]->getHandle(), VK_WHOLE_SIZE),
+    };
+    mCullSets.push_back(std::make_unique<DescriptorSet>(
+        mDevice, mDescriptorPool, 1, std::vector{mCullSetLayout->getHandle()}, cullTypes,
+        bufferInfos));
+  }
+  mObjectSet = std::make_unique<DescriptorSet>(
+      mDevice, mDescriptorPool, 1, std::vector{mObjectSetLayout->getHandle()},
+      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+      createDescriptorBufferInfo(mObjectBuffer->getHandle(), VK_WHOLE_SIZE));
+
+  setupPipeline();
+}
+
+IndirectRenderer::~IndirectRenderer() {
+  log_func;
+
+  vkDestroyPipeline(mDevice->getHandle(), mPipeline, nullptr);
+  vkDestroyPipelineLayout(mDevice->getHandle(), mPipelineLayout, nullptr);
+}
+
+uint32_t IndirectRenderer::addObject(const Model &model, const glm::mat4 &transform,
+                                     const glm::vec4 &color) {
+  if (mObjectCount == mMaxObjectCount) {
+    throw std::runtime_error(fmt::format("Too many objects, at most {}", mMaxObjectCount));
+  }
+
+  auto rangeCount = static_cast<uint32_t>(model.getIndexRanges().size());
+  if (mCommandCount + rangeCount > mMaxCommandCount) {
+    throw std::runtime_error(fmt::format("Too many draw commands, at most {}", mMaxCommandCount));
+  }
+
+  auto it = mDrawIndices.find(&model);
+  if (it == mDrawIndices.end()) {
+    if (mDraws.size() + rangeCount > mMaxDrawCount) {
+      throw std::runtime_error(
+          fmt::format("Too many model index ranges, at most {}", mMaxDrawCount));
+    }
+    it = mDrawIndices.emplace(&model, static_cast<uint32_t>(mDraws.size())).first;
+    for (uint32_t i = 0; i < rangeCount; ++i) {
+      mDraws.push_back({&model, i});
+      mDrawObjectCounts.push_back(0);
+    }
+  }
+  auto drawIndex = it->second;
+  for (uint32_t i = 0; i < rangeCount; ++i) {
+    ++mDrawObjectCounts[drawIndex + i];
+  }
+  mCommandCount += rangeCount;
+  mDrawsChanged = true;
+
+  mNewObjects.push_back({transform, color, drawIndex, 0, {}});
+  return mObjectCount++;
+}
+
+void IndirectRenderer::setTransform(uint32_t object, const glm::mat4 &transform) {
+  if (object >= mObjectCount) {
+    throw std::runtime_error(fmt::format("Invalid object {}", object));
+  }
+
+  // Not uploaded yet, moved along
+  auto firstNewObject = mObjectCount - static_cast<uint32_t>(mNewObjects.size());
+  if (object >= firstNewObject) {
+    mNewObjects[object - firstNewObject].transform = transform;
+  } else {
+    mMoves.emplace_back(object, transform);
+  }
+}
+
+bool IndirectRenderer::update() {
+  auto &uploadBatcher = mDevice->getUploadBatcher();
+  auto  uploaded      = mDrawsChanged || !mNewObjects.empty() || !mMoves.empty();
+
+  if (mDrawsChanged) {
+    // The commands of each range follow the ones of the previous range, with room for all its
+    // objects, whichever level of detail they are drawn at
+    std::vector<DrawData> draws(mDraws.size());
+    uint32_t              commandOffset = 0;
+    for (size_t i = 0; i < mDraws.size(); ++i) {
+      const auto *model = mDraws[i].model;
+      const auto &range = model->getIndexRanges()[mDraws[i].range];
+      const auto &lods  = model->getLods();
+      // The level of detail of the range, levels being consecutive ranges
+      size_t lod = 0;
+      while (lod + 1 < lods.size() && mDraws[i].range >= lods[lod + 1].firstRange) {
+        ++lod;
+      }
+      draws[i] = {glm::vec4(model->getBoundingSphereCenter(), model->getBoundingSphereRadius()),
+                  range.indexCount,
+                  range.firstIndex,
+                  commandOffset,
+                  range.vertexOffset,
+                  lods[lod].rangeCount,
+                  static_cast<uint32_t>(lods.size()),
+                  lods[lod].error,
+                  0};
+      commandOffset += mDrawObjectCounts[i];
+    }
+    uploadBatcher.upload(*mDrawBuffer, draws.data(), draws.size() * sizeof(DrawData));
+    mDrawsChanged = false;
+  }
+
+  if (!mNewObjects.empty()) {
+    auto firstNewObject = mObjectCount - mNewObjects.size();
+    uploadBatcher.upload(*mObjectBuffer, mNewObjects.data(),
+                         mNewObjects.size() * sizeof(ObjectData),
+                         firstNewObject * sizeof(ObjectData));
+    mNewObjects.clear();
+  }
+
+  for (const auto &[object, transform] : mMoves) {
+    uploadBatcher.upload(*mObjectBuffer, &transform, sizeof(glm::mat4),
+                         object * sizeof(ObjectData) + offsetof(ObjectData, transform));
+  }
+  mMoves.clear();
+  return uploaded;
+}
+
+void IndirectRenderer::cull(VkCommandBuffer commandBuffer, const Frustum &frustum,
+                            const LodSelector &lodSelector, uint32_t frameIndex) {
+  // The commands and counts of the frame must have been read before they are reset, which only
+  // takes an execution dependency. On the compute queue, the frame was waited for by the CPU.
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0,
+                       nullptr, 0, nullptr, 0, nullptr);
+  vkCmdFillBuffer(commandBuffer, mDrawCountBuffers[frameIndex]->getHandle(), 0, VK_WHOLE_SIZE, 0);
+
+  // The levels of detail of the objects were written by the previous culling on this queue
+  VkMemoryBarrier memoryBarrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+  memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0,
+                       nullptr);
+
+  CullConstants constants{};
+  for (int i = 0; i < 6; ++i) {
+    constants.planes[i] = frustum.getPlane(i);
+  }
+  constants.camera      = glm::vec4(lodSelector.getCameraPosition(), lodSelector.getPixelScale());
+  constants.objectCount = mObjectCount;
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1,
+                          &mCullSets[frameIndex]->getHandle(), 0, nullptr);
+  vkCmdPushConstants(commandBuffer, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                     sizeof(constants), &constants);
+  vkCmdDispatch(commandBuffer, (mObjectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+  // On the compute queue, the semaphore waited for by the draws makes the commands visible instead
+  memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  memoryBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0,
+                       nullptr);
+}
+
+void IndirectRenderer::draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout,
+                            uint32_t frameIndex) {
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1,
+                          &mObjectSet->getHandle(), 0, nullptr);
+
+  uint32_t     commandOffset = 0;
+  const Model *boundModel    = nullptr;
+  float        fade          = 1.0f;
+  for (size_t i = 0; i < mDraws.size(); ++i) {
+    const auto *model = mDraws[i].model;
+    // Streamed models are skipped until their geometry is handed over to the graphics queue
+    if (!mDevice->getStreamingBatcher().isAvailable(model->getUploadToken())) {
+      commandOffset += mDrawObjectCounts[i];
+      continue;
+    }
+
+    // The ranges of a model share its buffers
+    if (model != boundModel) {
+      vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+                         sizeof(PositionDequantization), &model->getDequantization());
+      vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT,
+                         sizeof(DrawPushConstants), sizeof(fade), &fade);
+      VkDeviceSize offsets[] = {0};
+      vkCmdBindVertexBuffers(commandBuffer, 0, 1, &model->getVertexBuffer()->getHandle(),
+                             offsets);
+      vkCmdBindIndexBuffer(commandBuffer, model->getIndexBuffer()->getHandle(), 0,
+                           model->getIndexBuffer()->getIndexType());
+      boundModel = model;
+    }
+    vkCmdDrawIndexedIndirectCount(commandBuffer, mDrawCommandBuffers[frameIndex]->getHandle(),
+                                  commandOffset * sizeof(VkDrawIndexedIndirectCommand),
+                                  mDrawCountBuffers[frameIndex]->getHandle(), i * sizeof(uint32_t),
+                                  mDrawObjectCounts[i], sizeof(VkDrawIndexedIndirectCommand));
+    commandOffset += mDrawObjectCounts[i];
+  }
+}
+
+void IndirectRenderer::setupPipeline() {
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.size       = sizeof(CullConstants);
+
+  VkPipelineLayoutCreateInfo layoutCreateInfo{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+  layoutCreateInfo.setLayoutCount         = 1;
+  layoutCreateInfo.pSetLayouts            = &mCullSetLayout->getHandle();
+  layoutCreateInfo.pushConstantRangeCount = 1;
+  layoutCreateInfo.pPushConstantRanges    = &pushConstantRange;
+  vkOK(vkCreatePipelineLayout(mDevice->getHandle(), &layoutCreateInfo, nullptr, &mPipelineLayout));
+
+  VkComputePipelineCreateInfo createInfo{VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+  createInfo.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  createInfo.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+  createInfo.stage.module = mDevice->getShaderLibrary().load("shaders/cull.comp.spv");
+  createInfo.stage.pName  = "main";
+  createInfo.layout       = mPipelineLayout;
+  mPipeline = mDevice->getPipelineCache().createComputePipeline(createInfo, "cull");
+}
@@ -3,8 +3,6 @@
 #include "Macros.h"
 #include "Validation.h"
 
-#include <vulkan/vulkan_metal.h>
-
 Instance::Instance(const char *applicationName, const std::vector<const char *> &requiredExtensions,
                    bool enableValidation)
     : mEnableValidation{enableValidation} {
@@ -23,10 +21,9 @@ Instance::Instance(const char *applicationName, const std::vector<const char *>
     }
   }
 
-  std::vector<const char *> extensions = {
-      VK_KHR_SURFACE_EXTENSION_NAME,
-      VK_EXT_METAL_SURFACE_EXTENSION_NAME,
-  };
+  // Surface extensions are platform specific, thus come from the window along with the other
+  // required extensions. A headless instance requests none of them.
+  std::vector<const char *> extensions{};
   if (enableValidation) {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
   }
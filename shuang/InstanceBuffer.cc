@@ -0,0 +1,35 @@
+#include "InstanceBuffer.h"
+#include "Device.h"
+#include "model/Model.h"
+
+#include <algorithm>
+#include <cfloat>
+
+InstanceBuffer::InstanceBuffer(const std::shared_ptr<Device>   &device,
+                               const std::vector<InstanceData> &instances)
+    : VertexBuffer(device, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                   static_cast<int>(instances.size()), sizeof(InstanceData)) {
+  mUploadToken = device->getStreamingBatcher().upload(*this, instances.data(),
+                                                      instances.size() * sizeof(InstanceData));
+
+  mOriginMin = glm::vec3(FLT_MAX);
+  mOriginMax = glm::vec3(-FLT_MAX);
+  for (const auto &instance : instances) {
+    auto origin = glm::vec3(instance.transform[3]);
+    mOriginMin  = glm::min(mOriginMin, origin);
+    mOriginMax  = glm::max(mOriginMax, origin);
+    mMaxScale   = std::max({mMaxScale, glm::length(glm::vec3(instance.transform[0])),
+                            glm::length(glm::vec3(instance.transform[1])),
+                            glm::length(glm::vec3(instance.transform[2]))});
+  }
+}
+
+void InstanceBuffer::getBoundingSphere(const Model &model, glm::vec3 &center,
+                                       float &radius) const {
+  // The sphere of the model lands within its scaled radius plus the scaled distance of its center
+  // from the origin of each instance
+  center = (mOriginMin + mOriginMax) * 0.5f;
+  radius = glm::distance(mOriginMin, mOriginMax) * 0.5f +
+           mMaxScale * (glm::length(model.getBoundingSphereCenter()) +
+                        model.getBoundingSphereRadius());
+}
@@ -0,0 +1,307 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+// Number of jobs each deque holds, a power of two. Jobs pushed to a full deque go to the shared
+// queue instead.
+#define JOB_DEQUE_CAPACITY 4096
+// Number of rounds over the other deques an idle worker tries stealing before going to sleep
+#define JOB_STEAL_ROUNDS 64
+
+namespace {
+
+// The system whose deque the calling thread owns, if any, and the index of the deque
+thread_local JobSystem *tJobSystem  = nullptr;
+thread_local uint32_t   tDequeIndex = 0;
+
+} // namespace
+
+// Chase-Lev work stealing deque of fixed capacity, with the memory orders of Lê et al., "Correct
+// and Efficient Work-Stealing for Weak Memory Models". The owner pushes and pops at the bottom,
+// other threads steal at the top.
+class JobSystem::Deque {
+public:
+  // Owner only, fails if the deque is full
+  bool push(Task *task) {
+    auto bottom = mBottom.load(std::memory_order_relaxed);
+    auto top    = mTop.load(std::memory_order_acquire);
+    if (bottom - top >= JOB_DEQUE_CAPACITY) {
+      return false;
+    }
+    mTasks[bottom & (JOB_DEQUE_CAPACITY - 1)].store(task, std::memory_order_relaxed);
+    // Publishes the task to the thieves, which read the bottom with acquire
+    mBottom.store(bottom + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Owner only, the most recently pushed task
+  Task *pop() {
+    auto bottom = mBottom.load(std::memory_order_relaxed) - 1;
+    mBottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto top = mTop.load(std::memory_order_relaxed);
+
+    Task *task = nullptr;
+    if (top <= bottom) {
+      task = mTasks[bottom & (JOB_DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+      if (top == bottom) {
+        // The last task, which a thief may be taking as well
+        if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+          task = nullptr;
+        }
+        mBottom.store(bottom + 1, std::memory_order_relaxed);
+      }
+    } else {
+      mBottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return task;
+  }
+
+  // Any thread, the least recently pushed task
+  Task *steal() {
+    auto top = mTop.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto bottom = mBottom.load(std::memory_order_acquire);
+    if (top >= bottom) {
+      return nullptr;
+    }
+
+    auto task = mTasks[top & (JOB_DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return task;
+  }
+
+private:
+  // On separate cache lines, the owner writing the bottom and the thieves the top
+  alignas(64) std::atomic<int64_t> mTop{0};
+  alignas(64) std::atomic<int64_t> mBottom{0};
+  std::atomic<Task *> mTasks[JOB_DEQUE_CAPACITY];
+};
+
+JobSystem::JobSystem(uint32_t workerCount) : mMainThreadId{std::this_thread::get_id()} {
+  for (uint32_t i = 0; i <= workerCount; ++i) {
+    mDeques.push_back(std::make_unique<Deque>());
+  }
+
+  tJobSystem  = this;
+  tDequeIndex = 0;
+  mWorkers.reserve(workerCount);
+  for (uint32_t i = 1; i <= workerCount; ++i) {
+    mWorkers.emplace_back(&JobSystem::workerLoop, this, i);
+  }
+}
+
+JobSystem::~JobSystem() {
+  // Run what is left, then wake the workers up for them to leave
+  while (auto *task = take()) {
+    execute(task);
+  }
+  {
+    std::lock_guard<std::mutex> lock{mSleepMutex};
+    mStopping = true;
+  }
+  mSleepCondition.notify_all();
+  for (auto &worker : mWorkers) {
+    worker.join();
+  }
+  runMainThreadJobs();
+
+  if (tJobSystem == this) {
+    tJobSystem = nullptr;
+  }
+}
+
+JobSystem &JobSystem::getInstance() {
+  static JobSystem instance(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+  return instance;
+}
+
+void JobSystem::run(Job job, Counter *counter, Counter *dependency) {
+  if (counter) {
+    counter->mValue.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  if (dependency) {
+    // Checked under the lock, so that the last job of the dependency either sees this one or is
+    // seen done here
+    std::lock_guard<std::mutex> lock{dependency->mMutex};
+    if (!dependency->isDone()) {
+      dependency->mDependents.emplace_back(std::move(job), counter);
+      return;
+    }
+  }
+  push(new Task{std::move(job), counter});
+}
+
+void JobSystem::runOnMainThread(Job job, Counter *counter) {
+  if (counter) {
+    counter->mValue.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  std::lock_guard<std::mutex> lock{mMainThreadMutex};
+  mMainThreadTasks.push_back(new Task{std::move(job), counter});
+}
+
+void JobSystem::runMainThreadJobs() {
+  std::vector<Task *> tasks;
+  {
+    std::lock_guard<std::mutex> lock{mMainThreadMutex};
+    std::swap(tasks, mMainThreadTasks);
+  }
+  for (auto *task : tasks) {
+    execute(task);
+  }
+}
+
+void JobSystem::wait(Counter &counter) {
+  auto isMainThread = std::this_thread::get_id() == mMainThreadId;
+  while (!counter.isDone()) {
+    if (auto *task = take()) {
+      execute(task);
+    } else if (isMainThread) {
+      runMainThreadJobs();
+      std::this_thread::yield();
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  // The last job may still hold the lock, and the counter may be destroyed once this returns
+  std::lock_guard<std::mutex> lock{counter.mMutex};
+}
+
+void JobSystem::parallelFor(size_t count, size_t grainSize,
+                            const std::function<void(size_t, size_t)> &fn) {
+  if (count == 0) {
+    return;
+  }
+  grainSize = std::max<size_t>(grainSize, 1);
+  // A single range runs right away
+  if (count <= grainSize) {
+    fn(0, count);
+    return;
+  }
+
+  Counter counter;
+  for (size_t begin = 0; begin < count; begin += grainSize) {
+    auto end = std::min(begin + grainSize, count);
+    run([&fn, begin, end]() { fn(begin, end); }, &counter);
+  }
+  wait(counter);
+}
+
+void JobSystem::workerLoop(uint32_t index) {
+  tJobSystem  = this;
+  tDequeIndex = index;
+  PROFILE_THREAD("job worker " + std::to_string(index));
+
+  for (;;) {
+    Task *task = nullptr;
+    for (int round = 0; round < JOB_STEAL_ROUNDS && !task; ++round) {
+      task = take();
+    }
+    if (task) {
+      execute(task);
+      continue;
+    }
+
+    // Sleep until a job is queued. A job queued right after the check is seen since the count
+    // of sleeping workers is incremented before it, and read by push after queuing.
+    std::unique_lock<std::mutex> lock{mSleepMutex};
+    mSleepingCount.fetch_add(1);
+    mSleepCondition.wait(lock, [&]() { return mQueuedCount.load() > 0 || mStopping; });
+    mSleepingCount.fetch_sub(1);
+    if (mStopping && mQueuedCount.load() == 0) {
+      return;
+    }
+  }
+}
+
+void JobSystem::push(Task *task) {
+  if (tJobSystem != this || !mDeques[tDequeIndex]->push(task)) {
+    std::lock_guard<std::mutex> lock{mSharedMutex};
+    mSharedTasks.push_back(task);
+    mHasSharedTasks.store(true, std::memory_order_release);
+  }
+
+  mQueuedCount.fetch_add(1);
+  if (mSleepingCount.load() > 0) {
+    std::lock_guard<std::mutex> lock{mSleepMutex};
+    mSleepCondition.notify_one();
+  }
+}
+
+JobSystem::Task *JobSystem::take() {
+  Task *task = nullptr;
+
+  auto ownIndex = tJobSystem == this ? tDequeIndex : UINT32_MAX;
+  if (ownIndex != UINT32_MAX) {
+    task = mDeques[ownIndex]->pop();
+  }
+
+  if (!task && mHasSharedTasks.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock{mSharedMutex};
+    if (!mSharedTasks.empty()) {
+      task = mSharedTasks.back();
+      mSharedTasks.pop_back();
+      mHasSharedTasks.store(!mSharedTasks.empty(), std::memory_order_release);
+    }
+  }
+
+  // Steal from the others, starting after the own deque so that thieves spread out
+  auto dequeCount = static_cast<uint32_t>(mDeques.size());
+  auto start      = ownIndex == UINT32_MAX ? 0 : ownIndex + 1;
+  for (uint32_t i = 0; i < dequeCount && !task; ++i) {
+    auto victim = (start + i) % dequeCount;
+    if (victim != ownIndex) {
+      task = mDeques[victim]->steal();
+    }
+  }
+
+  if (task) {
+    mQueuedCount.fetch_sub(1);
+  }
+  return task;
+}
+
+void JobSystem::execute(Task *task) {
+  // Jobs are fine grained, e.g. a range of a parallel loop, and would fill the buffers of the
+  // profiler within a few frames. Their callers are profiled instead, unless asked for.
+#ifdef SHUANG_PROFILING_JOBS
+  PROFILE_SCOPE("job");
+#endif
+  task->job();
+  if (task->counter) {
+    finish(*task->counter);
+  }
+  delete task;
+}
+
+void JobSystem::finish(Counter &counter) {
+  // Not the last job, the counter can't be done meanwhile
+  auto value = counter.mValue.load(std::memory_order_relaxed);
+  while (value > 1) {
+    if (counter.mValue.compare_exchange_weak(value, value - 1, std::memory_order_acq_rel,
+                                             std::memory_order_relaxed)) {
+      return;
+    }
+  }
+
+  // Possibly the last job, under the lock which waiters take before returning, so that the counter
+  // outlives it. Its dependents are queued then.
+  std::vector<std::pair<Job, Counter *>> dependents;
+  {
+    std::lock_guard<std::mutex> lock{counter.mMutex};
+    if (counter.mValue.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      std::swap(dependents, counter.mDependents);
+    }
+  }
+  for (auto &[job, dependentCounter] : dependents) {
+    push(new Task{std::move(job), dependentCounter});
+  }
+}
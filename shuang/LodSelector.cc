@@ -0,0 +1,55 @@
+#include "LodSelector.h"
+#include "model/Model.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Error in pixels a level of detail may project to on screen. Must match cull.comp.
+#define LOD_PIXEL_ERROR 1.0f
+// Ratio of the threshold by which a level must project under it to be switched to, and the
+// current level may project over it. Must match cull.comp.
+#define LOD_HYSTERESIS 0.25f
+// Duration in seconds of the cross-fade between two levels
+#define LOD_FADE_DURATION 0.25f
+
+LodSelector::LodSelector(const Camera &camera, float viewportHeight)
+    : mCameraPosition{camera.getPosition()},
+      mPixelScale{viewportHeight * 0.5f * std::abs(camera.getProjectionMatrix()[1][1])} {}
+
+uint32_t LodSelector::select(const Model &model, const glm::vec3 &center, float radius,
+                             float scale, uint32_t currentLod) const {
+  const auto &lods     = model.getLods();
+  auto        distance = glm::length(center - mCameraPosition) - radius;
+  if (lods.size() == 1 || distance <= 0.0f) {
+    return 0;
+  }
+
+  // Model space errors project to pixels as the sphere does, from its nearest point
+  auto     pixelsPerUnit = scale * mPixelScale / distance;
+  uint32_t selected      = 0;
+  for (uint32_t i = 1; i < lods.size(); ++i) {
+    auto threshold = LOD_PIXEL_ERROR;
+    if (i > currentLod) {
+      threshold *= 1.0f - LOD_HYSTERESIS;
+    } else if (i == currentLod) {
+      threshold *= 1.0f + LOD_HYSTERESIS;
+    }
+    if (lods[i].error * pixelsPerUnit <= threshold) {
+      selected = i;
+    }
+  }
+  return selected;
+}
+
+void LodSelector::update(State &state, const Model &model, const glm::vec3 &center, float radius,
+                         float scale, float timeStep) const {
+  if (state.fade >= 1.0f) {
+    auto lod = select(model, center, radius, scale, state.lod);
+    if (lod != state.lod) {
+      state.previousLod = state.lod;
+      state.lod         = lod;
+      state.fade        = 0.0f;
+    }
+  }
+  state.fade = std::min(state.fade + timeStep / LOD_FADE_DURATION, 1.0f);
+}
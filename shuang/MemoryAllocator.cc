@@ -0,0 +1,282 @@
+#include "MemoryAllocator.h"
+#include "Device.h"
+#include "Log.h"
+#include "Macros.h"
+
+#include <algorithm>
+
+// Preferred size of the blocks sub-allocated from, per lifetime
+#define LONG_LIVED_BLOCK_SIZE (64ull * 1024 * 1024)
+#define TRANSIENT_BLOCK_SIZE (16ull * 1024 * 1024)
+#define DEDICATED_POOL_INDEX UINT32_MAX
+
+struct MemoryBlock {
+  VkDeviceMemory memory     = VK_NULL_HANDLE;
+  VkDeviceSize   size       = 0;
+  uint32_t       memoryType = 0;
+  uint32_t       poolIndex  = DEDICATED_POOL_INDEX;
+  MemoryLifetime lifetime   = MemoryLifetime::LONG_LIVED;
+  bool           coherent   = false;
+  void          *mapped     = nullptr;
+
+  // Long-lived blocks
+  std::unique_ptr<TlsfAllocator> tlsf;
+  // Transient blocks: the next free offset and the number of live allocations
+  VkDeviceSize linearOffset = 0;
+  uint32_t     linearCount  = 0;
+};
+
+namespace {
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+VkDeviceSize alignDown(VkDeviceSize value, VkDeviceSize alignment) {
+  return value / alignment * alignment;
+}
+
+} // namespace
+
+MemoryAllocator::MemoryAllocator(const Device &device) : mDevice{device} {
+  const auto &memoryProperties = device.getPhysicalDevice()->getMemoryProperties();
+  // One pool per memory type, lifetime and tiling
+  mPools.resize(memoryProperties.memoryTypeCount * 4);
+}
+
+MemoryAllocator::~MemoryAllocator() {
+  log_func;
+
+  auto statistics = getStatistics();
+  if (statistics.allocationCount > 0) {
+    log_warn("{} device memory allocations ({} bytes) are still alive",
+             statistics.allocationCount, statistics.allocationBytes);
+  }
+
+  for (auto &pool : mPools) {
+    for (auto &block : pool.blocks) {
+      destroyBlock(*block);
+    }
+  }
+  for (auto &block : mDedicatedBlocks) {
+    destroyBlock(*block);
+  }
+}
+
+MemoryAllocation MemoryAllocator::allocate(const VkMemoryRequirements &requirements,
+                                           VkMemoryPropertyFlags properties,
+                                           MemoryLifetime lifetime, bool optimalTiling) {
+  std::lock_guard<std::mutex> lock{mMutex};
+
+  auto memoryType = mDevice.getPhysicalDevice()->getMemoryType(requirements.memoryTypeBits,
+                                                                properties);
+  auto blockSize  = getBlockSize(memoryType, lifetime);
+
+  MemoryAllocation allocation{};
+  allocation.size = requirements.size;
+
+  // Large resources would waste most of a block, thus get device memory of their own
+  if (requirements.size > blockSize / 2) {
+    auto block = createBlock(memoryType, requirements.size, lifetime, DEDICATED_POOL_INDEX);
+    allocation.block = block.get();
+    mDedicatedBlocks.push_back(std::move(block));
+  } else {
+    auto  poolIndex = (memoryType * 2 + static_cast<uint32_t>(lifetime)) * 2 + optimalTiling;
+    auto &pool      = mPools[poolIndex];
+
+    for (auto &block : pool.blocks) {
+      if (lifetime == MemoryLifetime::LONG_LIVED) {
+        allocation.handle = block->tlsf->allocate(requirements.size, requirements.alignment);
+        if (allocation.handle != TlsfAllocator::INVALID_HANDLE) {
+          allocation.block  = block.get();
+          allocation.offset = block->tlsf->getOffset(allocation.handle);
+          break;
+        }
+      } else {
+        auto offset = alignUp(block->linearOffset, requirements.alignment);
+        if (offset + requirements.size <= block->size) {
+          block->linearOffset = offset + requirements.size;
+          ++block->linearCount;
+          allocation.block  = block.get();
+          allocation.offset = offset;
+          break;
+        }
+      }
+    }
+
+    if (allocation.block == nullptr) {
+      auto block = createBlock(memoryType, blockSize, lifetime, poolIndex);
+      if (lifetime == MemoryLifetime::LONG_LIVED) {
+        allocation.handle = block->tlsf->allocate(requirements.size, requirements.alignment);
+        allocation.offset = block->tlsf->getOffset(allocation.handle);
+      } else {
+        block->linearOffset = requirements.size;
+        block->linearCount  = 1;
+      }
+      allocation.block = block.get();
+      pool.blocks.push_back(std::move(block));
+    }
+  }
+
+  allocation.memory = allocation.block->memory;
+  if (allocation.block->mapped) {
+    allocation.mapped = static_cast<uint8_t *>(allocation.block->mapped) + allocation.offset;
+  }
+  return allocation;
+}
+
+void MemoryAllocator::free(MemoryAllocation &allocation) {
+  if (allocation.block == nullptr) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock{mMutex};
+
+  auto &block = *allocation.block;
+  if (block.poolIndex == DEDICATED_POOL_INDEX) {
+    destroyBlock(block);
+    auto iter = std::find_if(mDedicatedBlocks.begin(), mDedicatedBlocks.end(),
+                             [&](const auto &dedicated) { return dedicated.get() == &block; });
+    mDedicatedBlocks.erase(iter);
+  } else if (block.lifetime == MemoryLifetime::LONG_LIVED) {
+    block.tlsf->free(allocation.handle);
+    if (block.tlsf->isEmpty()) {
+      trim(block);
+    }
+  } else {
+    // A linear block can only be reused once every allocation in it is gone
+    if (--block.linearCount == 0) {
+      block.linearOffset = 0;
+      trim(block);
+    }
+  }
+
+  allocation = {};
+}
+
+void MemoryAllocator::flush(const MemoryAllocation &allocation, VkDeviceSize offset,
+                            VkDeviceSize size) {
+  if (allocation.block == nullptr || allocation.block->coherent) {
+    return;
+  }
+
+  if (size == VK_WHOLE_SIZE) {
+    size = allocation.size - offset;
+  }
+
+  // Flushed ranges must be multiples of nonCoherentAtomSize, or reach the end of the memory
+  auto atomSize = mDevice.getPhysicalDevice()->getProperties().limits.nonCoherentAtomSize;
+  auto begin    = alignDown(allocation.offset + offset, atomSize);
+  auto end      = std::min(alignUp(allocation.offset + offset + size, atomSize),
+                           allocation.block->size);
+
+  VkMappedMemoryRange mappedRange{VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE};
+  mappedRange.memory = allocation.memory;
+  mappedRange.offset = begin;
+  mappedRange.size   = end == allocation.block->size ? VK_WHOLE_SIZE : end - begin;
+  vkOK(vkFlushMappedMemoryRanges(mDevice.getHandle(), 1, &mappedRange));
+}
+
+MemoryAllocator::Statistics MemoryAllocator::getStatistics() {
+  std::lock_guard<std::mutex> lock{mMutex};
+
+  Statistics statistics{};
+  auto       accumulate = [&](const MemoryBlock &block) {
+    ++statistics.blockCount;
+    statistics.blockBytes += block.size;
+    if (block.poolIndex == DEDICATED_POOL_INDEX) {
+      ++statistics.allocationCount;
+      statistics.allocationBytes += block.size;
+    } else if (block.lifetime == MemoryLifetime::LONG_LIVED) {
+      statistics.allocationBytes += block.tlsf->getUsedSize();
+      statistics.allocationCount += block.tlsf->getAllocationCount();
+    } else {
+      // Includes the alignment padding in between
+      statistics.allocationBytes += block.linearOffset;
+      statistics.allocationCount += block.linearCount;
+    }
+  };
+
+  for (const auto &pool : mPools) {
+    for (const auto &block : pool.blocks) {
+      accumulate(*block);
+    }
+  }
+  for (const auto &block : mDedicatedBlocks) {
+    accumulate(*block);
+  }
+  return statistics;
+}
+
+VkDeviceSize MemoryAllocator::getBlockSize(uint32_t memoryType, MemoryLifetime lifetime) const {
+  const auto &memoryProperties = mDevice.getPhysicalDevice()->getMemoryProperties();
+  auto        heapSize =
+      memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryType].heapIndex].size;
+
+  // Small heaps, e.g. the 256MB device local and host visible one, are not given away in big chunks
+  auto preferredSize =
+      lifetime == MemoryLifetime::LONG_LIVED ? LONG_LIVED_BLOCK_SIZE : TRANSIENT_BLOCK_SIZE;
+  return std::min<VkDeviceSize>(preferredSize, heapSize / 8);
+}
+
+std::unique_ptr<MemoryBlock> MemoryAllocator::createBlock(uint32_t memoryType, VkDeviceSize size,
+                                                          MemoryLifetime lifetime,
+                                                          uint32_t       poolIndex) {
+  auto block        = std::make_unique<MemoryBlock>();
+  block->size       = size;
+  block->memoryType = memoryType;
+  block->poolIndex  = poolIndex;
+  block->lifetime   = lifetime;
+
+  VkMemoryAllocateInfo memoryAllocateInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+  memoryAllocateInfo.allocationSize  = size;
+  memoryAllocateInfo.memoryTypeIndex = memoryType;
+  if (auto result =
+          vkAllocateMemory(mDevice.getHandle(), &memoryAllocateInfo, nullptr, &block->memory);
+      result != VK_SUCCESS) {
+    throw std::runtime_error(
+        fmt::format("Failed to allocate {} bytes of device memory: {}", size,
+                    static_cast<int>(result)));
+  }
+
+  // Host visible memory is mapped once for its whole life, since a memory object can't be mapped
+  // more than once at a time
+  auto propertyFlags =
+      mDevice.getPhysicalDevice()->getMemoryProperties().memoryTypes[memoryType].propertyFlags;
+  if (propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    vkOK(vkMapMemory(mDevice.getHandle(), block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped));
+  }
+  block->coherent = propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+  if (poolIndex != DEDICATED_POOL_INDEX && lifetime == MemoryLifetime::LONG_LIVED) {
+    block->tlsf = std::make_unique<TlsfAllocator>(size);
+  }
+
+  log_debug("Allocate device memory block: {} bytes, memory type {}", size, memoryType);
+  return block;
+}
+
+void MemoryAllocator::destroyBlock(MemoryBlock &block) {
+  if (block.mapped) {
+    vkUnmapMemory(mDevice.getHandle(), block.memory);
+  }
+  vkFreeMemory(mDevice.getHandle(), block.memory, nullptr);
+}
+
+void MemoryAllocator::trim(MemoryBlock &emptyBlock) {
+  auto &blocks = mPools[emptyBlock.poolIndex].blocks;
+
+  auto isEmpty = [](const MemoryBlock &block) {
+    return block.tlsf ? block.tlsf->isEmpty() : block.linearCount == 0;
+  };
+  auto emptyCount = std::count_if(blocks.begin(), blocks.end(),
+                                  [&](const auto &block) { return isEmpty(*block); });
+  if (emptyCount <= 1) {
+    return;
+  }
+
+  destroyBlock(emptyBlock);
+  auto iter = std::find_if(blocks.begin(), blocks.end(),
+                           [&](const auto &block) { return block.get() == &emptyBlock; });
+  blocks.erase(iter);
+}
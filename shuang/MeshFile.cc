@@ -0,0 +1,194 @@
+#include "MeshFile.h"
+#include "IndexBuffer.h"
+#include "Log.h"
+#include "VertexLayout.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+// Alignment of the sections, so that each one starts on a page of its own
+#define MESH_FILE_ALIGNMENT 4096
+
+static_assert(sizeof(MeshFile::Header) == 136, "Mesh file header must not be padded");
+static_assert(sizeof(Submesh) == 32, "Submeshes must not be padded");
+static_assert(sizeof(IndexRange) == 16, "Index ranges must not be padded");
+static_assert(sizeof(Lod) == 12, "Levels of detail must not be padded");
+
+namespace {
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+MeshFile::MeshFile(const std::string &path) : mFile{path} {
+  if (mFile.size() < sizeof(Header)) {
+    throw std::runtime_error("Truncated mesh file: " + path);
+  }
+  memcpy(&mHeader, mFile.data(), sizeof(Header));
+
+  if (mHeader.magic != MAGIC) {
+    throw std::runtime_error("Not a mesh file: " + path);
+  }
+  if (mHeader.version != VERSION || mHeader.vertexFormat > VertexFormat::PACKED ||
+      mHeader.vertexSize != VertexLayout::get(mHeader.vertexFormat).getStride() ||
+      (mHeader.indexSize != sizeof(uint16_t) && mHeader.indexSize != sizeof(uint32_t)) ||
+      (mHeader.topology != VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST &&
+       mHeader.topology != VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP)) {
+    throw std::runtime_error(fmt::format(
+        "Unsupported mesh file version {}, vertex format {}, vertex size {}, index size {}, "
+        "topology {}: {}",
+        mHeader.version, static_cast<uint32_t>(mHeader.vertexFormat), mHeader.vertexSize,
+        mHeader.indexSize, static_cast<uint32_t>(mHeader.topology), path));
+  }
+
+  // Index values aren't checked against the vertex count, which would take a pass over the whole
+  // stream, files are trusted to be written by write()
+  auto isValidSection = [&](uint64_t offset, uint64_t size) {
+    return offset % MESH_FILE_ALIGNMENT == 0 && offset <= mFile.size() &&
+           size <= mFile.size() - offset;
+  };
+  if (!isValidSection(mHeader.vertexOffset, getVertexStreamSize()) ||
+      !isValidSection(mHeader.indexOffset, getIndexStreamSize()) ||
+      !isValidSection(mHeader.rangeOffset, uint64_t{mHeader.rangeCount} * sizeof(IndexRange)) ||
+      !isValidSection(mHeader.lodOffset, uint64_t{mHeader.lodCount} * sizeof(Lod)) ||
+      !isValidSection(mHeader.submeshOffset, uint64_t{mHeader.submeshCount} * sizeof(Submesh))) {
+    throw std::runtime_error("Corrupted mesh file: " + path);
+  }
+  for (const auto &range : getIndexRanges()) {
+    if (range.firstIndex > mHeader.indexCount ||
+        range.indexCount > mHeader.indexCount - range.firstIndex || range.vertexOffset < 0 ||
+        static_cast<uint32_t>(range.vertexOffset) > mHeader.vertexCount ||
+        range.vertexCount > mHeader.vertexCount - static_cast<uint32_t>(range.vertexOffset) ||
+        IndexBuffer::getIndexSize(IndexBuffer::selectIndexType(range.vertexCount)) >
+            mHeader.indexSize) {
+      throw std::runtime_error("Corrupted mesh file: " + path);
+    }
+  }
+  auto lods = getLods();
+  if (lods.empty()) {
+    throw std::runtime_error("Corrupted mesh file: " + path);
+  }
+  for (const auto &lod : lods) {
+    if (lod.firstRange > mHeader.rangeCount ||
+        lod.rangeCount > mHeader.rangeCount - lod.firstRange) {
+      throw std::runtime_error("Corrupted mesh file: " + path);
+    }
+  }
+  for (const auto &submesh : getSubmeshes()) {
+    if (submesh.firstIndex > mHeader.indexCount ||
+        submesh.indexCount > mHeader.indexCount - submesh.firstIndex) {
+      throw std::runtime_error("Corrupted mesh file: " + path);
+    }
+  }
+}
+
+VkDeviceSize MeshFile::getVertexStreamSize() const {
+  return VkDeviceSize{mHeader.vertexCount} * mHeader.vertexSize;
+}
+
+VkDeviceSize MeshFile::getIndexStreamSize() const {
+  return VkDeviceSize{mHeader.indexCount} * mHeader.indexSize;
+}
+
+VkIndexType MeshFile::getIndexType() const {
+  return mHeader.indexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+std::vector<IndexRange> MeshFile::getIndexRanges() const {
+  std::vector<IndexRange> ranges(mHeader.rangeCount);
+  memcpy(ranges.data(), mFile.data() + mHeader.rangeOffset, ranges.size() * sizeof(IndexRange));
+  return ranges;
+}
+
+std::vector<Lod> MeshFile::getLods() const {
+  std::vector<Lod> lods(mHeader.lodCount);
+  memcpy(lods.data(), mFile.data() + mHeader.lodOffset, lods.size() * sizeof(Lod));
+  return lods;
+}
+
+std::vector<Submesh> MeshFile::getSubmeshes() const {
+  std::vector<Submesh> submeshes(mHeader.submeshCount);
+  memcpy(submeshes.data(), mFile.data() + mHeader.submeshOffset,
+         submeshes.size() * sizeof(Submesh));
+  return submeshes;
+}
+
+PositionDequantization MeshFile::getDequantization() const {
+  PositionDequantization dequantization;
+  dequantization.offset = glm::vec4(mHeader.positionOffset, 0.0f);
+  dequantization.scale  = glm::vec4(mHeader.positionScale, 1.0f);
+  return dequantization;
+}
+
+void MeshFile::write(const std::string &path, const void *vertices, uint32_t vertexCount,
+                     VertexFormat vertexFormat, const PositionDequantization &dequantization,
+                     const void *indices, uint32_t indexCount, VkIndexType indexType,
+                     VkPrimitiveTopology topology, const std::vector<IndexRange> &ranges,
+                     const std::vector<Lod> &lods, const std::vector<Submesh> &submeshes) {
+  auto vertexStreamSize = uint64_t{vertexCount} * VertexLayout::get(vertexFormat).getStride();
+  auto indexStreamSize  = uint64_t{indexCount} * IndexBuffer::getIndexSize(indexType);
+
+  Header header{};
+  header.magic          = MAGIC;
+  header.version        = VERSION;
+  header.vertexSize     = VertexLayout::get(vertexFormat).getStride();
+  header.vertexCount    = vertexCount;
+  header.indexCount     = indexCount;
+  header.submeshCount   = static_cast<uint32_t>(submeshes.size());
+  header.vertexOffset   = alignUp(sizeof(Header), MESH_FILE_ALIGNMENT);
+  header.indexOffset    = alignUp(header.vertexOffset + vertexStreamSize, MESH_FILE_ALIGNMENT);
+  header.rangeOffset    = alignUp(header.indexOffset + indexStreamSize, MESH_FILE_ALIGNMENT);
+  header.lodOffset      = alignUp(header.rangeOffset + ranges.size() * sizeof(IndexRange),
+                                  MESH_FILE_ALIGNMENT);
+  header.submeshOffset  = alignUp(header.lodOffset + lods.size() * sizeof(Lod),
+                                  MESH_FILE_ALIGNMENT);
+  header.vertexFormat   = vertexFormat;
+  header.positionOffset = glm::vec3(dequantization.offset);
+  header.positionScale  = glm::vec3(dequantization.scale);
+  header.indexSize      = IndexBuffer::getIndexSize(indexType);
+  header.topology       = topology;
+  header.rangeCount     = static_cast<uint32_t>(ranges.size());
+  header.lodCount       = static_cast<uint32_t>(lods.size());
+  if (!submeshes.empty()) {
+    header.boundsMin = submeshes[0].boundsMin;
+    header.boundsMax = submeshes[0].boundsMax;
+    for (const auto &submesh : submeshes) {
+      header.boundsMin = glm::min(header.boundsMin, submesh.boundsMin);
+      header.boundsMax = glm::max(header.boundsMax, submesh.boundsMax);
+    }
+  }
+
+  auto          tmpPath = path + ".tmp";
+  std::ofstream file(tmpPath, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open file: " + tmpPath);
+  }
+
+  // Writes a section at its offset, padding the end of the previous one with zeros
+  auto writeSection = [&](uint64_t offset, const void *data, uint64_t size) {
+    static const char padding[MESH_FILE_ALIGNMENT]{};
+    auto              paddingSize = offset - static_cast<uint64_t>(file.tellp());
+    file.write(padding, static_cast<std::streamsize>(paddingSize));
+    file.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+  };
+  writeSection(0, &header, sizeof(header));
+  writeSection(header.vertexOffset, vertices, vertexStreamSize);
+  writeSection(header.indexOffset, indices, indexStreamSize);
+  writeSection(header.rangeOffset, ranges.data(), ranges.size() * sizeof(IndexRange));
+  writeSection(header.lodOffset, lods.data(), lods.size() * sizeof(Lod));
+  writeSection(header.submeshOffset, submeshes.data(), submeshes.size() * sizeof(Submesh));
+  file.close();
+  if (file.fail()) {
+    throw std::runtime_error("Failed to write file: " + tmpPath);
+  }
+
+  std::filesystem::rename(tmpPath, path);
+
+  log_info("Write mesh file {}: {} vertices of {} bytes, {} indices of {} bytes in {} ranges, {} "
+           "levels of detail, {} submeshes",
+           path, vertexCount, header.vertexSize, indexCount, header.indexSize, ranges.size(),
+           lods.size(), submeshes.size());
+}
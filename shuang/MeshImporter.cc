@@ -0,0 +1,545 @@
+#include "MeshImporter.h"
+#include "Device.h"
+#include "FileSystem.h"
+#include "Log.h"
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include "VertexLayout.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+// Size of the pieces OBJ files are split into at line boundaries, to be parsed in parallel
+#define OBJ_CHUNK_SIZE (1024 * 1024)
+// Number of vertices and indices encoded into staging memory at once when uploading imported
+// geometry
+#define ENCODE_CHUNK_VERTEX_COUNT (64 * 1024)
+#define ENCODE_CHUNK_INDEX_COUNT (256 * 1024)
+
+const glm::vec3 MeshImporter::DEFAULT_COLOR{0.6f, 0.6f, 0.6f};
+
+namespace {
+
+struct ObjChunk {
+  const char *begin;
+  const char *end;
+  // Positions and triangle indices within the chunk
+  uint64_t  vertexCount = 0;
+  uint64_t  indexCount  = 0;
+  glm::vec3 boundsMin{FLT_MAX};
+  glm::vec3 boundsMax{-FLT_MAX};
+};
+
+enum class ObjLine { OTHER, POSITION, FACE };
+
+bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+const char *skipSpaces(const char *p, const char *end) {
+  while (p < end && isSpace(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+// The end of the line starting at p, the newline excluded
+const char *findLineEnd(const char *p, const char *end) {
+  auto newline = static_cast<const char *>(memchr(p, '\n', end - p));
+  return newline ? newline : end;
+}
+
+// Calls fn with the start and the end of every line of the chunk
+template <typename Fn> void forEachLine(const ObjChunk &chunk, Fn &&fn) {
+  for (auto line = chunk.begin; line < chunk.end;) {
+    auto lineEnd = findLineEnd(line, chunk.end);
+    fn(line, lineEnd);
+    line = lineEnd + 1;
+  }
+}
+
+// Skips the keyword of a line, returning what it is along with the start of its arguments
+ObjLine parseKeyword(const char *&p, const char *lineEnd) {
+  p = skipSpaces(p, lineEnd);
+  if (lineEnd - p >= 2 && isSpace(p[1])) {
+    if (p[0] == 'v') {
+      p += 2;
+      return ObjLine::POSITION;
+    }
+    if (p[0] == 'f') {
+      p += 2;
+      return ObjLine::FACE;
+    }
+  }
+  return ObjLine::OTHER;
+}
+
+// Parses a decimal number, without the locale dependency and the overhead of strtof
+bool parseFloat(const char *&p, const char *end, float &value) {
+  p = skipSpaces(p, end);
+
+  bool negative = p < end && *p == '-';
+  if (p < end && (*p == '-' || *p == '+')) {
+    ++p;
+  }
+
+  double mantissa = 0.0;
+  int    exponent = 0;
+  bool   digits   = false;
+  for (; p < end && *p >= '0' && *p <= '9'; ++p, digits = true) {
+    mantissa = mantissa * 10.0 + (*p - '0');
+  }
+  if (p < end && *p == '.') {
+    for (++p; p < end && *p >= '0' && *p <= '9'; ++p, digits = true) {
+      mantissa = mantissa * 10.0 + (*p - '0');
+      --exponent;
+    }
+  }
+  if (!digits) {
+    return false;
+  }
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    ++p;
+    bool negativeExponent = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+')) {
+      ++p;
+    }
+    int explicitExponent = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+      explicitExponent = std::min(explicitExponent * 10 + (*p - '0'), 1000);
+    }
+    exponent += negativeExponent ? -explicitExponent : explicitExponent;
+  }
+
+  static const double powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                  1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                  1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  if (exponent >= -22 && exponent <= 22) {
+    mantissa = exponent < 0 ? mantissa / powers[-exponent] : mantissa * powers[exponent];
+  } else {
+    mantissa *= std::pow(10.0, exponent);
+  }
+
+  value = static_cast<float>(negative ? -mantissa : mantissa);
+  return true;
+}
+
+// Parses the next "v", "v/vt", "v//vn" or "v/vt/vn" reference of a face, keeping the position
+bool parseFaceReference(const char *&p, const char *end, int64_t &index) {
+  p = skipSpaces(p, end);
+  if (p == end || *p == '#') {
+    return false;
+  }
+
+  bool negative = *p == '-';
+  if (*p == '-' || *p == '+') {
+    ++p;
+  }
+  index = 0;
+  for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+    index = std::min<int64_t>(index * 10 + (*p - '0'), INT64_MAX / 10);
+  }
+  if (negative) {
+    index = -index;
+  }
+
+  // Skip the texture coordinate and normal indices
+  while (p < end && !isSpace(*p)) {
+    ++p;
+  }
+  return true;
+}
+
+// The lowercase extension of a path, without the dot
+std::string getExtension(const std::string &path) {
+  auto extension = path.substr(path.find_last_of('.') + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return extension;
+}
+
+} // namespace
+
+// Generates the geometry straight into the staging memory of the buffers of a new mesh
+class MeshImporter::MeshTarget : public MeshImporter::Target {
+public:
+  explicit MeshTarget(const std::shared_ptr<Device> &device) : mDevice{device} {}
+
+  void create(uint32_t vertexCount, uint32_t indexCount) override {
+    mMesh = std::make_unique<Mesh>(mDevice, vertexCount, indexCount, VertexFormat::FLOAT,
+                                   IndexBuffer::selectIndexType(vertexCount));
+  }
+
+  void write(Stream stream, const std::vector<VkDeviceSize> &offsets,
+             const std::function<void(size_t, void *)> &fill) override {
+    auto &streamingBatcher = mDevice->getStreamingBatcher();
+    if (stream == Stream::VERTEX) {
+      streamingBatcher.upload(*mMesh->getVertexBuffer(), offsets, fill);
+      return;
+    }
+
+    // Indices are generated as 32 bit ones, narrowed from a copy of each range if 16 bit
+    const auto          &indexBuffer = *mMesh->getIndexBuffer();
+    auto                 indexType   = indexBuffer.getIndexType();
+    UploadBatcher::Token token;
+    if (indexType == VK_INDEX_TYPE_UINT32) {
+      token = streamingBatcher.upload(indexBuffer, offsets, fill);
+    } else {
+      std::vector<VkDeviceSize> encodedOffsets;
+      for (auto offset : offsets) {
+        encodedOffsets.push_back(offset / sizeof(uint32_t) * IndexBuffer::getIndexSize(indexType));
+      }
+      token = streamingBatcher.upload(indexBuffer, encodedOffsets, [&](size_t i, void *data) {
+        std::vector<uint32_t> indices((offsets[i + 1] - offsets[i]) / sizeof(uint32_t));
+        fill(i, indices.data());
+        IndexBuffer::encode(indices.data(), indices.size(), indexType, data);
+      });
+    }
+    // Batches complete in submission order, and the indices are written last
+    mMesh->setUploadToken(token);
+  }
+
+  void setSubmeshes(std::vector<Submesh> submeshes) override {
+    mMesh->setSubmeshes(std::move(submeshes));
+  }
+
+  std::unique_ptr<Mesh> release() { return std::move(mMesh); }
+
+private:
+  const std::shared_ptr<Device> &mDevice;
+  std::unique_ptr<Mesh>          mMesh;
+};
+
+// Generates the geometry into memory, to be written to a file
+class MeshImporter::MemoryTarget : public MeshImporter::Target {
+public:
+  void create(uint32_t vertexCount, uint32_t indexCount) override {
+    vertices.resize(vertexCount);
+    indices.resize(indexCount);
+  }
+
+  void write(Stream stream, const std::vector<VkDeviceSize> &offsets,
+             const std::function<void(size_t, void *)> &fill) override {
+    auto data = stream == Stream::VERTEX ? reinterpret_cast<uint8_t *>(vertices.data())
+                                         : reinterpret_cast<uint8_t *>(indices.data());
+    parallel::forEach(offsets.size() - 1, [&](size_t i) { fill(i, data + offsets[i]); });
+  }
+
+  void setSubmeshes(std::vector<Submesh> submeshes) override {
+    this->submeshes = std::move(submeshes);
+  }
+
+  std::vector<Vertex>   vertices;
+  std::vector<uint32_t> indices;
+  std::vector<Submesh>  submeshes;
+  // Set by prepare()
+  std::vector<IndexRange> ranges;
+  std::vector<Lod>        lods;
+  VkPrimitiveTopology     topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+};
+
+MeshImporter::MeshImporter(const std::shared_ptr<Device> &device) : mDevice{device} {}
+
+std::unique_ptr<Mesh> MeshImporter::import(const std::string &path, VertexFormat vertexFormat,
+                                           bool optimize, bool strips, bool lods) {
+  PROFILE_FUNCTION();
+  auto startTime = std::chrono::steady_clock::now();
+
+  std::unique_ptr<Mesh> mesh;
+  if (getExtension(path) == "mesh") {
+    mesh = load(path);
+  } else if (vertexFormat == VertexFormat::FLOAT && !optimize && !strips && !lods) {
+    MeshTarget target(mDevice);
+    import(path, target);
+    mesh = target.release();
+  } else {
+    MemoryTarget target;
+    import(path, target);
+    prepare(target, optimize, strips, lods);
+    mesh = upload(target, vertexFormat);
+  }
+
+  const auto &indexBuffer = mesh->getIndexBuffer();
+  log_info("Import mesh {}: {} vertices, {} indices of {} bytes in {} ranges, {} levels of "
+           "detail in {:.2f} ms",
+           path, mesh->getVertexBuffer()->getCount(), indexBuffer->getIndexCount(),
+           IndexBuffer::getIndexSize(indexBuffer->getIndexType()), mesh->getIndexRanges().size(),
+           mesh->getLods().size(),
+           std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime)
+               .count());
+  return mesh;
+}
+
+void MeshImporter::convert(const std::string &path, const std::string &meshFilePath,
+                           VertexFormat vertexFormat, bool optimize, bool strips, bool lods) {
+  MemoryTarget target;
+  import(path, target);
+  prepare(target, optimize, strips, lods);
+
+  const auto &layout   = VertexLayout::get(vertexFormat);
+  const auto *imported = target.vertices.data();
+  auto        count    = target.vertices.size();
+
+  auto                 dequantization = layout.computeDequantization(imported, count);
+  std::vector<uint8_t> vertices(count * layout.getStride());
+  layout.encode(imported, count, dequantization, vertices.data());
+
+  auto                 indexType = IndexBuffer::selectIndexType(target.ranges);
+  std::vector<uint8_t> indices(target.indices.size() * IndexBuffer::getIndexSize(indexType));
+  IndexBuffer::encode(target.indices.data(), target.indices.size(), indexType, indices.data());
+
+  MeshFile::write(meshFilePath, vertices.data(), static_cast<uint32_t>(count), vertexFormat,
+                  dequantization, indices.data(), static_cast<uint32_t>(target.indices.size()),
+                  indexType, target.topology, target.ranges, target.lods, target.submeshes);
+}
+
+void MeshImporter::prepare(MemoryTarget &target, bool optimize, bool strips, bool lods) {
+  if (optimize) {
+    MeshOptimizer::optimize(target.vertices, target.indices, target.submeshes);
+  }
+
+  auto vertexCount = static_cast<uint32_t>(target.vertices.size());
+  auto indexCount  = static_cast<uint32_t>(target.indices.size());
+  if (vertexCount > MAX_SHORT_INDEXED_VERTEX_COUNT) {
+    target.ranges = MeshOptimizer::splitIndexRanges(target.vertices, target.indices,
+                                                    MAX_SHORT_INDEXED_VERTEX_COUNT);
+    log_info("Split mesh for 16 bit indices: {} -> {} vertices in {} ranges", vertexCount,
+             target.vertices.size(), target.ranges.size());
+  } else {
+    target.ranges = {{0, indexCount, 0, vertexCount}};
+  }
+
+  if (lods) {
+    target.lods = MeshSimplifier::generateLods(target.vertices, target.indices, target.ranges);
+    for (const auto &lod : target.lods) {
+      uint32_t lodIndexCount = 0;
+      for (uint32_t i = 0; i < lod.rangeCount; ++i) {
+        lodIndexCount += target.ranges[lod.firstRange + i].indexCount;
+      }
+      log_info("Generate level of detail: {} triangles, error {:.5f}", lodIndexCount / 3,
+               lod.error);
+    }
+  } else {
+    target.lods = {{0, static_cast<uint32_t>(target.ranges.size()), 0.0f}};
+  }
+
+  if (strips) {
+    indexCount = static_cast<uint32_t>(target.indices.size());
+    MeshOptimizer::generateStrips(target.indices, target.ranges, target.submeshes);
+    target.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+    log_info("Generate strips: {} -> {} indices", indexCount, target.indices.size());
+  }
+}
+
+void MeshImporter::import(const std::string &path, Target &target) {
+  auto extension = getExtension(path);
+  if (extension == "obj") {
+    importObj(path, target);
+  } else if (extension == "gltf" || extension == "glb") {
+    importGltf(path, target);
+  } else {
+    throw std::runtime_error("Unsupported mesh format: " + path);
+  }
+}
+
+std::unique_ptr<Mesh> MeshImporter::load(const std::string &path) {
+  MeshFile    file(path);
+  const auto &header = file.getHeader();
+
+  // The streams are already laid out as the buffers, the mapped pages are copied as they are
+  auto mesh = std::make_unique<Mesh>(mDevice, header.vertexCount, header.indexCount,
+                                     header.vertexFormat, file.getIndexType());
+  mesh->setDequantization(file.getDequantization());
+  mesh->setIndexRanges(file.getIndexRanges());
+  mesh->setLods(file.getLods());
+  mesh->setTopology(header.topology);
+  auto &streamingBatcher = mDevice->getStreamingBatcher();
+  streamingBatcher.upload(*mesh->getVertexBuffer(), file.getVertices(),
+                          file.getVertexStreamSize());
+  mesh->setUploadToken(streamingBatcher.upload(*mesh->getIndexBuffer(), file.getIndices(),
+                                               file.getIndexStreamSize()));
+  mesh->setSubmeshes(file.getSubmeshes());
+  return mesh;
+}
+
+std::unique_ptr<Mesh> MeshImporter::upload(const MemoryTarget &target, VertexFormat vertexFormat) {
+  const auto &layout      = VertexLayout::get(vertexFormat);
+  const auto *vertices    = target.vertices.data();
+  auto        vertexCount = static_cast<uint32_t>(target.vertices.size());
+  auto        indexCount  = static_cast<uint32_t>(target.indices.size());
+  auto        indexType   = IndexBuffer::selectIndexType(target.ranges);
+
+  auto mesh =
+      std::make_unique<Mesh>(mDevice, vertexCount, indexCount, vertexFormat, indexType);
+  auto dequantization = layout.computeDequantization(vertices, vertexCount);
+  mesh->setDequantization(dequantization);
+  mesh->setIndexRanges(target.ranges);
+  mesh->setLods(target.lods);
+  mesh->setTopology(target.topology);
+
+  // Encoded in parallel by chunks, straight into staging memory
+  std::vector<VkDeviceSize> offsets;
+  for (uint32_t first = 0; first < vertexCount; first += ENCODE_CHUNK_VERTEX_COUNT) {
+    offsets.push_back(VkDeviceSize{first} * layout.getStride());
+  }
+  offsets.push_back(VkDeviceSize{vertexCount} * layout.getStride());
+  auto &streamingBatcher = mDevice->getStreamingBatcher();
+  streamingBatcher.upload(*mesh->getVertexBuffer(), offsets, [&](size_t i, void *data) {
+    auto first = i * ENCODE_CHUNK_VERTEX_COUNT;
+    auto count = std::min<size_t>(ENCODE_CHUNK_VERTEX_COUNT, vertexCount - first);
+    layout.encode(vertices + first, count, dequantization, data);
+  });
+  offsets.clear();
+  for (uint32_t first = 0; first < indexCount; first += ENCODE_CHUNK_INDEX_COUNT) {
+    offsets.push_back(VkDeviceSize{first} * IndexBuffer::getIndexSize(indexType));
+  }
+  offsets.push_back(VkDeviceSize{indexCount} * IndexBuffer::getIndexSize(indexType));
+  mesh->setUploadToken(
+      streamingBatcher.upload(*mesh->getIndexBuffer(), offsets, [&](size_t i, void *data) {
+        auto first = i * ENCODE_CHUNK_INDEX_COUNT;
+        auto count = std::min<size_t>(ENCODE_CHUNK_INDEX_COUNT, indexCount - first);
+        IndexBuffer::encode(target.indices.data() + first, count, indexType, data);
+      }));
+  mesh->setSubmeshes(target.submeshes);
+  return mesh;
+}
+
+void MeshImporter::importObj(const std::string &path, Target &target) {
+  filesystem::MappedFile file(path);
+  auto                   data = reinterpret_cast<const char *>(file.data());
+  auto                   end  = data + file.size();
+
+  // Split the file at line boundaries
+  std::vector<ObjChunk> chunks;
+  for (auto begin = data; begin < end;) {
+    auto chunkEnd = begin + std::min<size_t>(OBJ_CHUNK_SIZE, end - begin);
+    if (chunkEnd < end) {
+      chunkEnd = std::min(findLineEnd(chunkEnd, end) + 1, end);
+    }
+    chunks.push_back({begin, chunkEnd});
+    begin = chunkEnd;
+  }
+
+  // Count the positions and triangles of every chunk, so that each one knows where its output
+  // goes before parsing it
+  parallel::forEach(chunks.size(), [&](size_t i) {
+    auto &chunk = chunks[i];
+    forEachLine(chunk, [&](const char *p, const char *lineEnd) {
+      auto keyword = parseKeyword(p, lineEnd);
+      if (keyword == ObjLine::POSITION) {
+        ++chunk.vertexCount;
+      } else if (keyword == ObjLine::FACE) {
+        int64_t  index;
+        uint64_t referenceCount = 0;
+        while (parseFaceReference(p, lineEnd, index)) {
+          ++referenceCount;
+        }
+        chunk.indexCount += referenceCount >= 3 ? (referenceCount - 2) * 3 : 0;
+      }
+    });
+  });
+
+  std::vector<uint64_t> vertexBases{0};
+  std::vector<uint64_t> indexBases{0};
+  for (const auto &chunk : chunks) {
+    vertexBases.push_back(vertexBases.back() + chunk.vertexCount);
+    indexBases.push_back(indexBases.back() + chunk.indexCount);
+  }
+  auto vertexCount = vertexBases.back();
+  auto indexCount  = indexBases.back();
+  if (indexCount == 0) {
+    throw std::runtime_error("No triangle in mesh: " + path);
+  }
+  if (vertexCount > UINT32_MAX || indexCount > UINT32_MAX) {
+    throw std::runtime_error("Too many vertices or indices in mesh: " + path);
+  }
+
+  target.create(static_cast<uint32_t>(vertexCount), static_cast<uint32_t>(indexCount));
+
+  // Parse the positions of each chunk into the target
+  std::vector<VkDeviceSize> offsets;
+  for (auto base : vertexBases) {
+    offsets.push_back(base * sizeof(Vertex));
+  }
+  target.write(Stream::VERTEX, offsets, [&](size_t i, void *data) {
+    auto &chunk  = chunks[i];
+    auto  vertex = static_cast<Vertex *>(data);
+    forEachLine(chunk, [&](const char *line, const char *lineEnd) {
+      auto p = line;
+      if (parseKeyword(p, lineEnd) != ObjLine::POSITION) {
+        return;
+      }
+
+      glm::vec3 position{}, color{};
+      for (int j = 0; j < 3; ++j) {
+        if (!parseFloat(p, lineEnd, position[j])) {
+          throw std::runtime_error(fmt::format("Invalid position in mesh {}: {}", path,
+                                               std::string(line, lineEnd)));
+        }
+      }
+      // Optional vertex color, which is all or nothing
+      bool hasColor = true;
+      for (int j = 0; j < 3 && hasColor; ++j) {
+        hasColor = parseFloat(p, lineEnd, color[j]);
+      }
+
+      chunk.boundsMin = glm::min(chunk.boundsMin, position);
+      chunk.boundsMax = glm::max(chunk.boundsMax, position);
+      *vertex++       = {position, hasColor ? color : DEFAULT_COLOR};
+    });
+  });
+
+  // Parse the faces of each chunk into the target, resolving relative indices against the
+  // positions defined so far
+  offsets.clear();
+  for (auto base : indexBases) {
+    offsets.push_back(base * sizeof(uint32_t));
+  }
+  target.write(Stream::INDEX, offsets, [&](size_t i, void *data) {
+    auto    index         = static_cast<uint32_t *>(data);
+    int64_t positionCount = vertexBases[i];
+    forEachLine(chunks[i], [&](const char *p, const char *lineEnd) {
+      auto keyword = parseKeyword(p, lineEnd);
+      if (keyword == ObjLine::POSITION) {
+        ++positionCount;
+        return;
+      }
+      if (keyword != ObjLine::FACE) {
+        return;
+      }
+
+      int64_t  reference;
+      uint32_t first = 0, previous = 0;
+      for (uint32_t j = 0; parseFaceReference(p, lineEnd, reference); ++j) {
+        auto resolved = reference > 0 ? reference - 1 : positionCount + reference;
+        if (reference == 0 || resolved < 0 || resolved >= static_cast<int64_t>(vertexCount)) {
+          throw std::runtime_error(
+              fmt::format("Invalid vertex index {} in mesh {}", reference, path));
+        }
+
+        auto current = static_cast<uint32_t>(resolved);
+        if (j == 0) {
+          first = current;
+        } else if (j >= 2) {
+          *index++ = first;
+          *index++ = previous;
+          *index++ = current;
+        }
+        previous = current;
+      }
+    });
+  });
+
+  Submesh submesh{0, static_cast<uint32_t>(indexCount), glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)};
+  for (const auto &chunk : chunks) {
+    submesh.boundsMin = glm::min(submesh.boundsMin, chunk.boundsMin);
+    submesh.boundsMax = glm::max(submesh.boundsMax, chunk.boundsMax);
+  }
+  target.setSubmeshes({submesh});
+}
@@ -0,0 +1,529 @@
+#include "MeshOptimizer.h"
+#include "Log.h"
+#include "Parallel.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+// Entries of the FIFO post-transform cache the orders are optimized for and measured with
+#define VERTEX_CACHE_SIZE 16
+// How much worse than its hard cluster a soft cluster may use the vertex cache, when splitting for
+// overdraw. Smaller clusters sort better, but break the order optimized for the cache more often.
+#define OVERDRAW_THRESHOLD 1.05f
+// Number of the next triangles of a list searched for one continuing the current strip
+#define STRIP_BUFFER_SIZE 16
+
+static_assert(sizeof(Vertex) == 24, "Vertices are hashed and compared as bytes");
+
+namespace {
+
+// Simulates a FIFO cache with time stamps, a vertex being cached if transformed at most
+// VERTEX_CACHE_SIZE misses ago, itself included
+class VertexCache {
+public:
+  // For the vertices [base, base + count)
+  VertexCache(uint32_t base, size_t count) : mBase{base}, mTimestamps(count, 0) {}
+
+  // Whether the vertex misses, transforming it then
+  bool access(uint32_t vertex) {
+    auto &timestamp = mTimestamps[vertex - mBase];
+    if (mTime - timestamp <= VERTEX_CACHE_SIZE) {
+      return false;
+    }
+    timestamp = mTime++;
+    return true;
+  }
+
+  // Misses of the three vertices of a triangle
+  uint32_t access(const uint32_t *triangle) {
+    return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+  }
+
+  // Evicts every vertex
+  void reset() { mTime += VERTEX_CACHE_SIZE; }
+
+private:
+  uint32_t              mBase;
+  std::vector<uint32_t> mTimestamps;
+  uint32_t              mTime = VERTEX_CACHE_SIZE + 1;
+};
+
+// The range of vertices referenced by a triangle list, [base, base + count)
+void getVertexRange(const uint32_t *indices, size_t indexCount, uint32_t &base, size_t &count) {
+  if (indexCount == 0) {
+    base  = 0;
+    count = 0;
+    return;
+  }
+  auto [min, max] = std::minmax_element(indices, indices + indexCount);
+  base            = *min;
+  count           = size_t{*max} - *min + 1;
+}
+
+// Whether the triangle has the edge from a to b in its winding
+bool hasEdge(const uint32_t *triangle, uint32_t a, uint32_t b) {
+  return (triangle[0] == a && triangle[1] == b) || (triangle[1] == a && triangle[2] == b) ||
+         (triangle[2] == a && triangle[0] == b);
+}
+
+// Appends the strips of a triangle list to the output, each ended by the restart index. Greedy:
+// the strip goes on with any buffered triangle having its last edge in the winding the strip
+// expects, and restarts from the oldest buffered triangle otherwise.
+void stripify(const uint32_t *indices, size_t indexCount, std::vector<uint32_t> &output) {
+  auto                triangleCount = indexCount / 3;
+  size_t              nextTriangle  = 0;
+  std::vector<size_t> buffer;
+  // The last two vertices of the strip, and its number of vertices
+  uint32_t a = 0, b = 0;
+  size_t   stripLength = 0;
+
+  while (true) {
+    while (buffer.size() < STRIP_BUFFER_SIZE && nextTriangle < triangleCount) {
+      buffer.push_back(nextTriangle++);
+    }
+    if (buffer.empty()) {
+      break;
+    }
+
+    // Triangle i of a strip is (i, i + 1, i + 2) for even i and (i + 1, i, i + 2) for odd i,
+    // thus the next one must start with the edge (a, b) or (b, a)
+    bool continued = false;
+    if (stripLength > 0) {
+      auto odd = (stripLength - 2) % 2 == 1;
+      auto p   = odd ? b : a;
+      auto q   = odd ? a : b;
+      for (size_t i = 0; i < buffer.size() && !continued; ++i) {
+        const auto *triangle = indices + buffer[i] * 3;
+        for (uint32_t j = 0; j < 3; ++j) {
+          if (triangle[j] == p && triangle[(j + 1) % 3] == q) {
+            a = b;
+            b = triangle[(j + 2) % 3];
+            output.push_back(b);
+            ++stripLength;
+            buffer.erase(buffer.begin() + static_cast<ptrdiff_t>(i));
+            continued = true;
+            break;
+          }
+        }
+      }
+    }
+    if (continued) {
+      continue;
+    }
+
+    // Restart, rotating the triangle so that the strip may go on with a buffered neighbor, which
+    // would have the last edge reversed
+    if (stripLength > 0) {
+      output.push_back(PRIMITIVE_RESTART_INDEX);
+    }
+    const auto *triangle = indices + buffer[0] * 3;
+    buffer.erase(buffer.begin());
+    uint32_t rotation = 0;
+    for (uint32_t j = 0; j < 3; ++j) {
+      auto from = triangle[(j + 2) % 3];
+      auto to   = triangle[(j + 1) % 3];
+      if (std::any_of(buffer.begin(), buffer.end(),
+                      [&](size_t neighbor) { return hasEdge(indices + neighbor * 3, from, to); })) {
+        rotation = j;
+        break;
+      }
+    }
+    for (uint32_t j = 0; j < 3; ++j) {
+      output.push_back(triangle[(rotation + j) % 3]);
+    }
+    a           = triangle[(rotation + 1) % 3];
+    b           = triangle[(rotation + 2) % 3];
+    stripLength = 3;
+  }
+
+  if (stripLength > 0) {
+    output.push_back(PRIMITIVE_RESTART_INDEX);
+  }
+}
+
+uint32_t hashVertex(const Vertex &vertex) {
+  uint32_t words[sizeof(Vertex) / sizeof(uint32_t)];
+  memcpy(words, &vertex, sizeof(Vertex));
+
+  // MurmurHash2 mixing of the words
+  uint32_t hash = 0;
+  for (auto word : words) {
+    word *= 0x5bd1e995;
+    word ^= word >> 24;
+    word *= 0x5bd1e995;
+    hash *= 0x5bd1e995;
+    hash ^= word;
+  }
+  return hash;
+}
+
+} // namespace
+
+void MeshOptimizer::optimize(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices,
+                             const std::vector<Submesh> &submeshes) {
+  PROFILE_FUNCTION();
+  auto vertexCount = vertices.size();
+  auto before      = analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+  weldVertices(vertices, indices);
+
+  // Triangles only move within their submesh, for the submeshes to remain ranges of the list
+  auto ranges = submeshes;
+  if (ranges.empty()) {
+    ranges.push_back({0, static_cast<uint32_t>(indices.size())});
+  }
+  parallel::forEach(ranges.size(), [&](size_t i) {
+    auto *first = indices.data() + ranges[i].firstIndex;
+    optimizeVertexCache(first, ranges[i].indexCount);
+    optimizeOverdraw(first, ranges[i].indexCount, vertices);
+  });
+
+  optimizeVertexFetch(vertices, indices);
+
+  auto after = analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+  log_info("Optimize mesh: {} -> {} vertices, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}",
+           vertexCount, vertices.size(), before.acmr, after.acmr, before.atvr, after.atvr);
+}
+
+void MeshOptimizer::weldVertices(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+  // Open addressing table of the unique vertices, which are compacted at the front as they are
+  // found, thus never overwritten before being compared against
+  size_t capacity = 16;
+  while (capacity < vertices.size() * 2) {
+    capacity *= 2;
+  }
+  std::vector<uint32_t> table(capacity, UINT32_MAX);
+  std::vector<uint32_t> remap(vertices.size());
+  uint32_t              uniqueCount = 0;
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    auto slot = hashVertex(vertices[i]) & (capacity - 1);
+    while (table[slot] != UINT32_MAX &&
+           memcmp(&vertices[table[slot]], &vertices[i], sizeof(Vertex)) != 0) {
+      slot = (slot + 1) & (capacity - 1);
+    }
+    if (table[slot] == UINT32_MAX) {
+      table[slot]             = uniqueCount;
+      vertices[uniqueCount++] = vertices[i];
+    }
+    remap[i] = table[slot];
+  }
+
+  vertices.resize(uniqueCount);
+  for (auto &index : indices) {
+    index = remap[index];
+  }
+}
+
+void MeshOptimizer::optimizeVertexCache(uint32_t *indices, size_t indexCount) {
+  auto     triangleCount = indexCount / 3;
+  uint32_t base;
+  size_t   vertexCount;
+  getVertexRange(indices, indexCount, base, vertexCount);
+  if (triangleCount == 0) {
+    return;
+  }
+
+  std::vector<uint32_t> input(indexCount);
+  for (size_t i = 0; i < indexCount; ++i) {
+    input[i] = indices[i] - base;
+  }
+
+  // Triangles of each vertex, and how many of them are still to be emitted
+  std::vector<uint32_t> liveCounts(vertexCount, 0);
+  for (auto vertex : input) {
+    ++liveCounts[vertex];
+  }
+  std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+  std::partial_sum(liveCounts.begin(), liveCounts.end(), adjacencyOffsets.begin() + 1);
+  std::vector<uint32_t> adjacency(indexCount);
+  std::vector<uint32_t> adjacencyCursors(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+  for (size_t i = 0; i < indexCount; ++i) {
+    adjacency[adjacencyCursors[input[i]]++] = static_cast<uint32_t>(i / 3);
+  }
+
+  // Cache time stamps, starting out of the cache
+  std::vector<uint32_t> timestamps(vertexCount, 0);
+  uint32_t              time = VERTEX_CACHE_SIZE + 1;
+  std::vector<bool>     emitted(triangleCount, false);
+  // Vertices of the emitted triangles, to fan around next when the candidates are dead ends
+  std::vector<uint32_t> deadEnds;
+  std::vector<uint32_t> candidates;
+  size_t                scanCursor = 0;
+  size_t                outputSize = 0;
+
+  int64_t fanning = input[0];
+  while (fanning >= 0) {
+    // Emit every triangle around the fanning vertex
+    candidates.clear();
+    for (auto i = adjacencyOffsets[fanning]; i < adjacencyOffsets[fanning + 1]; ++i) {
+      auto triangle = adjacency[i];
+      if (emitted[triangle]) {
+        continue;
+      }
+      emitted[triangle] = true;
+      for (uint32_t j = 0; j < 3; ++j) {
+        auto vertex           = input[triangle * 3 + j];
+        indices[outputSize++] = vertex + base;
+        deadEnds.push_back(vertex);
+        candidates.push_back(vertex);
+        --liveCounts[vertex];
+        if (time - timestamps[vertex] > VERTEX_CACHE_SIZE) {
+          timestamps[vertex] = time++;
+        }
+      }
+    }
+
+    // The next one is the oldest candidate still in the cache once its triangles are emitted, each
+    // of them transforming at most two more vertices, or any candidate with triangles left
+    fanning          = -1;
+    int64_t priority = -1;
+    for (auto vertex : candidates) {
+      if (liveCounts[vertex] == 0) {
+        continue;
+      }
+      int64_t age       = time - timestamps[vertex];
+      int64_t candidate = age + 2 * liveCounts[vertex] <= VERTEX_CACHE_SIZE ? age : 0;
+      if (candidate > priority) {
+        priority = candidate;
+        fanning  = vertex;
+      }
+    }
+
+    // Dead end, back to the most recent vertex with triangles left, or to the next one in order
+    while (fanning < 0 && !deadEnds.empty()) {
+      auto vertex = deadEnds.back();
+      deadEnds.pop_back();
+      if (liveCounts[vertex] > 0) {
+        fanning = vertex;
+      }
+    }
+    for (; fanning < 0 && scanCursor < vertexCount; ++scanCursor) {
+      if (liveCounts[scanCursor] > 0) {
+        fanning = static_cast<int64_t>(scanCursor);
+      }
+    }
+  }
+}
+
+void MeshOptimizer::optimizeOverdraw(uint32_t *indices, size_t indexCount,
+                                     const std::vector<Vertex> &vertices) {
+  auto     triangleCount = indexCount / 3;
+  uint32_t base;
+  size_t   vertexCount;
+  getVertexRange(indices, indexCount, base, vertexCount);
+  if (triangleCount < 2) {
+    return;
+  }
+
+  // Hard boundaries where every vertex of a triangle misses, the cache order jumping elsewhere
+  VertexCache           cache(base, vertexCount);
+  std::vector<uint32_t> misses(triangleCount);
+  std::vector<size_t>   hardStarts;
+  for (size_t i = 0; i < triangleCount; ++i) {
+    misses[i] = cache.access(indices + i * 3);
+    if (i == 0 || misses[i] == 3) {
+      hardStarts.push_back(i);
+    }
+  }
+  hardStarts.push_back(triangleCount);
+
+  // Soft boundaries within the hard clusters, wherever the cache has been used about as well as
+  // over the whole hard cluster since the previous boundary
+  std::vector<size_t> clusterStarts;
+  for (size_t i = 0; i + 1 < hardStarts.size(); ++i) {
+    auto start      = hardStarts[i];
+    auto end        = hardStarts[i + 1];
+    auto hardMisses = std::accumulate(misses.begin() + start, misses.begin() + end, size_t{0});
+    auto threshold  = OVERDRAW_THRESHOLD * hardMisses / (end - start);
+
+    cache.reset();
+    clusterStarts.push_back(start);
+    size_t softMisses = 0;
+    for (auto j = start; j < end; ++j) {
+      softMisses += cache.access(indices + j * 3);
+      if (j + 1 < end && softMisses <= threshold * (j + 1 - clusterStarts.back())) {
+        cache.reset();
+        clusterStarts.push_back(j + 1);
+        softMisses = 0;
+      }
+    }
+  }
+  clusterStarts.push_back(triangleCount);
+
+  // Area weighted centroid and normal of every cluster
+  struct Cluster {
+    size_t    start;
+    size_t    end;
+    glm::vec3 centroid{0.0f};
+    glm::vec3 normal{0.0f};
+    float     area = 0.0f;
+    float     key  = 0.0f;
+  };
+  std::vector<Cluster> clusters;
+  glm::vec3            meshCentroid(0.0f);
+  float                meshArea = 0.0f;
+  for (size_t i = 0; i + 1 < clusterStarts.size(); ++i) {
+    Cluster cluster{clusterStarts[i], clusterStarts[i + 1]};
+    for (auto j = cluster.start; j < cluster.end; ++j) {
+      const auto &p0     = vertices[indices[j * 3]].position;
+      const auto &p1     = vertices[indices[j * 3 + 1]].position;
+      const auto &p2     = vertices[indices[j * 3 + 2]].position;
+      auto        normal = glm::cross(p1 - p0, p2 - p0);
+      auto        area   = glm::length(normal);
+      cluster.centroid += (p0 + p1 + p2) * (area / 3.0f);
+      cluster.normal += normal;
+      cluster.area += area;
+    }
+    meshCentroid += cluster.centroid;
+    meshArea += cluster.area;
+    if (cluster.area > 0.0f) {
+      cluster.centroid /= cluster.area;
+    }
+    clusters.push_back(cluster);
+  }
+  if (meshArea > 0.0f) {
+    meshCentroid /= meshArea;
+  }
+
+  // Clusters facing away from the center are on the outside of the mesh, and drawn first
+  for (auto &cluster : clusters) {
+    auto length = glm::length(cluster.normal);
+    if (length > 0.0f) {
+      cluster.key = glm::dot(cluster.centroid - meshCentroid, cluster.normal) / length;
+    }
+  }
+  std::stable_sort(clusters.begin(), clusters.end(),
+                   [](const Cluster &a, const Cluster &b) { return a.key > b.key; });
+
+  std::vector<uint32_t> input(indices, indices + indexCount);
+  auto                  output = indices;
+  for (const auto &cluster : clusters) {
+    output = std::copy(input.begin() + cluster.start * 3, input.begin() + cluster.end * 3, output);
+  }
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<Vertex>   &vertices,
+                                        std::vector<uint32_t> &indices) {
+  std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+  std::vector<Vertex>   reordered;
+  reordered.reserve(vertices.size());
+  for (auto &index : indices) {
+    if (remap[index] == UINT32_MAX) {
+      remap[index] = static_cast<uint32_t>(reordered.size());
+      reordered.push_back(vertices[index]);
+    }
+    index = remap[index];
+  }
+  vertices = std::move(reordered);
+}
+
+std::vector<IndexRange> MeshOptimizer::splitIndexRanges(std::vector<Vertex>   &vertices,
+                                                        std::vector<uint32_t> &indices,
+                                                        uint32_t               maxVertexCount) {
+  // The range each vertex was last copied to, and where
+  std::vector<uint32_t>   remapRanges(vertices.size(), UINT32_MAX);
+  std::vector<uint32_t>   remap(vertices.size());
+  std::vector<Vertex>     output;
+  std::vector<IndexRange> ranges{{0, 0, 0, 0}};
+  output.reserve(vertices.size());
+
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    // Vertices repeated by degenerate triangles are counted twice, ending a range a bit early
+    auto rangeIndex = static_cast<uint32_t>(ranges.size() - 1);
+    auto newCount   = (remapRanges[indices[i]] != rangeIndex) +
+                      (remapRanges[indices[i + 1]] != rangeIndex) +
+                      (remapRanges[indices[i + 2]] != rangeIndex);
+    if (ranges.back().vertexCount + newCount > maxVertexCount) {
+      if (output.size() > INT32_MAX) {
+        throw std::runtime_error("Too many vertices to split into index ranges");
+      }
+      ranges.push_back({static_cast<uint32_t>(i), 0, static_cast<int32_t>(output.size()), 0});
+      ++rangeIndex;
+    }
+
+    auto &range = ranges.back();
+    for (size_t j = i; j < i + 3; ++j) {
+      auto vertex = indices[j];
+      if (remapRanges[vertex] != rangeIndex) {
+        remapRanges[vertex] = rangeIndex;
+        remap[vertex]       = range.vertexCount++;
+        output.push_back(vertices[vertex]);
+      }
+      indices[j] = remap[vertex];
+    }
+    range.indexCount += 3;
+  }
+
+  vertices = std::move(output);
+  return ranges;
+}
+
+void MeshOptimizer::generateStrips(std::vector<uint32_t> &indices, std::vector<IndexRange> &ranges,
+                                   std::vector<Submesh> &submeshes) {
+  PROFILE_FUNCTION();
+  // Strips end at the bounds of every range and submesh, which thus remain ranges of the strips
+  std::vector<uint32_t> bounds{0, static_cast<uint32_t>(indices.size())};
+  for (const auto &range : ranges) {
+    bounds.push_back(range.firstIndex);
+    bounds.push_back(range.firstIndex + range.indexCount);
+  }
+  for (const auto &submesh : submeshes) {
+    bounds.push_back(submesh.firstIndex);
+    bounds.push_back(submesh.firstIndex + submesh.indexCount);
+  }
+  std::sort(bounds.begin(), bounds.end());
+  bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+  std::vector<uint32_t> strips;
+  std::vector<uint32_t> stripBounds;
+  strips.reserve(indices.size());
+  for (size_t i = 0; i < bounds.size(); ++i) {
+    stripBounds.push_back(static_cast<uint32_t>(strips.size()));
+    if (i + 1 < bounds.size()) {
+      stripify(indices.data() + bounds[i], bounds[i + 1] - bounds[i], strips);
+    }
+  }
+
+  auto remap = [&](uint32_t &firstIndex, uint32_t &indexCount) {
+    auto first = std::lower_bound(bounds.begin(), bounds.end(), firstIndex) - bounds.begin();
+    auto last =
+        std::lower_bound(bounds.begin(), bounds.end(), firstIndex + indexCount) - bounds.begin();
+    firstIndex = stripBounds[first];
+    indexCount = stripBounds[last] - stripBounds[first];
+  };
+  for (auto &range : ranges) {
+    remap(range.firstIndex, range.indexCount);
+  }
+  for (auto &submesh : submeshes) {
+    remap(submesh.firstIndex, submesh.indexCount);
+  }
+
+  indices = std::move(strips);
+}
+
+MeshOptimizer::Statistics MeshOptimizer::analyzeVertexCache(const uint32_t *indices,
+                                                            size_t indexCount,
+                                                            size_t vertexCount) {
+  VertexCache       cache(0, vertexCount);
+  std::vector<bool> used(vertexCount, false);
+  size_t            missCount = 0, usedCount = 0;
+  for (size_t i = 0; i < indexCount; ++i) {
+    missCount += cache.access(indices[i]);
+    if (!used[indices[i]]) {
+      used[indices[i]] = true;
+      ++usedCount;
+    }
+  }
+
+  Statistics statistics;
+  if (indexCount >= 3) {
+    statistics.acmr = static_cast<float>(missCount) / static_cast<float>(indexCount / 3);
+  }
+  if (usedCount > 0) {
+    statistics.atvr = static_cast<float>(missCount) / static_cast<float>(usedCount);
+  }
+  return statistics;
+}
@@ -0,0 +1,373 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "Parallel.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <tuple>
+
+// Ratio of the triangles of a level of detail to the ones of the previous level
+#define LOD_REDUCTION 0.5f
+// Levels keeping more than this ratio of the triangles of the previous one end the chain, the mesh
+// not simplifying much further
+#define LOD_STOP_RATIO 0.8f
+// Levels of fewer triangles than this end the chain
+#define LOD_MIN_TRIANGLE_COUNT 64
+// Number of levels of a chain at most, the full one included
+#define MAX_LOD_COUNT 8
+// Cosine of the largest rotation a collapse may turn the triangles around the collapsed vertex by,
+// beyond which they are considered flipped
+#define FLIP_THRESHOLD 0.25f
+// Weight of the planes keeping the borders in place, relative to the area weighted planes of the
+// triangles
+#define BORDER_WEIGHT 10.0f
+
+namespace {
+
+// Sum of squared distances to weighted planes, p^T A p + 2 b.p + c for the symmetric matrix A
+struct Quadric {
+  double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+  double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+  double c = 0.0;
+  // Total weight of the planes the error is averaged over
+  double weight = 0.0;
+
+  // The plane normal.p + distance = 0, of a unit normal
+  static Quadric fromPlane(const glm::vec3 &normal, float distance, float weight) {
+    double  x = normal.x, y = normal.y, z = normal.z, d = distance, w = weight;
+    Quadric quadric;
+    quadric.a00    = w * x * x;
+    quadric.a01    = w * x * y;
+    quadric.a02    = w * x * z;
+    quadric.a11    = w * y * y;
+    quadric.a12    = w * y * z;
+    quadric.a22    = w * z * z;
+    quadric.b0     = w * x * d;
+    quadric.b1     = w * y * d;
+    quadric.b2     = w * z * d;
+    quadric.c      = w * d * d;
+    quadric.weight = w;
+    return quadric;
+  }
+
+  Quadric &operator+=(const Quadric &other) {
+    a00 += other.a00;
+    a01 += other.a01;
+    a02 += other.a02;
+    a11 += other.a11;
+    a12 += other.a12;
+    a22 += other.a22;
+    b0 += other.b0;
+    b1 += other.b1;
+    b2 += other.b2;
+    c += other.c;
+    weight += other.weight;
+    return *this;
+  }
+
+  // Mean squared distance of a point to the planes
+  [[nodiscard]] double error(const glm::vec3 &p) const {
+    double x = p.x, y = p.y, z = p.z;
+    double e = a00 * x * x + a11 * y * y + a22 * z * z +
+               2.0 * (a01 * x * y + a02 * x * z + a12 * y * z + b0 * x + b1 * y + b2 * z) + c;
+    return weight > 0.0 ? std::max(e, 0.0) / weight : 0.0;
+  }
+};
+
+enum class VertexKind : uint8_t {
+  // Collapses onto any neighbor
+  MANIFOLD,
+  // Collapses along the border only
+  BORDER,
+  // Stays in place
+  LOCKED,
+};
+
+// Collapse of a vertex onto a neighbor
+struct Collapse {
+  uint32_t from;
+  uint32_t to;
+  float    cost;
+};
+
+// Triangles around each vertex of a triangle list
+class Adjacency {
+public:
+  void build(const std::vector<uint32_t> &indices, size_t vertexCount) {
+    mOffsets.assign(vertexCount + 1, 0);
+    for (auto vertex : indices) {
+      ++mOffsets[vertex + 1];
+    }
+    std::partial_sum(mOffsets.begin(), mOffsets.end(), mOffsets.begin());
+    mCursors.assign(mOffsets.begin(), mOffsets.end() - 1);
+    mTriangles.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i) {
+      mTriangles[mCursors[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+  }
+
+  [[nodiscard]] const uint32_t *begin(uint32_t vertex) const {
+    return mTriangles.data() + mOffsets[vertex];
+  }
+  [[nodiscard]] const uint32_t *end(uint32_t vertex) const {
+    return mTriangles.data() + mOffsets[vertex + 1];
+  }
+
+private:
+  std::vector<uint32_t> mOffsets;
+  std::vector<uint32_t> mCursors;
+  std::vector<uint32_t> mTriangles;
+};
+
+bool hasVertex(const uint32_t *triangle, uint32_t vertex) {
+  return triangle[0] == vertex || triangle[1] == vertex || triangle[2] == vertex;
+}
+
+// Whether no triangle around b has the edge from b to a in its winding, i.e. the edge from a to b
+// is on a border
+bool isBorderEdge(const std::vector<uint32_t> &indices, const Adjacency &adjacency, uint32_t a,
+                  uint32_t b) {
+  return std::none_of(adjacency.begin(b), adjacency.end(b), [&](uint32_t triangle) {
+    const auto *t = &indices[triangle * 3];
+    return (t[0] == b && t[1] == a) || (t[1] == b && t[2] == a) || (t[2] == b && t[0] == a);
+  });
+}
+
+std::vector<VertexKind> classifyVertices(const Vertex *vertices, size_t vertexCount,
+                                         const std::vector<uint32_t> &indices,
+                                         const Adjacency             &adjacency) {
+  std::vector<VertexKind> kinds(vertexCount, VertexKind::MANIFOLD);
+
+  // Vertices sharing their position with others, which would tear the surface apart if moved
+  std::vector<uint32_t> order(vertexCount);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    const auto &p = vertices[a].position, &q = vertices[b].position;
+    return std::tie(p.x, p.y, p.z) < std::tie(q.x, q.y, q.z);
+  });
+  for (size_t i = 1; i < order.size(); ++i) {
+    if (vertices[order[i]].position == vertices[order[i - 1]].position) {
+      kinds[order[i]]     = VertexKind::LOCKED;
+      kinds[order[i - 1]] = VertexKind::LOCKED;
+    }
+  }
+
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    for (size_t j = 0; j < 3; ++j) {
+      auto a = indices[i + j], b = indices[i + (j + 1) % 3];
+      if (!isBorderEdge(indices, adjacency, a, b)) {
+        continue;
+      }
+      for (auto vertex : {a, b}) {
+        if (kinds[vertex] == VertexKind::MANIFOLD) {
+          kinds[vertex] = VertexKind::BORDER;
+        }
+      }
+    }
+  }
+  return kinds;
+}
+
+// The planes of the triangles around each vertex weighted by area, and the planes perpendicular to
+// the triangles through their border edges, which keep the borders from shrinking
+std::vector<Quadric> computeQuadrics(const Vertex *vertices, size_t vertexCount,
+                                     const std::vector<uint32_t> &indices,
+                                     const Adjacency             &adjacency) {
+  std::vector<Quadric> quadrics(vertexCount);
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    const auto *triangle = &indices[i];
+    const auto &p0       = vertices[triangle[0]].position;
+    auto        normal   = glm::cross(vertices[triangle[1]].position - p0,
+                                      vertices[triangle[2]].position - p0);
+    auto        length   = glm::length(normal);
+    if (length == 0.0f) {
+      continue;
+    }
+    normal /= length;
+    auto plane = Quadric::fromPlane(normal, -glm::dot(normal, p0), length * 0.5f);
+    for (size_t j = 0; j < 3; ++j) {
+      quadrics[triangle[j]] += plane;
+    }
+
+    for (size_t j = 0; j < 3; ++j) {
+      auto a = triangle[j], b = triangle[(j + 1) % 3];
+      if (!isBorderEdge(indices, adjacency, a, b)) {
+        continue;
+      }
+      auto edge       = vertices[b].position - vertices[a].position;
+      auto edgeLength = glm::length(edge);
+      if (edgeLength == 0.0f) {
+        continue;
+      }
+      auto borderNormal = glm::normalize(glm::cross(edge, normal));
+      auto border       = Quadric::fromPlane(borderNormal,
+                                             -glm::dot(borderNormal, vertices[a].position),
+                                             BORDER_WEIGHT * edgeLength * edgeLength);
+      // Borders add to the error, not to the surface it is averaged over
+      border.weight = 0.0;
+      quadrics[a] += border;
+      quadrics[b] += border;
+    }
+  }
+  return quadrics;
+}
+
+// Whether moving a vertex onto another flips any of the triangles around it which remain, or
+// turns them about as far
+bool flipsTriangle(const Vertex *vertices, const std::vector<uint32_t> &indices,
+                   const Adjacency &adjacency, uint32_t from, uint32_t to) {
+  const auto &source = vertices[from].position;
+  const auto &target = vertices[to].position;
+  return std::any_of(adjacency.begin(from), adjacency.end(from), [&](uint32_t triangle) {
+    const auto *t = &indices[triangle * 3];
+    if (hasVertex(t, to)) {
+      return false;
+    }
+    auto        k      = t[0] == from ? 0 : (t[1] == from ? 1 : 2);
+    const auto &p1     = vertices[t[(k + 1) % 3]].position;
+    const auto &p2     = vertices[t[(k + 2) % 3]].position;
+    auto        before = glm::cross(p1 - source, p2 - source);
+    auto        after  = glm::cross(p1 - target, p2 - target);
+    return glm::dot(before, after) <= FLIP_THRESHOLD * glm::length(before) * glm::length(after);
+  });
+}
+
+} // namespace
+
+std::vector<uint32_t> MeshSimplifier::simplify(const Vertex *vertices, size_t vertexCount,
+                                               const uint32_t *indices, size_t indexCount,
+                                               size_t targetIndexCount, float *error) {
+  std::vector<uint32_t> result(indices, indices + indexCount - indexCount % 3);
+  Adjacency             adjacency;
+  adjacency.build(result, vertexCount);
+  auto kinds    = classifyVertices(vertices, vertexCount, result, adjacency);
+  auto quadrics = computeQuadrics(vertices, vertexCount, result, adjacency);
+
+  // Each pass collapses the cheapest edges first, a vertex at most once and none around a vertex
+  // collapsed, so that the triangles checked for flips are the ones the collapses end up with
+  std::vector<Collapse> collapses;
+  std::vector<uint32_t> remap(vertexCount);
+  std::vector<bool>     touched(vertexCount);
+  double                maxError = 0.0;
+  while (result.size() > targetIndexCount) {
+    adjacency.build(result, vertexCount);
+
+    collapses.clear();
+    for (size_t i = 0; i < result.size(); i += 3) {
+      for (size_t j = 0; j < 3; ++j) {
+        // Edges between manifold vertices are shared by two triangles, and taken from one
+        auto a = result[i + j], b = result[i + (j + 1) % 3];
+        if (a > b && kinds[a] == VertexKind::MANIFOLD && kinds[b] == VertexKind::MANIFOLD) {
+          continue;
+        }
+        for (auto [from, to] : {std::pair{a, b}, std::pair{b, a}}) {
+          if (kinds[from] == VertexKind::LOCKED ||
+              (kinds[from] == VertexKind::BORDER && !isBorderEdge(result, adjacency, from, to) &&
+               !isBorderEdge(result, adjacency, to, from))) {
+            continue;
+          }
+          auto quadric = quadrics[from];
+          quadric += quadrics[to];
+          collapses.push_back({from, to, static_cast<float>(quadric.error(vertices[to].position))});
+        }
+      }
+    }
+    std::sort(collapses.begin(), collapses.end(),
+              [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+    std::iota(remap.begin(), remap.end(), 0);
+    std::fill(touched.begin(), touched.end(), false);
+    auto   triangleCount       = result.size() / 3;
+    auto   targetTriangleCount = targetIndexCount / 3;
+    size_t removedCount        = 0;
+    for (const auto &collapse : collapses) {
+      if (triangleCount - removedCount <= targetTriangleCount) {
+        break;
+      }
+      if (touched[collapse.from] || touched[collapse.to] ||
+          flipsTriangle(vertices, result, adjacency, collapse.from, collapse.to)) {
+        continue;
+      }
+
+      remap[collapse.from] = collapse.to;
+      quadrics[collapse.to] += quadrics[collapse.from];
+      maxError = std::max(maxError, static_cast<double>(collapse.cost));
+      for (const auto *triangle = adjacency.begin(collapse.from);
+           triangle != adjacency.end(collapse.from); ++triangle) {
+        const auto *t = &result[*triangle * 3];
+        touched[t[0]] = touched[t[1]] = touched[t[2]] = true;
+        removedCount += hasVertex(t, collapse.to);
+      }
+    }
+    if (removedCount == 0) {
+      break;
+    }
+
+    // Drops the triangles collapsed into edges
+    size_t outputSize = 0;
+    for (size_t i = 0; i < result.size(); i += 3) {
+      auto a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+      if (a != b && b != c && c != a) {
+        result[outputSize++] = a;
+        result[outputSize++] = b;
+        result[outputSize++] = c;
+      }
+    }
+    result.resize(outputSize);
+  }
+
+  if (error) {
+    *error = static_cast<float>(std::sqrt(maxError));
+  }
+  return result;
+}
+
+std::vector<Lod> MeshSimplifier::generateLods(const std::vector<Vertex> &vertices,
+                                              std::vector<uint32_t>     &indices,
+                                              std::vector<IndexRange>   &ranges) {
+  PROFILE_FUNCTION();
+  auto             rangeCount = static_cast<uint32_t>(ranges.size());
+  std::vector<Lod> lods{{0, rangeCount, 0.0f}};
+  size_t           triangleCount = 0;
+  for (const auto &range : ranges) {
+    triangleCount += range.indexCount / 3;
+  }
+
+  std::vector<std::vector<uint32_t>> lodIndices(rangeCount);
+  std::vector<float>                 errors(rangeCount);
+  while (lods.size() < MAX_LOD_COUNT && triangleCount >= LOD_MIN_TRIANGLE_COUNT) {
+    // Each level is simplified from the previous one, which is cheaper than from the full one and
+    // nests the levels, their errors adding up
+    const auto previous = lods.back();
+    parallel::forEach(rangeCount, [&](size_t i) {
+      const auto &range  = ranges[previous.firstRange + i];
+      auto        target = static_cast<size_t>(range.indexCount / 3 * LOD_REDUCTION) * 3;
+      lodIndices[i] = simplify(vertices.data() + range.vertexOffset, range.vertexCount,
+                               indices.data() + range.firstIndex, range.indexCount, target,
+                               &errors[i]);
+      MeshOptimizer::optimizeVertexCache(lodIndices[i].data(), lodIndices[i].size());
+    });
+
+    size_t lodTriangleCount = 0;
+    for (const auto &rangeIndices : lodIndices) {
+      lodTriangleCount += rangeIndices.size() / 3;
+    }
+    if (lodTriangleCount > triangleCount * LOD_STOP_RATIO) {
+      break;
+    }
+
+    lods.push_back({static_cast<uint32_t>(ranges.size()), rangeCount,
+                    previous.error + *std::max_element(errors.begin(), errors.end())});
+    for (uint32_t i = 0; i < rangeCount; ++i) {
+      auto range       = ranges[previous.firstRange + i];
+      range.firstIndex = static_cast<uint32_t>(indices.size());
+      range.indexCount = static_cast<uint32_t>(lodIndices[i].size());
+      ranges.push_back(range);
+      indices.insert(indices.end(), lodIndices[i].begin(), lodIndices[i].end());
+    }
+    triangleCount = lodTriangleCount;
+  }
+  return lods;
+}
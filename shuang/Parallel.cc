@@ -0,0 +1,36 @@
+#include "Parallel.h"
+#include "JobSystem.h"
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+
+namespace parallel {
+
+void forEach(size_t count, const std::function<void(size_t)> &fn) {
+  std::atomic<bool>  failed{false};
+  std::exception_ptr exception;
+  std::mutex         exceptionMutex;
+
+  // One job per index
+  JobSystem::getInstance().parallelFor(count, 1, [&](size_t begin, size_t end) {
+    for (auto i = begin; i < end && !failed.load(std::memory_order_relaxed); ++i) {
+      try {
+        fn(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock{exceptionMutex};
+        if (!exception) {
+          exception = std::current_exception();
+        }
+        // Skip the remaining items
+        failed.store(true, std::memory_order_relaxed);
+      }
+    }
+  });
+
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+}
+
+} // namespace parallel
@@ -1,35 +1,42 @@
 #include "Pipeline.h"
 #include "Device.h"
-#include "FileSystem.h"
 #include "Log.h"
 #include "Macros.h"
 #include "RenderPass.h"
-#include "Vertex.h"
+#include "VertexLayout.h"
 
 Pipeline::Pipeline(const std::shared_ptr<Device>            &device,
                    const std::shared_ptr<RenderPass>        &renderPass,
                    const std::vector<VkDescriptorSetLayout> &descriptorSetLayouts)
     : mDevice{device} {
+  // The vertex shader takes the model matrix of the draw, and the fragment shader the fade of a
+  // level of detail
+  std::array<VkPushConstantRange, 2> pushConstantRanges{};
+  pushConstantRanges[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+  pushConstantRanges[0].size       = sizeof(DrawPushConstants);
+  pushConstantRanges[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+  pushConstantRanges[1].offset     = sizeof(DrawPushConstants);
+  pushConstantRanges[1].size       = sizeof(float);
+
   // Create a pipeline layout.
   VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{
       VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
-  pipelineLayoutCreateInfo.pSetLayouts    = descriptorSetLayouts.data();
-  pipelineLayoutCreateInfo.setLayoutCount = descriptorSetLayouts.size();
+  pipelineLayoutCreateInfo.pSetLayouts            = descriptorSetLayouts.data();
+  pipelineLayoutCreateInfo.setLayoutCount         = descriptorSetLayouts.size();
+  pipelineLayoutCreateInfo.pushConstantRangeCount = pushConstantRanges.size();
+  pipelineLayoutCreateInfo.pPushConstantRanges    = pushConstantRanges.data();
   vkOK(
       vkCreatePipelineLayout(mDevice->getHandle(), &pipelineLayoutCreateInfo, nullptr, &mLayout));
 
-  // Vertex binding and attributes
+  // Vertex binding and attributes, of float vertices
+  const auto &vertexLayout = VertexLayout::get(VertexFormat::FLOAT);
   // Binding descriptions
   std::vector<VkVertexInputBindingDescription> vertexInputBindings = {
-      createVertexInputBindingDescription(0, sizeof(Vertex), VK_VERTEX_INPUT_RATE_VERTEX),
+      vertexLayout.getBindingDescription(0),
   };
   // Attribute descriptions
-  std::vector<VkVertexInputAttributeDescription> vertexInputAttributes = {
-      createVertexInputAttributeDescription(0, 0, VK_FORMAT_R32G32B32_SFLOAT,
-                                            offsetof(Vertex, position)),
-      createVertexInputAttributeDescription(0, 1, VK_FORMAT_R32G32B32_SFLOAT,
-                                            offsetof(Vertex, color)),
-  };
+  std::vector<VkVertexInputAttributeDescription> vertexInputAttributes;
+  vertexLayout.appendAttributeDescriptions(0, vertexInputAttributes);
 
   VkPipelineVertexInputStateCreateInfo vertexInputState{
       VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
@@ -101,13 +108,13 @@ Pipeline::Pipeline(const std::shared_ptr<Device>            &device,
   // Vertex stage of the pipeline
   shaderStages[0].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
   shaderStages[0].stage  = VK_SHADER_STAGE_VERTEX_BIT;
-  shaderStages[0].module = createShaderModule("shaders/triangle.vert.spv");
+  shaderStages[0].module = device->getShaderLibrary().load("shaders/triangle.vert.spv");
   shaderStages[0].pName  = "main";
 
   // Fragment stage of the pipeline
   shaderStages[1].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
   shaderStages[1].stage  = VK_SHADER_STAGE_FRAGMENT_BIT;
-  shaderStages[1].module = createShaderModule("shaders/triangle.frag.spv");
+  shaderStages[1].module = device->getShaderLibrary().load("shaders/triangle.frag.spv");
   shaderStages[1].pName  = "main";
 
   VkGraphicsPipelineCreateInfo pipelineCreateInfo{VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
@@ -126,12 +133,7 @@ Pipeline::Pipeline(const std::shared_ptr<Device>            &device,
   pipelineCreateInfo.renderPass = renderPass->getHandle();
   pipelineCreateInfo.layout     = mLayout;
 
-  vkOK(vkCreateGraphicsPipelines(device->getHandle(), VK_NULL_HANDLE, 1, &pipelineCreateInfo,
-                                     nullptr, &mHandle));
-
-  // Pipeline is baked, we can delete the shader modules now.
-  vkDestroyShaderModule(device->getHandle(), shaderStages[0].module, nullptr);
-  vkDestroyShaderModule(device->getHandle(), shaderStages[1].module, nullptr);
+  mHandle = device->getPipelineCache().createGraphicsPipeline(pipelineCreateInfo, "pipeline");
 }
 
 Pipeline::~Pipeline() {
@@ -140,19 +142,6 @@ Pipeline::~Pipeline() {
   vkDestroyPipelineLayout(mDevice->getHandle(), mLayout, nullptr);
 }
 
-VkShaderModule Pipeline::createShaderModule(const char *path) {
-  auto source = filesystem::read(path);
-
-  VkShaderModuleCreateInfo shaderModuleCreateInfo{VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
-  shaderModuleCreateInfo.codeSize = source.size();
-  shaderModuleCreateInfo.pCode    = reinterpret_cast<const uint32_t *>(source.data());
-
-  VkShaderModule shaderModule;
-  vkOK(
-      vkCreateShaderModule(mDevice->getHandle(), &shaderModuleCreateInfo, nullptr, &shaderModule));
-  return shaderModule;
-}
-
 VkVertexInputBindingDescription
 Pipeline::createVertexInputBindingDescription(uint32_t binding, uint32_t stride,
                                               VkVertexInputRate inputRate) {
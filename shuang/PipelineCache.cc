@@ -0,0 +1,134 @@
+#include "PipelineCache.h"
+#include "Device.h"
+#include "FileSystem.h"
+#include "Log.h"
+#include "Macros.h"
+#include "Profiler.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+// Size of VkPipelineCacheHeaderVersionOne, without any padding the compiler may add
+#define PIPELINE_CACHE_HEADER_SIZE (4 * sizeof(uint32_t) + VK_UUID_SIZE)
+
+PipelineCache::PipelineCache(const Device &device, std::string path)
+    : mDevice{device}, mPath{std::move(path)} {
+  std::vector<uint8_t> data;
+  if (std::filesystem::exists(mPath)) {
+    data = filesystem::read(mPath);
+    // Caches of another device or driver version are at best ignored by the driver, at worst
+    // crash it
+    if (!isCompatible(data)) {
+      log_warn("Discard incompatible pipeline cache: {}", mPath);
+      data.clear();
+    }
+  }
+
+  VkPipelineCacheCreateInfo createInfo{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+  createInfo.initialDataSize = data.size();
+  createInfo.pInitialData    = data.data();
+  vkOK(vkCreatePipelineCache(device.getHandle(), &createInfo, nullptr, &mHandle));
+
+  log_info("Load pipeline cache: {} bytes", data.size());
+}
+
+PipelineCache::~PipelineCache() {
+  log_func;
+
+  double totalMilliseconds = 0.0;
+  for (const auto &record : mRecords) {
+    totalMilliseconds += record.milliseconds;
+  }
+  log_info("Created {} pipelines in {:.2f} ms", mRecords.size(), totalMilliseconds);
+
+  try {
+    save();
+  } catch (const std::exception &e) {
+    log_error("Failed to save pipeline cache: {}", e.what());
+  }
+  vkDestroyPipelineCache(mDevice.getHandle(), mHandle, nullptr);
+}
+
+VkPipeline PipelineCache::createGraphicsPipeline(const VkGraphicsPipelineCreateInfo &createInfo,
+                                                 const char                         *name) {
+  PROFILE_FUNCTION();
+  auto startTime = std::chrono::steady_clock::now();
+
+  VkPipeline pipeline;
+  vkOK(vkCreateGraphicsPipelines(mDevice.getHandle(), mHandle, 1, &createInfo, nullptr,
+                                 &pipeline));
+
+  record(name, startTime);
+  return pipeline;
+}
+
+VkPipeline PipelineCache::createComputePipeline(const VkComputePipelineCreateInfo &createInfo,
+                                                const char                        *name) {
+  PROFILE_FUNCTION();
+  auto startTime = std::chrono::steady_clock::now();
+
+  VkPipeline pipeline;
+  vkOK(vkCreateComputePipelines(mDevice.getHandle(), mHandle, 1, &createInfo, nullptr,
+                                &pipeline));
+
+  record(name, startTime);
+  return pipeline;
+}
+
+void PipelineCache::save() {
+  size_t size;
+  vkOK(vkGetPipelineCacheData(mDevice.getHandle(), mHandle, &size, nullptr));
+  std::vector<uint8_t> data(size);
+  vkOK(vkGetPipelineCacheData(mDevice.getHandle(), mHandle, &size, data.data()));
+
+  auto          tmpPath = mPath + ".tmp";
+  std::ofstream file(tmpPath, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open file: " + tmpPath);
+  }
+  file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(size));
+  file.close();
+  if (file.fail()) {
+    throw std::runtime_error("Failed to write file: " + tmpPath);
+  }
+
+  // Replaces the previous cache at once
+  std::filesystem::rename(tmpPath, mPath);
+
+  log_info("Save pipeline cache: {} bytes", size);
+}
+
+std::vector<PipelineCache::Record> PipelineCache::getRecords() {
+  std::lock_guard<std::mutex> lock{mMutex};
+  return mRecords;
+}
+
+bool PipelineCache::isCompatible(const std::vector<uint8_t> &data) const {
+  if (data.size() < PIPELINE_CACHE_HEADER_SIZE) {
+    return false;
+  }
+
+  uint32_t header[4];
+  uint8_t  uuid[VK_UUID_SIZE];
+  memcpy(header, data.data(), sizeof(header));
+  memcpy(uuid, data.data() + sizeof(header), sizeof(uuid));
+  auto [headerSize, headerVersion, vendorID, deviceID] = header;
+
+  const auto &properties = mDevice.getPhysicalDevice()->getProperties();
+  return headerSize >= PIPELINE_CACHE_HEADER_SIZE && headerSize <= data.size() &&
+         headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         vendorID == properties.vendorID && deviceID == properties.deviceID &&
+         memcmp(uuid, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void PipelineCache::record(const char *name, std::chrono::steady_clock::time_point startTime) {
+  auto milliseconds = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - startTime)
+                          .count();
+  log_debug("Create pipeline {}: {:.2f} ms", name, milliseconds);
+
+  std::lock_guard<std::mutex> lock{mMutex};
+  mRecords.push_back({name, milliseconds});
+}
@@ -0,0 +1,130 @@
+#include "Profiler.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+// Number of events each thread records at most, the following ones are dropped
+#define PROFILER_EVENTS_PER_THREAD (1 << 16)
+
+namespace {
+
+// The names are string literals or function names, escaped in case
+void writeString(std::ofstream &file, const char *string) {
+  file << '"';
+  for (auto *c = string; *c; ++c) {
+    if (*c == '"' || *c == '\\') {
+      file << '\\';
+    }
+    file << *c;
+  }
+  file << '"';
+}
+
+} // namespace
+
+Profiler &Profiler::getInstance() {
+  static auto *instance = new Profiler();
+  return *instance;
+}
+
+void Profiler::record(const char *name, int64_t begin, int64_t end) { push({name, begin, end}); }
+
+void Profiler::markFrame(uint64_t frameNumber) {
+  push({nullptr, now(), static_cast<int64_t>(frameNumber)});
+}
+
+void Profiler::setThreadName(std::string name) {
+  auto &buffer = getThreadBuffer();
+
+  std::lock_guard<std::mutex> lock{mMutex};
+  buffer.name = std::move(name);
+}
+
+void Profiler::writeChromeTrace(const std::string &path) {
+  std::ofstream file(path, std::ios::out | std::ios::trunc);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open file: " + path);
+  }
+
+  // The registered buffers stay, their events up to the count are written for good
+  std::lock_guard<std::mutex> lock{mMutex};
+  std::vector<uint32_t>       counts;
+  auto                        origin = INT64_MAX;
+  for (const auto &buffer : mThreadBuffers) {
+    counts.push_back(buffer->count.load(std::memory_order_acquire));
+    for (uint32_t i = 0; i < counts.back(); ++i) {
+      origin = std::min(origin, buffer->events[i].begin);
+    }
+  }
+
+  // Timestamps are microseconds since the first event, to the nanosecond
+  file << std::fixed << std::setprecision(3);
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  auto separator = "\n";
+  for (size_t i = 0; i < mThreadBuffers.size(); ++i) {
+    const auto &buffer = mThreadBuffers[i];
+    file << separator << R"({"ph":"M","pid":0,"tid":)" << buffer->threadId
+         << R"(,"name":"thread_name","args":{"name":)";
+    writeString(file, buffer->name.c_str());
+    file << "}}";
+    separator = ",\n";
+
+    for (uint32_t j = 0; j < counts[i]; ++j) {
+      const auto &event = buffer->events[j];
+      auto        begin = static_cast<double>(event.begin - origin) * 1e-3;
+      if (event.name) {
+        file << separator << R"({"ph":"X","pid":0,"tid":)" << buffer->threadId << ",\"ts\":"
+             << begin << ",\"dur\":" << static_cast<double>(event.value - event.begin) * 1e-3
+             << ",\"name\":";
+        writeString(file, event.name);
+      } else {
+        file << separator << R"({"ph":"i","s":"g","pid":0,"tid":)" << buffer->threadId
+             << ",\"ts\":" << begin << ",\"name\":\"frame " << event.value << '"';
+      }
+      file << '}';
+    }
+
+    if (auto dropped = buffer->droppedCount.load(std::memory_order_relaxed); dropped > 0) {
+      log_warn("Profiler: {} events of thread {} dropped", dropped, buffer->name);
+    }
+  }
+  file << "\n]}\n";
+  file.close();
+  if (file.fail()) {
+    throw std::runtime_error("Failed to write file: " + path);
+  }
+
+  log_info("Write Chrome trace: {}", path);
+}
+
+void Profiler::push(const Event &event) {
+  auto &buffer = getThreadBuffer();
+  auto  index  = buffer.count.load(std::memory_order_relaxed);
+  if (index >= PROFILER_EVENTS_PER_THREAD) {
+    buffer.droppedCount.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  buffer.events[index] = event;
+  // Publishes the event to the writer of the trace
+  buffer.count.store(index + 1, std::memory_order_release);
+}
+
+Profiler::ThreadBuffer &Profiler::getThreadBuffer() {
+  thread_local ThreadBuffer *threadBuffer = nullptr;
+  if (threadBuffer) {
+    return *threadBuffer;
+  }
+
+  auto buffer    = std::make_unique<ThreadBuffer>();
+  buffer->events = std::make_unique<Event[]>(PROFILER_EVENTS_PER_THREAD);
+
+  std::lock_guard<std::mutex> lock{mMutex};
+  buffer->threadId = static_cast<uint32_t>(mThreadBuffers.size());
+  buffer->name     = "thread " + std::to_string(buffer->threadId);
+  threadBuffer     = buffer.get();
+  mThreadBuffers.push_back(std::move(buffer));
+  return *mThreadBuffers.back();
+}
@@ -1 +1,43 @@
 #include "Queue.h"
+#include "Device.h"
+
+Queue::Queue(const Device &device, uint32_t familyIndex, uint32_t index,
+             const VkQueueFamilyProperties &properties, bool supportPresent)
+    : mFamilyIndex{familyIndex}, mProperties{properties}, mSupportPresent{supportPresent} {
+  vkGetDeviceQueue(device.getHandle(), familyIndex, index, &mHandle);
+}
+
+VkResult Queue::submit(const std::vector<VkCommandBuffer> &commandBuffers,
+                       const std::vector<Wait>            &waits,
+                       const std::vector<VkSemaphore>     &signalSemaphores, VkFence fence) const {
+  std::vector<VkSemaphore>          waitSemaphores;
+  std::vector<VkPipelineStageFlags> waitStageMasks;
+  waitSemaphores.reserve(waits.size());
+  waitStageMasks.reserve(waits.size());
+  for (const auto &wait : waits) {
+    waitSemaphores.push_back(wait.semaphore);
+    waitStageMasks.push_back(wait.stageMask);
+  }
+
+  VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+  submitInfo.waitSemaphoreCount   = static_cast<uint32_t>(waitSemaphores.size());
+  submitInfo.pWaitSemaphores      = waitSemaphores.data();
+  submitInfo.pWaitDstStageMask    = waitStageMasks.data();
+  submitInfo.commandBufferCount   = static_cast<uint32_t>(commandBuffers.size());
+  submitInfo.pCommandBuffers      = commandBuffers.data();
+  submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+  submitInfo.pSignalSemaphores    = signalSemaphores.data();
+
+  std::lock_guard<std::mutex> lock{mMutex};
+  return vkQueueSubmit(mHandle, 1, &submitInfo, fence);
+}
+
+VkResult Queue::present(const VkPresentInfoKHR &presentInfo) const {
+  std::lock_guard<std::mutex> lock{mMutex};
+  return vkQueuePresentKHR(mHandle, &presentInfo);
+}
+
+VkResult Queue::waitIdle() const {
+  std::lock_guard<std::mutex> lock{mMutex};
+  return vkQueueWaitIdle(mHandle);
+}
@@ -4,7 +4,7 @@
 #include "Macros.h"
 
 RenderPass::RenderPass(const std::shared_ptr<Device> &device, VkFormat imageFormat,
-                       VkFormat depthFormat)
+                       VkFormat depthFormat, VkImageLayout finalLayout)
     : mDevice{device} {
   std::array<VkAttachmentDescription, 2> attachments{};
   // Color attachment
@@ -19,8 +19,9 @@ RenderPass::RenderPass(const std::shared_ptr<Device> &device, VkFormat imageForm
   attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   // The image layout will be undefined when the render pass begins.
   attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  // After the render pass is complete, we will transition to PRESENT_SRC_KHR layout.
-  attachments[0].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  // After the render pass is complete, we will transition to PRESENT_SRC_KHR layout, or to
+  // TRANSFER_SRC_OPTIMAL when rendering offscreen.
+  attachments[0].finalLayout = finalLayout;
 
   // Depth attachment
   attachments[1].format         = depthFormat;
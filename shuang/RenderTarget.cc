@@ -1 +1,46 @@
 #include "RenderTarget.h"
+#include "Device.h"
+#include "Log.h"
+#include "Macros.h"
+#include "RenderPass.h"
+
+RenderTarget::RenderTarget(const std::shared_ptr<Device> &device, const VkExtent2D &extent,
+                           VkFormat colorFormat, VkFormat depthFormat)
+    : mDevice{device}, mExtent{extent} {
+  // Keep the color image readable so the rendered frame can be copied out
+  mColorImage     = std::make_unique<Image>(device, colorFormat, extent,
+                                        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                            VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+  mColorImageView = std::make_unique<ImageView>(device, *mColorImage, VK_IMAGE_ASPECT_COLOR_BIT);
+
+  VkImageAspectFlags depthAspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+  // Stencil aspect should only be set on depth + stencil formats
+  if (depthFormat >= VK_FORMAT_D16_UNORM_S8_UINT) {
+    depthAspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+  }
+  mDepthImage     = std::make_unique<Image>(device, depthFormat, extent,
+                                        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+  mDepthImageView = std::make_unique<ImageView>(device, *mDepthImage, depthAspectMask);
+}
+
+RenderTarget::~RenderTarget() {
+  log_func;
+  vkDestroyFramebuffer(mDevice->getHandle(), mFramebuffer, nullptr);
+}
+
+void RenderTarget::createFramebuffer(const std::shared_ptr<RenderPass> &renderPass) {
+  std::array<VkImageView, 2> attachments{
+      mColorImageView->getHandle(),
+      mDepthImageView->getHandle(),
+  };
+
+  VkFramebufferCreateInfo framebufferCreateInfo{VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
+  framebufferCreateInfo.renderPass      = renderPass->getHandle();
+  framebufferCreateInfo.attachmentCount = attachments.size();
+  framebufferCreateInfo.pAttachments    = attachments.data();
+  framebufferCreateInfo.width           = mExtent.width;
+  framebufferCreateInfo.height          = mExtent.height;
+  framebufferCreateInfo.layers          = 1;
+
+  vkOK(vkCreateFramebuffer(mDevice->getHandle(), &framebufferCreateInfo, nullptr, &mFramebuffer));
+}
@@ -1 +1,268 @@
 #include "Scene.h"
+#include "Frustum.h"
+#include "InstanceBuffer.h"
+#include "Log.h"
+#include "Parallel.h"
+#include "model/Model.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Number of nodes updated at once by a thread, smaller levels are updated by the calling thread
+#define SCENE_UPDATE_CHUNK_SIZE 4096
+
+Scene::NodeId Scene::addNode(NodeId parent, const glm::mat4 &localTransform, const Model *model,
+                             const InstanceBuffer *instances) {
+  if (parent != INVALID_NODE && parent >= mIndices.size()) {
+    throw std::runtime_error(fmt::format("Invalid parent node {}", parent));
+  }
+
+  // Appended out of order until the next update sorts the nodes
+  auto id    = static_cast<NodeId>(mIndices.size());
+  auto index = static_cast<uint32_t>(mIds.size());
+  mLocalTransforms.push_back(localTransform);
+  mWorldTransforms.push_back(localTransform);
+  mParents.push_back(parent == INVALID_NODE ? UINT32_MAX : mIndices[parent]);
+  mModels.push_back(model);
+  mInstances.push_back(instances);
+  mIds.push_back(id);
+  mDirty.push_back(false);
+  mVisible.push_back(model != nullptr);
+  mBoundingSphereX.push_back(0.0f);
+  mBoundingSphereY.push_back(0.0f);
+  mBoundingSphereZ.push_back(0.0f);
+  mBoundingSphereRadii.push_back(-INFINITY);
+  mLodStates.emplace_back();
+  mIndices.push_back(index);
+  mModelCount += model != nullptr;
+  mUnsorted = true;
+  return id;
+}
+
+void Scene::setLocalTransform(NodeId node, const glm::mat4 &localTransform) {
+  auto index              = mIndices.at(node);
+  mLocalTransforms[index] = localTransform;
+  markDirty(index);
+}
+
+const glm::mat4 &Scene::getLocalTransform(NodeId node) const {
+  return mLocalTransforms[mIndices.at(node)];
+}
+
+const glm::mat4 &Scene::getWorldTransform(NodeId node) const {
+  return mWorldTransforms[mIndices.at(node)];
+}
+
+void Scene::update() {
+  if (mUnsorted) {
+    sort();
+  }
+  if (mDirtyIndices.empty()) {
+    return;
+  }
+
+  // Walk the levels down from the shallowest dirty node. The nodes to update at a level are the
+  // children of the nodes updated at the previous one, which are consecutive for consecutive
+  // nodes, along with the dirty nodes of the level.
+  std::sort(mDirtyIndices.begin(), mDirtyIndices.end());
+  std::vector<Range> ranges, childRanges;
+  size_t             nextDirty = 0;
+  while (!ranges.empty() || nextDirty < mDirtyIndices.size()) {
+    auto firstIndex = ranges.empty() ? mDirtyIndices[nextDirty] : ranges[0].begin;
+    auto level      = std::upper_bound(mLevelBegins.begin(), mLevelBegins.end(), firstIndex);
+    for (; nextDirty < mDirtyIndices.size() && mDirtyIndices[nextDirty] < *level; ++nextDirty) {
+      auto index = mDirtyIndices[nextDirty];
+      ranges.push_back({index, index + 1});
+      mDirty[index] = false;
+    }
+
+    // Merge the overlapping and adjacent ranges
+    std::sort(ranges.begin(), ranges.end(),
+              [](const Range &a, const Range &b) { return a.begin < b.begin; });
+    size_t count = 0;
+    for (const auto &range : ranges) {
+      if (count > 0 && range.begin <= ranges[count - 1].end) {
+        ranges[count - 1].end = std::max(ranges[count - 1].end, range.end);
+      } else {
+        ranges[count++] = range;
+      }
+    }
+    ranges.resize(count);
+
+    updateLevel(ranges);
+
+    childRanges.clear();
+    for (const auto &range : ranges) {
+      if (mChildBegins[range.begin] < mChildBegins[range.end]) {
+        childRanges.push_back({mChildBegins[range.begin], mChildBegins[range.end]});
+      }
+    }
+    std::swap(ranges, childRanges);
+  }
+  mDirtyIndices.clear();
+}
+
+Scene::CullStatistics Scene::cull(const Frustum &frustum) {
+  auto visibleCount = frustum.cullSpheres(mBoundingSphereX.data(), mBoundingSphereY.data(),
+                                          mBoundingSphereZ.data(), mBoundingSphereRadii.data(),
+                                          mVisible.size(), mVisible.data());
+  return {visibleCount, mModelCount};
+}
+
+void Scene::updateLods(const LodSelector &selector, float timeStep) {
+  auto chunkCount = (mModels.size() + SCENE_UPDATE_CHUNK_SIZE - 1) / SCENE_UPDATE_CHUNK_SIZE;
+  parallel::forEach(chunkCount, [&](size_t chunk) {
+    auto begin = chunk * SCENE_UPDATE_CHUNK_SIZE;
+    auto end   = std::min<size_t>(begin + SCENE_UPDATE_CHUNK_SIZE, mModels.size());
+    for (auto index = begin; index < end; ++index) {
+      if (mModels[index] == nullptr) {
+        continue;
+      }
+      const auto &transform = mWorldTransforms[index];
+      auto        scale     = std::max({glm::length(glm::vec3(transform[0])),
+                                        glm::length(glm::vec3(transform[1])),
+                                        glm::length(glm::vec3(transform[2]))});
+      glm::vec3   center{mBoundingSphereX[index], mBoundingSphereY[index], mBoundingSphereZ[index]};
+      selector.update(mLodStates[index], *mModels[index], center, mBoundingSphereRadii[index],
+                      scale, timeStep);
+    }
+  });
+}
+
+void Scene::updateLevel(const std::vector<Range> &ranges) {
+  // Split the ranges into chunks, which are independent since their parents are up to date
+  std::vector<Range> chunks;
+  for (const auto &range : ranges) {
+    for (auto begin = range.begin; begin < range.end; begin += SCENE_UPDATE_CHUNK_SIZE) {
+      chunks.push_back({begin, std::min<uint32_t>(begin + SCENE_UPDATE_CHUNK_SIZE, range.end)});
+    }
+  }
+
+  auto updateChunk = [&](size_t i) {
+    for (auto index = chunks[i].begin; index < chunks[i].end; ++index) {
+      auto parent             = mParents[index];
+      mWorldTransforms[index] = parent == UINT32_MAX
+                                    ? mLocalTransforms[index]
+                                    : mWorldTransforms[parent] * mLocalTransforms[index];
+
+      auto model = mModels[index];
+      if (model == nullptr) {
+        continue;
+      }
+      const auto &transform = mWorldTransforms[index];
+
+      auto localCenter = model->getBoundingSphereCenter();
+      auto localRadius = model->getBoundingSphereRadius();
+      if (mInstances[index]) {
+        mInstances[index]->getBoundingSphere(*model, localCenter, localRadius);
+      }
+      auto center = glm::vec3(transform * glm::vec4(localCenter, 1.0f));
+      // Scaled by the largest scale of the axes, which keeps the sphere bounding under any
+      // non-uniform scale
+      auto scale = std::max({glm::length(glm::vec3(transform[0])),
+                             glm::length(glm::vec3(transform[1])),
+                             glm::length(glm::vec3(transform[2]))});
+
+      mBoundingSphereX[index]     = center.x;
+      mBoundingSphereY[index]     = center.y;
+      mBoundingSphereZ[index]     = center.z;
+      mBoundingSphereRadii[index] = localRadius * scale;
+    }
+  };
+  if (chunks.size() == 1) {
+    updateChunk(0);
+  } else {
+    parallel::forEach(chunks.size(), updateChunk);
+  }
+}
+
+void Scene::markDirty(uint32_t index) {
+  if (!mDirty[index]) {
+    mDirty[index] = true;
+    mDirtyIndices.push_back(index);
+  }
+}
+
+void Scene::sort() {
+  auto nodeCount = static_cast<uint32_t>(mIds.size());
+
+  // Children of every node, in the order they were added
+  std::vector<uint32_t> childCounts(nodeCount + 1), children(nodeCount);
+  for (auto parent : mParents) {
+    if (parent != UINT32_MAX) {
+      ++childCounts[parent + 1];
+    }
+  }
+  for (uint32_t i = 0; i < nodeCount; ++i) {
+    childCounts[i + 1] += childCounts[i];
+  }
+  auto childOffsets = childCounts;
+  for (uint32_t i = 0; i < nodeCount; ++i) {
+    if (mParents[i] != UINT32_MAX) {
+      children[childOffsets[mParents[i]]++] = i;
+    }
+  }
+
+  // Breadth first order, the roots first. The children of the node at index i are appended when
+  // reaching it, thus start at the current size of the order.
+  std::vector<uint32_t> order;
+  order.reserve(nodeCount);
+  for (uint32_t i = 0; i < nodeCount; ++i) {
+    if (mParents[i] == UINT32_MAX) {
+      order.push_back(i);
+    }
+  }
+  auto rootCount = static_cast<uint32_t>(order.size());
+  mChildBegins.resize(nodeCount + 1);
+  for (uint32_t i = 0; i < nodeCount; ++i) {
+    mChildBegins[i] = static_cast<uint32_t>(order.size());
+    auto node       = order[i];
+    order.insert(order.end(), children.begin() + childCounts[node],
+                 children.begin() + childCounts[node + 1]);
+  }
+  mChildBegins[nodeCount] = nodeCount;
+
+  // Each level is made of the children of the previous one
+  mLevelBegins = {0};
+  while (mLevelBegins.back() < nodeCount) {
+    mLevelBegins.push_back(mChildBegins[mLevelBegins.back()]);
+  }
+
+  // Move the nodes to their new index
+  std::vector<uint32_t> newIndices(nodeCount);
+  for (uint32_t i = 0; i < nodeCount; ++i) {
+    newIndices[order[i]] = i;
+  }
+  auto permute = [&](auto &values) {
+    auto oldValues = values;
+    for (uint32_t i = 0; i < nodeCount; ++i) {
+      values[i] = oldValues[order[i]];
+    }
+  };
+  permute(mLocalTransforms);
+  permute(mParents);
+  permute(mModels);
+  permute(mInstances);
+  permute(mIds);
+  permute(mVisible);
+  permute(mLodStates);
+  for (auto &parent : mParents) {
+    if (parent != UINT32_MAX) {
+      parent = newIndices[parent];
+    }
+  }
+  for (uint32_t i = 0; i < nodeCount; ++i) {
+    mIndices[mIds[i]] = i;
+  }
+
+  // Updating the roots updates every node and the bounding spheres of the models
+  mBoundingSphereRadii.assign(nodeCount, -INFINITY);
+  mDirty.assign(nodeCount, false);
+  mDirtyIndices.clear();
+  for (uint32_t i = 0; i < rootCount; ++i) {
+    markDirty(i);
+  }
+  mUnsorted = false;
+
+  log_debug("Sort scene: {} nodes, {} levels", nodeCount, mLevelBegins.size() - 1);
+}
@@ -0,0 +1,103 @@
+#include "ShaderLibrary.h"
+#include "Device.h"
+#include "FileSystem.h"
+#include "Log.h"
+#include "Macros.h"
+#include "Profiler.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+// FNV-1a over the words of the code, SPIR-V being a stream of 32-bit words
+uint64_t hash(const uint32_t *code, size_t size) {
+  uint64_t value = 14695981039346656037ull;
+  for (size_t i = 0; i < size / sizeof(uint32_t); ++i) {
+    value = (value ^ code[i]) * 1099511628211ull;
+  }
+  return value;
+}
+
+} // namespace
+
+ShaderLibrary::ShaderLibrary(const Device &device) : mDevice{device} {}
+
+ShaderLibrary::~ShaderLibrary() {
+  log_func;
+  log_info("Loaded {} shader files ({} bytes) into {} modules in {:.2f} ms",
+           mStatistics.fileCount, mStatistics.bytesRead, mStatistics.moduleCount,
+           mStatistics.milliseconds);
+
+  // Modules found by path are the same ones
+  for (auto &[key, module] : mModulesByHash) {
+    vkDestroyShaderModule(mDevice.getHandle(), module.handle, nullptr);
+  }
+}
+
+VkShaderModule ShaderLibrary::load(const std::string &path) {
+  PROFILE_FUNCTION();
+  std::lock_guard<std::mutex> lock{mMutex};
+
+  if (auto iter = mModulesByPath.find(path); iter != mModulesByPath.end()) {
+    return iter->second;
+  }
+
+  auto startTime = std::chrono::steady_clock::now();
+
+  // Mapped memory is page aligned, thus can be used as SPIR-V words in place
+  filesystem::MappedFile file(path);
+  if (file.size() == 0 || file.size() % sizeof(uint32_t) != 0) {
+    throw std::runtime_error(fmt::format("Invalid SPIR-V file: {}", path));
+  }
+
+  auto module = getModule(reinterpret_cast<const uint32_t *>(file.data()), file.size());
+  mModulesByPath.emplace(path, module);
+
+  ++mStatistics.fileCount;
+  mStatistics.bytesRead += file.size();
+  mStatistics.milliseconds += std::chrono::duration<double, std::milli>(
+                                  std::chrono::steady_clock::now() - startTime)
+                                  .count();
+  return module;
+}
+
+VkShaderModule ShaderLibrary::load(const uint32_t *code, size_t size) {
+  std::lock_guard<std::mutex> lock{mMutex};
+
+  auto startTime = std::chrono::steady_clock::now();
+  auto module    = getModule(code, size);
+  mStatistics.milliseconds += std::chrono::duration<double, std::milli>(
+                                  std::chrono::steady_clock::now() - startTime)
+                                  .count();
+  return module;
+}
+
+ShaderLibrary::Statistics ShaderLibrary::getStatistics() {
+  std::lock_guard<std::mutex> lock{mMutex};
+  return mStatistics;
+}
+
+VkShaderModule ShaderLibrary::getModule(const uint32_t *code, size_t size) {
+  // Reused only for the very same code, different code may share a hash
+  auto key          = hash(code, size);
+  auto [begin, end] = mModulesByHash.equal_range(key);
+  for (auto iter = begin; iter != end; ++iter) {
+    const auto &module = iter->second;
+    if (module.code.size() * sizeof(uint32_t) == size &&
+        std::memcmp(module.code.data(), code, size) == 0) {
+      return module.handle;
+    }
+  }
+
+  VkShaderModuleCreateInfo createInfo{VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+  createInfo.codeSize = size;
+  createInfo.pCode    = code;
+
+  Module module{{code, code + size / sizeof(uint32_t)}, VK_NULL_HANDLE};
+  vkOK(vkCreateShaderModule(mDevice.getHandle(), &createInfo, nullptr, &module.handle));
+  auto handle = module.handle;
+  mModulesByHash.emplace(key, std::move(module));
+  ++mStatistics.moduleCount;
+  return handle;
+}
@@ -1,5 +1,7 @@
 #include "Swapchain.h"
 #include "Device.h"
+#include "Image.h"
+#include "ImageView.h"
 #include "Log.h"
 #include "Macros.h"
 #include "RenderPass.h"
@@ -140,39 +142,14 @@ Swapchain::Swapchain(const std::shared_ptr<Device> &device, const std::shared_pt
     mImageViews.push_back(imageView);
   }
 
-  // Initialize per-frame resources.
-  // Every swapchain image has its own command pool and fence manager.
-  // This makes it very easy to keep track of when we can reset command buffers
-  // and such.
-  mFrames.clear();
-  mFrames.resize(mImageCount);
-
-  for (size_t i = 0; i < mImageCount; ++i) {
-    initFrame(mFrames[i]);
-  }
-
   mDepthFormat = mDevice->getPhysicalDevice()->getSuitableDepthFormat();
 }
 
 Swapchain::~Swapchain() {
   log_func;
 
-  for (auto &semaphore : mSemaphorePool) {
-    vkDestroySemaphore(mDevice->getHandle(), semaphore, nullptr);
-  }
-
-  for (auto &frame : mFrames) {
-    vkDestroySemaphore(mDevice->getHandle(), frame.releasedSemaphore, nullptr);
-    vkDestroySemaphore(mDevice->getHandle(), frame.acquiredSemaphore, nullptr);
-    vkFreeCommandBuffers(mDevice->getHandle(), frame.primaryCommandPool, 1,
-                         &frame.primaryCommandBuffer);
-    vkDestroyCommandPool(mDevice->getHandle(), frame.primaryCommandPool, nullptr);
-    vkDestroyFence(mDevice->getHandle(), frame.queueSubmittedFence, nullptr);
-  }
-
-  vkDestroyImageView(mDevice->getHandle(), mDepthStencil.view, nullptr);
-  vkDestroyImage(mDevice->getHandle(), mDepthStencil.image, nullptr);
-  vkFreeMemory(mDevice->getHandle(), mDepthStencil.memory, nullptr);
+  mDepthStencilImageView.reset();
+  mDepthStencilImage.reset();
 
   cleanupFramebuffers();
 
@@ -183,30 +160,10 @@ Swapchain::~Swapchain() {
   vkDestroySwapchainKHR(mDevice->getHandle(), mHandle, nullptr);
 }
 
-void Swapchain::initFrame(Frame &frame) {
-  VkFenceCreateInfo fenceCreateInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
-  fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-  vkOK(
-      vkCreateFence(mDevice->getHandle(), &fenceCreateInfo, nullptr, &frame.queueSubmittedFence));
-
-  VkCommandPoolCreateInfo commandPoolCreateInfo{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
-  commandPoolCreateInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
-  commandPoolCreateInfo.queueFamilyIndex = mDevice->getQueueFamilyIndices().graphics;
-  vkOK(vkCreateCommandPool(mDevice->getHandle(), &commandPoolCreateInfo, nullptr,
-                               &frame.primaryCommandPool));
-
-  VkCommandBufferAllocateInfo commandBufferAllocateInfo{
-      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
-  commandBufferAllocateInfo.commandPool        = frame.primaryCommandPool;
-  commandBufferAllocateInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  commandBufferAllocateInfo.commandBufferCount = 1;
-  vkOK(vkAllocateCommandBuffers(mDevice->getHandle(), &commandBufferAllocateInfo,
-                                    &frame.primaryCommandBuffer));
-}
-
 void Swapchain::createFramebuffers(const std::shared_ptr<RenderPass> &renderPass) {
   VkImageView attachments[2];
-  attachments[1] = mDepthStencil.view; // Depth/Stencil attachment is the same for all framebuffers
+  // Depth/Stencil attachment is the same for all framebuffers
+  attachments[1] = mDepthStencilImageView->getHandle();
 
   // Build the framebuffer.
   VkFramebufferCreateInfo framebufferCreateInfo{VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
@@ -228,50 +185,21 @@ void Swapchain::createFramebuffers(const std::shared_ptr<RenderPass> &renderPass
 }
 
 void Swapchain::createDepthStencil() {
-  VkImageCreateInfo imageCreateInfo{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
-  imageCreateInfo.imageType   = VK_IMAGE_TYPE_2D;
-  imageCreateInfo.format      = mDepthFormat;
-  imageCreateInfo.extent      = {mImageExtent.width, mImageExtent.height, 1};
-  imageCreateInfo.mipLevels   = 1;
-  imageCreateInfo.arrayLayers = 1;
-  imageCreateInfo.samples     = VK_SAMPLE_COUNT_1_BIT;
-  imageCreateInfo.tiling      = VK_IMAGE_TILING_OPTIMAL;
-  imageCreateInfo.usage =
-      VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
-
-  vkOK(vkCreateImage(mDevice->getHandle(), &imageCreateInfo, nullptr, &mDepthStencil.image));
-
-  VkMemoryRequirements memoryRequirements{};
-  vkGetImageMemoryRequirements(mDevice->getHandle(), mDepthStencil.image, &memoryRequirements);
-
-  VkMemoryAllocateInfo memoryAllocation{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
-  memoryAllocation.allocationSize  = memoryRequirements.size;
-  memoryAllocation.memoryTypeIndex = mDevice->getPhysicalDevice()->getMemoryType(
-      memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-  vkOK(
-      vkAllocateMemory(mDevice->getHandle(), &memoryAllocation, nullptr, &mDepthStencil.memory));
-  vkOK(vkBindImageMemory(mDevice->getHandle(), mDepthStencil.image, mDepthStencil.memory, 0));
-
-  VkImageViewCreateInfo imageViewCreateInfo{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
-  imageViewCreateInfo.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
-  imageViewCreateInfo.image                           = mDepthStencil.image;
-  imageViewCreateInfo.format                          = mDepthFormat;
-  imageViewCreateInfo.subresourceRange.baseMipLevel   = 0;
-  imageViewCreateInfo.subresourceRange.levelCount     = 1;
-  imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
-  imageViewCreateInfo.subresourceRange.layerCount     = 1;
-  imageViewCreateInfo.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_DEPTH_BIT;
+  mDepthStencilImage = std::make_unique<Image>(
+      mDevice, mDepthFormat, mImageExtent,
+      VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+
+  VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
   // Stencil aspect should only be set on depth + stencil formats: VK_FORMAT_D16_UNORM_S8_UINT,
   // VK_FORMAT_D32_SFLOAT_S8_UINT
   if (mDepthFormat >= VK_FORMAT_D16_UNORM_S8_UINT) {
-    imageViewCreateInfo.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+    aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
   }
-  vkOK(
-      vkCreateImageView(mDevice->getHandle(), &imageViewCreateInfo, nullptr, &mDepthStencil.view));
+  mDepthStencilImageView = std::make_unique<ImageView>(mDevice, *mDepthStencilImage, aspectMask);
 }
 
 void Swapchain::cleanupFramebuffers() {
-  vkQueueWaitIdle(mDevice->getGraphicsQueue());
+  mDevice->getGraphicsQueue().waitIdle();
 
   for (auto &framebuffer : mFramebuffers) {
     vkDestroyFramebuffer(mDevice->getHandle(), framebuffer, nullptr);
@@ -280,48 +208,9 @@ void Swapchain::cleanupFramebuffers() {
   mFramebuffers.clear();
 }
 
-VkResult Swapchain::acquireNextImage(uint32_t &imageIndex) {
-  VkSemaphore semaphore;
-  if (mSemaphorePool.empty()) {
-    VkSemaphoreCreateInfo semaphoreCreateInfo = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
-    vkOK(vkCreateSemaphore(mDevice->getHandle(), &semaphoreCreateInfo, nullptr, &semaphore));
-  } else {
-    semaphore = mSemaphorePool.back();
-    mSemaphorePool.pop_back();
-  }
-
-  auto result = vkAcquireNextImageKHR(mDevice->getHandle(), mHandle, UINT64_MAX, semaphore,
-                                      VK_NULL_HANDLE, &imageIndex);
-  if (result != VK_SUCCESS) {
-    mSemaphorePool.push_back(semaphore);
-    return result;
-  }
-
-  auto &frame = mFrames[imageIndex];
-
-  // If we have outstanding fence for this swapchain imageIndex, wait for it
-  // to complete first. After begin frame returns, it is safe to reuse or delete
-  // resources which were used previously.
-  //
-  // We wait for fence which completes N frames earlier, so we do not stall,
-  // waiting for all GPU work to complete before this returns.
-  // Normally, this doesn't really block at all, since we're waiting for old
-  // frames to have been completed, but just in case.
-  if (frame.queueSubmittedFence != VK_NULL_HANDLE) {
-    vkWaitForFences(mDevice->getHandle(), 1, &frame.queueSubmittedFence, true, UINT64_MAX);
-    vkResetFences(mDevice->getHandle(), 1, &frame.queueSubmittedFence);
-  }
-
-  if (frame.primaryCommandPool != VK_NULL_HANDLE) {
-    vkResetCommandPool(mDevice->getHandle(), frame.primaryCommandPool, 0);
-  }
-
-  // Recycle the old semaphore back into the semaphore pool.
-  if (frame.acquiredSemaphore != VK_NULL_HANDLE) {
-    mSemaphorePool.push_back(frame.acquiredSemaphore);
-  }
-
-  frame.acquiredSemaphore = semaphore;
-
-  return VK_SUCCESS;
+VkResult Swapchain::acquireNextImage(VkSemaphore acquiredSemaphore, uint32_t &imageIndex) {
+  // Waiting for the GPU to be done with the frame rendering into this image is up to the
+  // frame scheduler, since frames in flight are decoupled from swapchain images.
+  return vkAcquireNextImageKHR(mDevice->getHandle(), mHandle, UINT64_MAX, acquiredSemaphore,
+                               VK_NULL_HANDLE, &imageIndex);
 }
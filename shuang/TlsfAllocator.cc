@@ -0,0 +1,233 @@
+#include "TlsfAllocator.h"
+
+#include <cassert>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+// Index of the least significant bit set, value must not be zero
+uint32_t findFirstSet(uint64_t value) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward64(&index, value);
+  return index;
+#else
+  return __builtin_ctzll(value);
+#endif
+}
+
+// Index of the most significant bit set, value must not be zero
+uint32_t findLastSet(uint64_t value) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanReverse64(&index, value);
+  return index;
+#else
+  return 63 - __builtin_clzll(value);
+#endif
+}
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+TlsfAllocator::TlsfAllocator(uint64_t size) : mSize{size} {
+  for (auto &freeLists : mFreeLists) {
+    for (auto &freeList : freeLists) {
+      freeList = INVALID_HANDLE;
+    }
+  }
+
+  // The whole range starts as one free block
+  insertFreeBlock(createBlock(0, size));
+}
+
+TlsfAllocator::Handle TlsfAllocator::allocate(uint64_t size, uint64_t alignment) {
+  assert(size > 0 && (alignment & (alignment - 1)) == 0);
+
+  // Searching with the worst case padding guarantees that whichever block is found fits
+  auto handle = findFreeBlock(size + alignment - 1);
+  if (handle == INVALID_HANDLE) {
+    return INVALID_HANDLE;
+  }
+  removeFreeBlock(handle);
+
+  // Give the padding in front of the aligned offset back as a free block of its own. The previous
+  // physical block can't be free, since adjacent free blocks are always merged.
+  auto padding = alignUp(mBlocks[handle].offset, alignment) - mBlocks[handle].offset;
+  if (padding > 0) {
+    auto front = createBlock(mBlocks[handle].offset, padding);
+
+    mBlocks[front].prevPhys = mBlocks[handle].prevPhys;
+    mBlocks[front].nextPhys = handle;
+    if (mBlocks[handle].prevPhys != INVALID_HANDLE) {
+      mBlocks[mBlocks[handle].prevPhys].nextPhys = front;
+    }
+    mBlocks[handle].prevPhys = front;
+    mBlocks[handle].offset += padding;
+    mBlocks[handle].size -= padding;
+
+    insertFreeBlock(front);
+  }
+
+  if (mBlocks[handle].size > size) {
+    split(handle, size);
+  }
+
+  mBlocks[handle].free = false;
+  mUsedSize += mBlocks[handle].size;
+  ++mAllocationCount;
+  return handle;
+}
+
+void TlsfAllocator::free(Handle handle) {
+  assert(handle < mBlocks.size() && !mBlocks[handle].free);
+
+  mUsedSize -= mBlocks[handle].size;
+  --mAllocationCount;
+
+  auto prev = mBlocks[handle].prevPhys;
+  if (prev != INVALID_HANDLE && mBlocks[prev].free) {
+    removeFreeBlock(prev);
+    merge(prev, handle);
+    handle = prev;
+  }
+
+  auto next = mBlocks[handle].nextPhys;
+  if (next != INVALID_HANDLE && mBlocks[next].free) {
+    removeFreeBlock(next);
+    merge(handle, next);
+  }
+
+  insertFreeBlock(handle);
+}
+
+void TlsfAllocator::mapping(uint64_t size, uint32_t &fl, uint32_t &sl) {
+  if (size < SL_INDEX_COUNT) {
+    // Small sizes are binned linearly in the first list
+    fl = 0;
+    sl = static_cast<uint32_t>(size);
+  } else {
+    auto log2 = findLastSet(size);
+    fl        = log2 - SL_INDEX_LOG2 + 1;
+    sl        = static_cast<uint32_t>(size >> (log2 - SL_INDEX_LOG2)) - SL_INDEX_COUNT;
+  }
+}
+
+TlsfAllocator::Handle TlsfAllocator::findFreeBlock(uint64_t size) {
+  // Round up to the next size class, so that every block of the class found is large enough
+  if (size >= SL_INDEX_COUNT) {
+    auto round = (uint64_t{1} << (findLastSet(size) - SL_INDEX_LOG2)) - 1;
+    if (size > UINT64_MAX - round) {
+      return INVALID_HANDLE;
+    }
+    size += round;
+  }
+
+  uint32_t fl, sl;
+  mapping(size, fl, sl);
+
+  uint32_t slMap = mSlBitmaps[fl] & (~0u << sl);
+  if (slMap == 0) {
+    // No block in this class, take the smallest one of a larger first level
+    if (fl + 1 >= FL_INDEX_COUNT) {
+      return INVALID_HANDLE;
+    }
+    uint64_t flMap = mFlBitmap & (~uint64_t{0} << (fl + 1));
+    if (flMap == 0) {
+      return INVALID_HANDLE;
+    }
+    fl    = findFirstSet(flMap);
+    slMap = mSlBitmaps[fl];
+  }
+  sl = findFirstSet(slMap);
+
+  return mFreeLists[fl][sl];
+}
+
+void TlsfAllocator::insertFreeBlock(Handle handle) {
+  uint32_t fl, sl;
+  mapping(mBlocks[handle].size, fl, sl);
+
+  auto &block    = mBlocks[handle];
+  block.free     = true;
+  block.prevFree = INVALID_HANDLE;
+  block.nextFree = mFreeLists[fl][sl];
+  if (block.nextFree != INVALID_HANDLE) {
+    mBlocks[block.nextFree].prevFree = handle;
+  }
+  mFreeLists[fl][sl] = handle;
+
+  mFlBitmap |= uint64_t{1} << fl;
+  mSlBitmaps[fl] |= 1u << sl;
+}
+
+void TlsfAllocator::removeFreeBlock(Handle handle) {
+  uint32_t fl, sl;
+  mapping(mBlocks[handle].size, fl, sl);
+
+  auto &block = mBlocks[handle];
+  if (block.prevFree != INVALID_HANDLE) {
+    mBlocks[block.prevFree].nextFree = block.nextFree;
+  } else {
+    mFreeLists[fl][sl] = block.nextFree;
+  }
+  if (block.nextFree != INVALID_HANDLE) {
+    mBlocks[block.nextFree].prevFree = block.prevFree;
+  }
+  block.free = false;
+
+  if (mFreeLists[fl][sl] == INVALID_HANDLE) {
+    mSlBitmaps[fl] &= ~(1u << sl);
+    if (mSlBitmaps[fl] == 0) {
+      mFlBitmap &= ~(uint64_t{1} << fl);
+    }
+  }
+}
+
+TlsfAllocator::Handle TlsfAllocator::createBlock(uint64_t offset, uint64_t size) {
+  Handle handle;
+  if (mUnusedBlocks.empty()) {
+    handle = static_cast<Handle>(mBlocks.size());
+    mBlocks.emplace_back();
+  } else {
+    handle = mUnusedBlocks.back();
+    mUnusedBlocks.pop_back();
+    mBlocks[handle] = {};
+  }
+  mBlocks[handle].offset = offset;
+  mBlocks[handle].size   = size;
+  return handle;
+}
+
+void TlsfAllocator::destroyBlock(Handle handle) { mUnusedBlocks.push_back(handle); }
+
+void TlsfAllocator::split(Handle handle, uint64_t size) {
+  auto  tail = createBlock(mBlocks[handle].offset + size, mBlocks[handle].size - size);
+  auto &head = mBlocks[handle];
+
+  mBlocks[tail].prevPhys = handle;
+  mBlocks[tail].nextPhys = head.nextPhys;
+  if (head.nextPhys != INVALID_HANDLE) {
+    mBlocks[head.nextPhys].prevPhys = tail;
+  }
+  head.nextPhys = tail;
+  head.size     = size;
+
+  insertFreeBlock(tail);
+}
+
+void TlsfAllocator::merge(Handle handle, Handle next) {
+  auto &block = mBlocks[handle];
+  block.size += mBlocks[next].size;
+  block.nextPhys = mBlocks[next].nextPhys;
+  if (block.nextPhys != INVALID_HANDLE) {
+    mBlocks[block.nextPhys].prevPhys = handle;
+  }
+  destroyBlock(next);
+}
@@ -0,0 +1,50 @@
+#include "UniformRing.h"
+#include "Device.h"
+#include "Log.h"
+
+#include <algorithm>
+
+namespace {
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+VkDeviceSize getOffsetAlignment(const Device &device) {
+  const auto &limits = device.getPhysicalDevice()->getProperties().limits;
+  return std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+}
+
+} // namespace
+
+UniformRing::UniformRing(const std::shared_ptr<Device> &device, VkDeviceSize frameSize,
+                         uint32_t framesInFlight)
+    : Buffer(device, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+             alignUp(frameSize, getOffsetAlignment(*device)) * framesInFlight),
+      mFrameSize{alignUp(frameSize, getOffsetAlignment(*device))},
+      mAlignment{getOffsetAlignment(*device)} {
+  // Dynamic offsets are 32 bits
+  if (getSize() > UINT32_MAX) {
+    throw std::runtime_error(fmt::format("Uniform ring of {} bytes is too large", getSize()));
+  }
+  beginFrame(0);
+}
+
+void UniformRing::beginFrame(uint32_t frameIndex) {
+  mHead.store(frameIndex * mFrameSize, std::memory_order_relaxed);
+  mEnd = frameIndex * mFrameSize + mFrameSize;
+}
+
+void *UniformRing::allocate(VkDeviceSize size, uint32_t &offset) {
+  // The head stays aligned, so that allocating is a single atomic add
+  auto head = mHead.fetch_add(alignUp(size, mAlignment), std::memory_order_relaxed);
+  if (head + size > mEnd) {
+    throw std::runtime_error(
+        fmt::format("Uniform ring frame of {} bytes is full, can't allocate {} more bytes",
+                    mFrameSize, size));
+  }
+
+  offset = static_cast<uint32_t>(head);
+  return static_cast<uint8_t *>(getMapped()) + head;
+}
@@ -0,0 +1,468 @@
+#include "UploadBatcher.h"
+#include "Buffer.h"
+#include "Device.h"
+#include "Image.h"
+#include "Log.h"
+#include "Macros.h"
+#include "Parallel.h"
+#include "Profiler.h"
+
+// Keeps staged copies on the optimal offset alignment of most devices, which is also a multiple
+// of the texel size of every color format
+#define STAGING_ALIGNMENT 16
+
+namespace {
+
+// Every access the uploaded data may be read with afterwards
+constexpr VkAccessFlags READ_ACCESS_MASK =
+    VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+    VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT |
+    VK_ACCESS_TRANSFER_READ_BIT;
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+UploadBatcher::UploadBatcher(const Device &device, VkDeviceSize ringSize, const Queue &queue)
+    : mDevice{device}, mQueue{queue},
+      mReleasing{queue.getFamilyIndex() != device.getQueueFamilyIndices().graphics},
+      mRingSize{ringSize} {
+  VkBufferCreateInfo bufferCreateInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+  bufferCreateInfo.usage       = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  bufferCreateInfo.size        = ringSize;
+  bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  vkOK(vkCreateBuffer(device.getHandle(), &bufferCreateInfo, nullptr, &mRing));
+
+  VkMemoryRequirements memoryRequirements;
+  vkGetBufferMemoryRequirements(device.getHandle(), mRing, &memoryRequirements);
+  mRingAllocation = device.getMemoryAllocator().allocate(
+      memoryRequirements,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      MemoryLifetime::LONG_LIVED);
+  vkOK(vkBindBufferMemory(device.getHandle(), mRing, mRingAllocation.memory,
+                          mRingAllocation.offset));
+
+  // Batches are recycled one by one, thus their command buffers are reset individually
+  VkCommandPoolCreateInfo commandPoolCreateInfo{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+  commandPoolCreateInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+                                VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  commandPoolCreateInfo.queueFamilyIndex = queue.getFamilyIndex();
+  vkOK(vkCreateCommandPool(device.getHandle(), &commandPoolCreateInfo, nullptr, &mCommandPool));
+
+  // The acquisitions are recorded for the graphics queue
+  if (mReleasing) {
+    commandPoolCreateInfo.queueFamilyIndex = device.getQueueFamilyIndices().graphics;
+    vkOK(vkCreateCommandPool(device.getHandle(), &commandPoolCreateInfo, nullptr,
+                             &mAcquireCommandPool));
+  }
+}
+
+UploadBatcher::~UploadBatcher() {
+  log_func;
+
+  auto destroy = [&](const Batch &batch) {
+    vkDestroyFence(mDevice.getHandle(), batch.fence, nullptr);
+    vkDestroySemaphore(mDevice.getHandle(), batch.semaphore, nullptr);
+  };
+  for (const auto *batches : {&mInFlight, &mAcquiring}) {
+    for (const auto &batch : *batches) {
+      vkOK(vkWaitForFences(mDevice.getHandle(), 1, &batch.fence, VK_TRUE, UINT64_MAX));
+      destroy(batch);
+    }
+  }
+  // Their fences have been waited for already
+  for (const auto &batch : mCopied) {
+    destroy(batch);
+  }
+  for (const auto &batch : mFreeBatches) {
+    destroy(batch);
+  }
+  if (mRecording.commandBuffer != VK_NULL_HANDLE) {
+    log_warn("Uploads recorded but never flushed");
+    destroy(mRecording);
+  }
+  // Frees all the command buffers along
+  vkDestroyCommandPool(mDevice.getHandle(), mCommandPool, nullptr);
+  if (mAcquireCommandPool != VK_NULL_HANDLE) {
+    vkDestroyCommandPool(mDevice.getHandle(), mAcquireCommandPool, nullptr);
+  }
+
+  vkDestroyBuffer(mDevice.getHandle(), mRing, nullptr);
+  mDevice.getMemoryAllocator().free(mRingAllocation);
+}
+
+void *UploadBatcher::stage(const Buffer &dst, VkDeviceSize size, VkDeviceSize dstOffset,
+                           Token &token) {
+  std::lock_guard<std::mutex> lock{mMutex};
+
+  auto  offset = allocate(size);
+  auto &batch  = getRecordingBatch();
+
+  VkBufferCopy bufferCopy{};
+  bufferCopy.srcOffset = offset;
+  bufferCopy.dstOffset = dstOffset;
+  bufferCopy.size      = size;
+  vkCmdCopyBuffer(batch.commandBuffer, mRing, dst.getHandle(), 1, &bufferCopy);
+  release(batch, dst, dstOffset, size);
+
+  token = batch.token;
+  return static_cast<uint8_t *>(mRingAllocation.mapped) + offset;
+}
+
+UploadBatcher::Token UploadBatcher::upload(const Buffer &dst, const void *data, VkDeviceSize size,
+                                           VkDeviceSize dstOffset) {
+  Token token = 0;
+  // Larger uploads go through the ring piece by piece, waiting for it to drain in between
+  for (VkDeviceSize copied = 0; copied < size;) {
+    auto chunkSize = std::min(size - copied, mRingSize);
+    auto staging   = stage(dst, chunkSize, dstOffset + copied, token);
+    memcpy(staging, static_cast<const uint8_t *>(data) + copied, chunkSize);
+    copied += chunkSize;
+  }
+  return token;
+}
+
+UploadBatcher::Token UploadBatcher::upload(const Buffer                              &dst,
+                                           const std::vector<VkDeviceSize>           &offsets,
+                                           const std::function<void(size_t, void *)> &fill) {
+  std::lock_guard<std::mutex> lock{mMutex};
+
+  Token token = mNextToken - 1;
+  for (size_t first = 0; first + 1 < offsets.size();) {
+    // Gather as many ranges as fit in half the ring, at least one
+    auto last = first + 1;
+    while (last + 1 < offsets.size() && offsets[last + 1] - offsets[first] <= mRingSize / 2) {
+      ++last;
+    }
+    auto size = offsets[last] - offsets[first];
+    if (size == 0) {
+      first = last;
+      continue;
+    }
+
+    // The batch holding the copy must not be submitted before the ranges are written, thus is
+    // started afresh, as the ring never submits a batch to make room for its first allocation
+    if (mRecording.commandBuffer != VK_NULL_HANDLE) {
+      submit();
+    }
+    auto  offset = allocate(size);
+    auto &batch  = getRecordingBatch();
+
+    VkBufferCopy bufferCopy{};
+    bufferCopy.srcOffset = offset;
+    bufferCopy.dstOffset = offsets[first];
+    bufferCopy.size      = size;
+    vkCmdCopyBuffer(batch.commandBuffer, mRing, dst.getHandle(), 1, &bufferCopy);
+    release(batch, dst, offsets[first], size);
+
+    auto staging = static_cast<uint8_t *>(mRingAllocation.mapped) + offset;
+    parallel::forEach(last - first, [&](size_t i) {
+      fill(first + i, staging + offsets[first + i] - offsets[first]);
+    });
+
+    token = batch.token;
+    first = last;
+  }
+  return token;
+}
+
+UploadBatcher::Token UploadBatcher::upload(const Image &dst, const void *data, VkDeviceSize size,
+                                           VkImageLayout layout) {
+  if (size > mRingSize) {
+    throw std::runtime_error(
+        fmt::format("Image of {} bytes doesn't fit in the {} bytes staging ring", size, mRingSize));
+  }
+
+  std::lock_guard<std::mutex> lock{mMutex};
+
+  auto  offset = allocate(size);
+  auto &batch  = getRecordingBatch();
+  memcpy(static_cast<uint8_t *>(mRingAllocation.mapped) + offset, data, size);
+
+  VkImageMemoryBarrier imageMemoryBarrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+  imageMemoryBarrier.srcAccessMask               = 0;
+  imageMemoryBarrier.dstAccessMask               = VK_ACCESS_TRANSFER_WRITE_BIT;
+  imageMemoryBarrier.oldLayout                   = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageMemoryBarrier.newLayout                   = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  imageMemoryBarrier.srcQueueFamilyIndex         = VK_QUEUE_FAMILY_IGNORED;
+  imageMemoryBarrier.dstQueueFamilyIndex         = VK_QUEUE_FAMILY_IGNORED;
+  imageMemoryBarrier.image                       = dst.getHandle();
+  imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  imageMemoryBarrier.subresourceRange.levelCount = 1;
+  imageMemoryBarrier.subresourceRange.layerCount = 1;
+  vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1,
+                       &imageMemoryBarrier);
+
+  VkBufferImageCopy bufferImageCopy{};
+  bufferImageCopy.bufferOffset                = offset;
+  bufferImageCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  bufferImageCopy.imageSubresource.layerCount = 1;
+  bufferImageCopy.imageExtent                 = {dst.getExtent().width, dst.getExtent().height, 1};
+  vkCmdCopyBufferToImage(batch.commandBuffer, mRing, dst.getHandle(),
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferImageCopy);
+
+  imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+  imageMemoryBarrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  imageMemoryBarrier.newLayout     = layout;
+  if (mReleasing) {
+    // Transitioned along the ownership transfer, by both its release and its acquisition
+    imageMemoryBarrier.srcQueueFamilyIndex = mQueue.getFamilyIndex();
+    imageMemoryBarrier.dstQueueFamilyIndex = mDevice.getQueueFamilyIndices().graphics;
+    batch.imageBarriers.push_back(imageMemoryBarrier);
+  } else {
+    vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1,
+                         &imageMemoryBarrier);
+  }
+
+  return batch.token;
+}
+
+UploadBatcher::Token UploadBatcher::flush() {
+  PROFILE_FUNCTION();
+  std::lock_guard<std::mutex> lock{mMutex};
+
+  if (mRecording.commandBuffer != VK_NULL_HANDLE) {
+    submit();
+  }
+  // Recycle the batches done meanwhile, so that their command buffers and fences are reused rather
+  // than piling up until the ring is full
+  retire(false);
+  if (mReleasing) {
+    handOver();
+  }
+  return mNextToken - 1;
+}
+
+bool UploadBatcher::isComplete(Token token) {
+  std::lock_guard<std::mutex> lock{mMutex};
+
+  retire(false);
+  return token <= mCompletedToken;
+}
+
+void UploadBatcher::wait(Token token) {
+  std::lock_guard<std::mutex> lock{mMutex};
+
+  if (mRecording.commandBuffer != VK_NULL_HANDLE && token >= mRecording.token) {
+    submit();
+  }
+  while (token > mCompletedToken && !mInFlight.empty()) {
+    retire(true);
+  }
+  if (mReleasing) {
+    handOver();
+  }
+}
+
+VkDeviceSize UploadBatcher::allocate(VkDeviceSize size) {
+  if (size > mRingSize) {
+    throw std::runtime_error(fmt::format(
+        "Upload of {} bytes doesn't fit in the {} bytes staging ring", size, mRingSize));
+  }
+
+  for (;;) {
+    auto offset  = alignUp(mRingHead, STAGING_ALIGNMENT);
+    auto padding = offset - mRingHead;
+    if (offset + size > mRingSize) {
+      // Skip the tail of the ring, it is given back along with the batch
+      offset  = 0;
+      padding = mRingSize - mRingHead;
+    }
+
+    if (mRingUsed + padding + size <= mRingSize) {
+      mRingHead = offset + size;
+      mRingUsed += padding + size;
+      getRecordingBatch().ringBytes += padding + size;
+      return offset;
+    }
+
+    // The ring is full, the batch being recorded holds part of it too
+    if (mRecording.commandBuffer != VK_NULL_HANDLE) {
+      submit();
+    }
+    retire(true);
+  }
+}
+
+UploadBatcher::Batch &UploadBatcher::getRecordingBatch() {
+  if (mRecording.commandBuffer != VK_NULL_HANDLE) {
+    return mRecording;
+  }
+
+  if (!mFreeBatches.empty()) {
+    mRecording = mFreeBatches.back();
+    mFreeBatches.pop_back();
+  } else {
+    VkCommandBufferAllocateInfo commandBufferAllocateInfo{
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+    commandBufferAllocateInfo.commandPool        = mCommandPool;
+    commandBufferAllocateInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandBufferAllocateInfo.commandBufferCount = 1;
+    vkOK(vkAllocateCommandBuffers(mDevice.getHandle(), &commandBufferAllocateInfo,
+                                  &mRecording.commandBuffer));
+
+    VkFenceCreateInfo fenceCreateInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    vkOK(vkCreateFence(mDevice.getHandle(), &fenceCreateInfo, nullptr, &mRecording.fence));
+
+    if (mReleasing) {
+      commandBufferAllocateInfo.commandPool = mAcquireCommandPool;
+      vkOK(vkAllocateCommandBuffers(mDevice.getHandle(), &commandBufferAllocateInfo,
+                                    &mRecording.acquireCommandBuffer));
+
+      VkSemaphoreCreateInfo semaphoreCreateInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+      vkOK(vkCreateSemaphore(mDevice.getHandle(), &semaphoreCreateInfo, nullptr,
+                             &mRecording.semaphore));
+    }
+  }
+  mRecording.token = mNextToken++;
+
+  // Implicitly resets the command buffer when recycled
+  VkCommandBufferBeginInfo commandBufferBeginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+  commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkOK(vkBeginCommandBuffer(mRecording.commandBuffer, &commandBufferBeginInfo));
+
+  // Copies may overwrite data still read by earlier submissions, e.g. updated transforms, thus
+  // wait for them to execute first
+  vkCmdPipelineBarrier(mRecording.commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+  return mRecording;
+}
+
+void UploadBatcher::release(Batch &batch, const Buffer &dst, VkDeviceSize offset,
+                            VkDeviceSize size) {
+  if (!mReleasing) {
+    return;
+  }
+
+  // Consecutive ranges of a buffer, e.g. the chunks of a large upload, are released at once
+  if (!batch.bufferBarriers.empty()) {
+    auto &last = batch.bufferBarriers.back();
+    if (last.buffer == dst.getHandle() && last.offset + last.size == offset) {
+      last.size += size;
+      return;
+    }
+  }
+
+  VkBufferMemoryBarrier bufferMemoryBarrier{VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
+  bufferMemoryBarrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+  bufferMemoryBarrier.srcQueueFamilyIndex = mQueue.getFamilyIndex();
+  bufferMemoryBarrier.dstQueueFamilyIndex = mDevice.getQueueFamilyIndices().graphics;
+  bufferMemoryBarrier.buffer              = dst.getHandle();
+  bufferMemoryBarrier.offset              = offset;
+  bufferMemoryBarrier.size                = size;
+  batch.bufferBarriers.push_back(bufferMemoryBarrier);
+}
+
+void UploadBatcher::submit() {
+  std::vector<VkSemaphore> signalSemaphores;
+  if (mReleasing) {
+    // Release the uploaded ranges to the graphics queue, which acquires them once it waited for
+    // the semaphore
+    vkCmdPipelineBarrier(mRecording.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+                         static_cast<uint32_t>(mRecording.bufferBarriers.size()),
+                         mRecording.bufferBarriers.data(),
+                         static_cast<uint32_t>(mRecording.imageBarriers.size()),
+                         mRecording.imageBarriers.data());
+    signalSemaphores.push_back(mRecording.semaphore);
+  } else {
+    // Make the uploaded data visible to every command submitted to the queue afterwards, at once
+    // for all the copies of the batch
+    VkMemoryBarrier memoryBarrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = READ_ACCESS_MASK;
+    vkCmdPipelineBarrier(mRecording.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0,
+                         nullptr);
+  }
+  vkOK(vkEndCommandBuffer(mRecording.commandBuffer));
+  vkOK(mQueue.submit({mRecording.commandBuffer}, {}, signalSemaphores, mRecording.fence));
+
+  // The queue is the graphics one, whose next submissions observe the copies
+  if (!mReleasing) {
+    mAvailableToken.store(mRecording.token, std::memory_order_release);
+  }
+  mInFlight.push_back(mRecording);
+  mRecording = {};
+}
+
+void UploadBatcher::retire(bool wait) {
+  if (wait && !mInFlight.empty()) {
+    vkOK(vkWaitForFences(mDevice.getHandle(), 1, &mInFlight.front().fence, VK_TRUE, UINT64_MAX));
+  }
+
+  while (!mInFlight.empty() &&
+         vkGetFenceStatus(mDevice.getHandle(), mInFlight.front().fence) == VK_SUCCESS) {
+    auto batch = mInFlight.front();
+    mInFlight.pop_front();
+
+    mRingUsed -= batch.ringBytes;
+    batch.ringBytes = 0;
+    mCompletedToken = batch.token;
+
+    if (mReleasing) {
+      vkOK(vkResetFences(mDevice.getHandle(), 1, &batch.fence));
+      mCopied.push_back(std::move(batch));
+    } else {
+      recycle(batch);
+    }
+  }
+
+  // Nothing is pending in the ring anymore, start over from its beginning
+  if (mRingUsed == 0) {
+    mRingHead = 0;
+  }
+}
+
+void UploadBatcher::handOver() {
+  while (!mAcquiring.empty() &&
+         vkGetFenceStatus(mDevice.getHandle(), mAcquiring.front().fence) == VK_SUCCESS) {
+    recycle(mAcquiring.front());
+    mAcquiring.pop_front();
+  }
+
+  for (auto &batch : mCopied) {
+    VkCommandBufferBeginInfo commandBufferBeginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkOK(vkBeginCommandBuffer(batch.acquireCommandBuffer, &commandBufferBeginInfo));
+
+    // The same ownership transfers as released, made visible to every command submitted to the
+    // graphics queue afterwards
+    for (auto &barrier : batch.bufferBarriers) {
+      barrier.srcAccessMask = 0;
+      barrier.dstAccessMask = READ_ACCESS_MASK;
+    }
+    for (auto &barrier : batch.imageBarriers) {
+      barrier.srcAccessMask = 0;
+    }
+    vkCmdPipelineBarrier(batch.acquireCommandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr,
+                         static_cast<uint32_t>(batch.bufferBarriers.size()),
+                         batch.bufferBarriers.data(),
+                         static_cast<uint32_t>(batch.imageBarriers.size()),
+                         batch.imageBarriers.data());
+    vkOK(vkEndCommandBuffer(batch.acquireCommandBuffer));
+
+    // The copies are done already, thus the semaphore is signaled and the queue doesn't stall
+    vkOK(mDevice.getGraphicsQueue().submit({batch.acquireCommandBuffer},
+                                           {{batch.semaphore, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT}},
+                                           {}, batch.fence));
+
+    mAvailableToken.store(batch.token, std::memory_order_release);
+    mAcquiring.push_back(std::move(batch));
+  }
+  mCopied.clear();
+}
+
+void UploadBatcher::recycle(Batch &batch) {
+  vkOK(vkResetFences(mDevice.getHandle(), 1, &batch.fence));
+  batch.bufferBarriers.clear();
+  batch.imageBarriers.clear();
+  mFreeBatches.push_back(std::move(batch));
+}
@@ -0,0 +1,114 @@
+#include "VertexLayout.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+static_assert(sizeof(PackedVertex) == 12, "Packed vertices must not be padded");
+static_assert(sizeof(PositionDequantization) == 32, "Must match the push constants of shaders");
+
+namespace {
+
+int16_t encodeSnorm16(float value) {
+  return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+uint8_t encodeUnorm8(float value) {
+  return static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+
+} // namespace
+
+const VertexLayout &VertexLayout::get(VertexFormat format) {
+  // Indexed by format
+  static const VertexLayout layouts[] = {
+      {VertexFormat::FLOAT,
+       sizeof(Vertex),
+       {{0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position)},
+        {1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color)}}},
+      {VertexFormat::PACKED,
+       sizeof(PackedVertex),
+       {{0, VK_FORMAT_R16G16B16A16_SNORM, offsetof(PackedVertex, position)},
+        {1, VK_FORMAT_R8G8B8A8_UNORM, offsetof(PackedVertex, color)}}},
+  };
+
+  auto index = static_cast<size_t>(format);
+  if (index >= std::size(layouts)) {
+    throw std::runtime_error(fmt::format("Unknown vertex format {}", index));
+  }
+  return layouts[index];
+}
+
+VertexLayout::VertexLayout(VertexFormat format, uint32_t stride, std::vector<Attribute> attributes)
+    : mFormat{format}, mStride{stride}, mAttributes{std::move(attributes)} {}
+
+VkVertexInputBindingDescription VertexLayout::getBindingDescription(uint32_t binding) const {
+  return {
+      .binding   = binding,
+      .stride    = mStride,
+      .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+  };
+}
+
+void VertexLayout::appendAttributeDescriptions(
+    uint32_t binding, std::vector<VkVertexInputAttributeDescription> &attributes) const {
+  for (const auto &attribute : mAttributes) {
+    attributes.push_back({
+        .location = attribute.location,
+        .binding  = binding,
+        .format   = attribute.format,
+        .offset   = attribute.offset,
+    });
+  }
+}
+
+PositionDequantization VertexLayout::computeDequantization(const Vertex *vertices,
+                                                           size_t        count) const {
+  PositionDequantization dequantization;
+  if (mFormat == VertexFormat::FLOAT || count == 0) {
+    return dequantization;
+  }
+
+  glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+  for (size_t i = 0; i < count; ++i) {
+    boundsMin = glm::min(boundsMin, vertices[i].position);
+    boundsMax = glm::max(boundsMax, vertices[i].position);
+  }
+
+  // Flat axes keep a unit scale, their positions all encode to zero
+  auto halfExtent = (boundsMax - boundsMin) * 0.5f;
+  for (int i = 0; i < 3; ++i) {
+    if (halfExtent[i] <= 0.0f) {
+      halfExtent[i] = 1.0f;
+    }
+  }
+  dequantization.offset = glm::vec4((boundsMin + boundsMax) * 0.5f, 0.0f);
+  dequantization.scale  = glm::vec4(halfExtent, 1.0f);
+  return dequantization;
+}
+
+void VertexLayout::encode(const Vertex *vertices, size_t count,
+                          const PositionDequantization &dequantization, void *dst) const {
+  if (mFormat == VertexFormat::FLOAT) {
+    memcpy(dst, vertices, count * sizeof(Vertex));
+    return;
+  }
+
+  auto offset  = glm::vec3(dequantization.offset);
+  auto inverse = glm::vec3(1.0f) / glm::vec3(dequantization.scale);
+  auto packed  = static_cast<PackedVertex *>(dst);
+  for (size_t i = 0; i < count; ++i) {
+    auto  position = (vertices[i].position - offset) * inverse;
+    auto &vertex   = packed[i];
+    for (int j = 0; j < 3; ++j) {
+      vertex.position[j] = encodeSnorm16(position[j]);
+      vertex.color[j]    = encodeUnorm8(vertices[i].color[j]);
+    }
+    vertex.position[3] = 0;
+    vertex.color[3]    = 255;
+  }
+}
@@ -28,27 +28,6 @@ void windowFocusCallback(GLFWwindow *window, int focused) {
   }
 }
 
-KeyCode mapKeyCode(int key) {
-  static const std::unordered_map<int, KeyCode> lookup = {
-      {GLFW_KEY_ESCAPE, KeyCode::ESCAPE}, {GLFW_KEY_UP, KeyCode::UP},
-      {GLFW_KEY_DOWN, KeyCode::DOWN},     {GLFW_KEY_LEFT, KeyCode::LEFT},
-      {GLFW_KEY_RIGHT, KeyCode::RIGHT},   {GLFW_KEY_H, KeyCode::H},
-      {GLFW_KEY_L, KeyCode::L},           {GLFW_KEY_J, KeyCode::J},
-      {GLFW_KEY_K, KeyCode::K},           {GLFW_KEY_W, KeyCode::W},
-      {GLFW_KEY_R, KeyCode::R},           {GLFW_KEY_S, KeyCode::S},
-      {GLFW_KEY_A, KeyCode::A},           {GLFW_KEY_D, KeyCode::D},
-      {GLFW_KEY_Q, KeyCode::Q},           {GLFW_KEY_E, KeyCode::E},
-      {GLFW_KEY_F, KeyCode::F},           {GLFW_KEY_I, KeyCode::I},
-      {GLFW_KEY_U, KeyCode::U},           {GLFW_KEY_O, KeyCode::O},
-      {GLFW_KEY_F5, KeyCode::F5},
-  };
-  auto iter = lookup.find(key);
-  if (iter == lookup.end()) {
-    return KeyCode::UNKNOWN;
-  }
-  return iter->second;
-}
-
 KeyAction mapKeyAction(int action) {
   static const std::unordered_map<int, KeyAction> lookup = {
       {GLFW_PRESS, KeyAction::DOWN},
@@ -89,7 +68,7 @@ MouseButton mapMouseButton(int button) {
 
 void keyCallback(GLFWwindow *window, int key, int /* scancode */, int action, int /* mods */) {
   if (auto platform = reinterpret_cast<Application *>(glfwGetWindowUserPointer(window))) {
-    auto keyCode   = mapKeyCode(key);
+    auto keyCode   = Window::mapKeyCode(key);
     auto keyAction = mapKeyAction(action);
 
     platform->handleEvent(KeyInputEvent{keyCode, keyAction});
@@ -171,6 +150,15 @@ void Window::close() { glfwSetWindowShouldClose(mHandle, GLFW_TRUE); }
 
 void Window::pollEvents() { glfwPollEvents(); }
 
+std::vector<const char *> Window::getRequiredInstanceExtensions() const {
+  uint32_t     count;
+  const char **extensions = glfwGetRequiredInstanceExtensions(&count);
+  if (extensions == nullptr) {
+    throw std::runtime_error("Vulkan is not available for window surface creation");
+  }
+  return {extensions, extensions + count};
+}
+
 VkSurfaceKHR Window::createSurface(const VkInstance instance) const {
   VkSurfaceKHR surface;
   vkOK(glfwCreateWindowSurface(instance, mHandle, nullptr, &surface));
@@ -178,3 +166,24 @@ VkSurfaceKHR Window::createSurface(const VkInstance instance) const {
 }
 
 double Window::getTime() const { return glfwGetTime(); }
+
+KeyCode Window::mapKeyCode(int key) {
+  static const std::unordered_map<int, KeyCode> lookup = {
+      {GLFW_KEY_ESCAPE, KeyCode::ESCAPE}, {GLFW_KEY_UP, KeyCode::UP},
+      {GLFW_KEY_DOWN, KeyCode::DOWN},     {GLFW_KEY_LEFT, KeyCode::LEFT},
+      {GLFW_KEY_RIGHT, KeyCode::RIGHT},   {GLFW_KEY_H, KeyCode::H},
+      {GLFW_KEY_L, KeyCode::L},           {GLFW_KEY_J, KeyCode::J},
+      {GLFW_KEY_K, KeyCode::K},           {GLFW_KEY_W, KeyCode::W},
+      {GLFW_KEY_R, KeyCode::R},           {GLFW_KEY_S, KeyCode::S},
+      {GLFW_KEY_A, KeyCode::A},           {GLFW_KEY_D, KeyCode::D},
+      {GLFW_KEY_Q, KeyCode::Q},           {GLFW_KEY_E, KeyCode::E},
+      {GLFW_KEY_F, KeyCode::F},           {GLFW_KEY_I, KeyCode::I},
+      {GLFW_KEY_U, KeyCode::U},           {GLFW_KEY_O, KeyCode::O},
+      {GLFW_KEY_F5, KeyCode::F5},
+  };
+  auto iter = lookup.find(key);
+  if (iter == lookup.end()) {
+    return KeyCode::UNKNOWN;
+  }
+  return iter->second;
+}
@@ -5,25 +5,67 @@
 #include "DescriptorSet.h"
 #include "DescriptorSetLayout.h"
 #include "Device.h"
+#include "FrameScheduler.h"
+#include "GpuProfiler.h"
 #include "IndexBuffer.h"
+#include "IndirectRenderer.h"
 #include "InputEvent.h"
 #include "Instance.h"
+#include "InstanceBuffer.h"
 #include "Log.h"
 #include "PhysicalDevice.h"
 #include "Pipeline.h"
 #include "RenderPass.h"
+#include "RenderTarget.h"
+#include "Scene.h"
 #include "Surface.h"
 #include "Swapchain.h"
-#include "UniformBuffer.h"
+#include "UniformRing.h"
 #include "VertexBuffer.h"
 #include "Window.h"
 #include "model/Model.h"
 
 class Application {
 public:
-  struct Setting {};
+  struct Setting {
+    // Render into offscreen render targets, without any window, surface or swapchain
+    bool headless = false;
+    // Number of frames to render before leaving the main loop in headless mode, 0 for no limit
+    uint32_t frameCount = 0;
+    // Time step of every update in seconds, for reproducible runs, 0 to use the time elapsed
+    float fixedTimeStep = 0.0f;
+    // Number of frames the CPU may record ahead of the GPU, regardless of the swapchain images
+    uint32_t framesInFlight = 2;
+    // Mesh to draw instead of the cube, OBJ, glTF or MeshFile
+    std::string modelPath;
+    // Draw the model n x n times on a grid with a single instanced draw, instead of once
+    uint32_t instanceGridSize = 1;
+    // Draw the instances of the model as objects culled on the GPU and drawn indirectly, instead
+    // of through the scene
+    bool gpuDriven = false;
+    // Upload the vertices of the model quantized, in VertexFormat::PACKED, unless loaded from a
+    // mesh file which has its own format
+    bool packedVertices = false;
+    // Weld and reorder the triangles and vertices of the imported model with the MeshOptimizer,
+    // unless loaded from a mesh file, which is optimized when converted
+    bool optimizeMeshes = false;
+    // Draw the imported model as triangle strips separated by primitive restarts, unless loaded
+    // from a mesh file, which is converted to strips instead
+    bool triangleStrips = false;
+    // Generate levels of detail of the imported model with the MeshSimplifier, unless loaded from
+    // a mesh file, which has them generated when converted instead
+    bool generateLods = false;
+    // Time the passes and draws of the frames on the GPU, logged along with the FPS
+    bool gpuProfiling = false;
+    // Chrome trace of the CPU profiler written when leaving the main loop, if built with
+    // SHUANG_PROFILING
+    std::string tracePath;
+  };
 
-  explicit Application(const Setting &setting = {});
+  // Setting can't be a default argument here, its member initializers aren't usable until the end
+  // of the enclosing class
+  Application();
+  explicit Application(const Setting &setting);
   virtual ~Application();
 
   bool setup(bool enableValidation = true);
@@ -35,22 +77,63 @@ public:
   void setFocus(bool focus);
 
 protected:
-  virtual void     update(float timeStep);
-  void             updateScene(float timeStep);
-  virtual VkResult render(uint32_t imageIndex);
-  virtual VkResult present(uint32_t imageIndex);
+  virtual void         update(float timeStep);
+  void                 updateScene(float timeStep);
+  virtual VkResult     render(uint32_t imageIndex);
+  virtual VkResult     present(uint32_t imageIndex);
+  [[nodiscard]] double getTime() const;
 
+  // Replaces the camera set up by default, e.g. by a scripted one
+  void setCamera(std::shared_ptr<Camera> camera) { mCamera = std::move(camera); }
+  // The device, e.g. to read the statistics of its memory allocator
+  [[nodiscard]] const std::shared_ptr<Device> &getDevice() const { return mDevice; }
+  // Paces the frames, and measures how long the CPU waits for the GPU
+  [[nodiscard]] const FrameScheduler &getFrameScheduler() const { return *mFrameScheduler; }
+  // Null unless profiling
+  [[nodiscard]] const GpuProfiler *getGpuProfiler() const { return mGpuProfiler.get(); }
+  // Number of models of the scene drawn by the last frame
+  [[nodiscard]] size_t getDrawCount() const { return mDrawList.size(); }
+
+  Setting     mSetting;
   std::string mTitle  = "Example";
   uint32_t    mWidth  = 480;
   uint32_t    mHeight = 360;
+  // Models drawn with the world transform of their node, updated before each frame
+  Scene mScene;
+  // Models of the scene found visible by the camera for the last frame
+  Scene::CullStatistics mCullStatistics{};
 
 private:
-  // load models; create uniform buffer
+  // load models; create uniform ring
   virtual void                    setupModels();
-  void                            updateUniformBuffer();
-  VkShaderModule                  loadShader(const char *path);
+  void                            setupOffscreen();
+  // Writes the uniforms of the frame into the ring, once the camera is updated
+  void                            writeUniforms();
+  // Binds the uniforms of the frame, to be done once per command buffer
+  void                            bindUniforms(const VkCommandBuffer &commandBuffer);
+  VkResult                        acquireNextImage(uint32_t &imageIndex);
+  [[nodiscard]] bool              shouldClose() const;
+  [[nodiscard]] VkExtent2D        getRenderExtent() const;
   VkPipelineShaderStageCreateInfo loadShader(const char *path, VkShaderStageFlagBits stage);
-  static void                     draw(const VkCommandBuffer &commandBuffer, const Model *model);
+  // Records the draws [begin, end) of the draw list into a secondary command buffer, along with
+  // the grid and the indirect draws for the first draws
+  void                            recordDraws(VkCommandBuffer commandBuffer,
+                                              VkFramebuffer framebuffer, VkExtent2D extent,
+                                              size_t begin, size_t end);
+  // Draws every instance of a model at a level of detail with a model matrix, with the pipeline
+  // of the given layout bound. A fade in [0, 1) draws the level dithered, and the fade minus 1 the
+  // other pixels.
+  static void                     draw(const VkCommandBuffer &commandBuffer,
+                                       VkPipelineLayout pipelineLayout, const Model *model,
+                                       const InstanceBuffer *instances, const glm::mat4 &transform,
+                                       uint32_t lod = 0, float fade = 1.0f);
+  // Submits the culling of the indirect renderer to the compute queue, to run concurrently with
+  // the end of the previous frame
+  void                            submitCompute(const Frustum     &frustum,
+                                                const LodSelector &lodSelector);
+  // Scopes of the GPU profiler, if profiling, ignored otherwise
+  uint32_t beginGpuScope(VkCommandBuffer commandBuffer, std::string name, bool statistics = false);
+  void     endGpuScope(VkCommandBuffer commandBuffer, uint32_t scope);
 
   std::shared_ptr<Window>         mWindow         = nullptr;
   std::shared_ptr<Instance>       mInstance       = nullptr;
@@ -59,24 +142,54 @@ private:
   std::shared_ptr<Device>         mDevice         = nullptr;
   std::shared_ptr<Swapchain>      mSwapchain      = nullptr;
   std::shared_ptr<RenderPass>     mRenderPass     = nullptr;
+  std::unique_ptr<FrameScheduler> mFrameScheduler = nullptr;
+  std::unique_ptr<GpuProfiler>    mGpuProfiler    = nullptr;
+  // Headless mode renders into these targets, one per frame in flight, instead of the swapchain
+  // images
+  std::vector<std::unique_ptr<RenderTarget>> mRenderTargets;
+  uint64_t                                   mFrameNumber = 0;
   struct {
     std::unique_ptr<DescriptorSetLayout> model;
   } mDescriptorSetLayouts;
+  // Bound with a dynamic offset into the uniform ring
   struct {
     std::unique_ptr<DescriptorSet> model;
   } mDescriptorSets;
   std::shared_ptr<DescriptorPool> mDescriptorPool = nullptr;
   struct {
     VkPipelineLayout model;
+    // The model set, then the object set of the indirect renderer
+    VkPipelineLayout indirect = VK_NULL_HANDLE;
   } mPipelineLayouts;
   struct {
     VkPipeline grid; // line mode
     VkPipeline model; // triangle mode
+    VkPipeline indirect = VK_NULL_HANDLE;
   } mPipelines;
-  std::unique_ptr<UniformBuffer> mUniformBuffer = nullptr;
+  // Uniforms of the frames in flight, and the offset of the ones of the current frame
+  std::unique_ptr<UniformRing> mUniformRing;
+  uint32_t                     mUniformOffset = 0;
   struct {
     std::unique_ptr<Model> grid;
-    std::unique_ptr<Model> cube;
+    std::unique_ptr<Model> model;
   } mModels;
+  struct {
+    // A single identity instance, for the models drawn without instances
+    std::unique_ptr<InstanceBuffer> single;
+    std::unique_ptr<InstanceBuffer> model;
+  } mInstances;
+  // Draws the instances of the model in GPU driven mode
+  std::unique_ptr<IndirectRenderer> mIndirectRenderer;
+  // Whether the last update uploaded objects, which the culling must wait for
+  bool mObjectsUploaded = false;
+  // A model of the scene in view, gathered before the recording threads start
+  struct DrawItem {
+    const Model          *model;
+    const glm::mat4      *transform;
+    const InstanceBuffer *instances;
+    // Fading over the previous level if the fade is under 1
+    const LodSelector::State *lod;
+  };
+  std::vector<DrawItem> mDrawList;
   std::shared_ptr<Camera> mCamera;
 };
@@ -1,29 +1,38 @@
 #pragma once
 
+#include <vector>
+
 #include <vulkan/vulkan.hpp>
 
+#include "MemoryAllocator.h"
+
 class Device;
 
 class Buffer {
 public:
+  // queueFamilyIndices: the distinct families accessing the buffer concurrently without ownership
+  // transfers, the buffer being exclusive to one family at a time if fewer than two
   Buffer(const std::shared_ptr<Device> &device, VkBufferUsageFlags usage,
-         VkMemoryPropertyFlags properties, VkDeviceSize size, void *data = nullptr);
+         VkMemoryPropertyFlags properties, VkDeviceSize size, void *data = nullptr,
+         MemoryLifetime               lifetime           = MemoryLifetime::LONG_LIVED,
+         const std::vector<uint32_t> &queueFamilyIndices = {});
   virtual ~Buffer();
 
   [[nodiscard]] const VkBuffer     &getHandle() const { return mHandle; }
   [[nodiscard]] const VkDeviceSize &getSize() const { return mSize; }
+  // The persistently mapped memory of the buffer, null if not host visible
+  [[nodiscard]] void *getMapped() const { return mAllocation.mapped; }
   /**
-   * @brief Copies from a buffer
-   * @param src The buffer to copy from
-   * @param queue The queue to submit the copy command to
-   * @param region The amount to copy, if null copies the entire buffer
+   * @brief Writes to a host visible buffer
+   * @param data The data to write
+   * @param size The size of the data
+   * @param offset The offset within the buffer to write to
    */
-  void copy(const std::shared_ptr<Buffer> &src, VkQueue queue, VkBufferCopy *region = nullptr);
-  void copy(void *data, size_t size);
+  void copy(const void *data, size_t size, VkDeviceSize offset = 0);
 
 private:
   const std::shared_ptr<Device> &mDevice;
   VkBuffer                       mHandle = VK_NULL_HANDLE;
-  VkDeviceMemory                 mMemory = VK_NULL_HANDLE;
+  MemoryAllocation               mAllocation;
   VkDeviceSize                   mSize;
 };
@@ -6,7 +6,8 @@ class Device;
 
 class DescriptorPool {
 public:
-  DescriptorPool(const std::shared_ptr<Device> &device, uint32_t descriptorCount, uint32_t maxSets);
+  DescriptorPool(const std::shared_ptr<Device> &device, VkDescriptorType type,
+                 uint32_t descriptorCount, uint32_t maxSets);
   ~DescriptorPool();
 
   [[nodiscard]] const VkDescriptorPool &getHandle() const { return mHandle; }
@@ -10,7 +10,13 @@ public:
   DescriptorSet(const std::shared_ptr<Device> &device, const std::shared_ptr<DescriptorPool> &pool,
                 uint32_t                                  descriptorSetCount,
                 const std::vector<VkDescriptorSetLayout> &descriptorSetLayouts,
-                const VkDescriptorBufferInfo             &bufferInfo);
+                VkDescriptorType type, const VkDescriptorBufferInfo &bufferInfo);
+  // Writes one buffer per binding, numbered from 0
+  DescriptorSet(const std::shared_ptr<Device> &device, const std::shared_ptr<DescriptorPool> &pool,
+                uint32_t                                   descriptorSetCount,
+                const std::vector<VkDescriptorSetLayout>  &descriptorSetLayouts,
+                const std::vector<VkDescriptorType>       &types,
+                const std::vector<VkDescriptorBufferInfo> &bufferInfos);
 
   [[nodiscard]] const VkDescriptorSet &getHandle() const { return mHandle; }
 
@@ -6,7 +6,20 @@ class Device;
 
 class DescriptorSetLayout {
 public:
-  explicit DescriptorSetLayout(const std::shared_ptr<Device> &device);
+  /**
+   * @brief Creates a layout with a single buffer binding for the vertex shader
+   * @param device The device
+   * @param type The type of the buffer descriptor, e.g. VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
+   */
+  DescriptorSetLayout(const std::shared_ptr<Device> &device, VkDescriptorType type);
+  /**
+   * @brief Creates a layout with one descriptor per binding
+   * @param device The device
+   * @param types The type of the descriptor of each binding, numbered from 0
+   * @param stages The shader stages accessing every binding
+   */
+  DescriptorSetLayout(const std::shared_ptr<Device>       &device,
+                      const std::vector<VkDescriptorType> &types, VkShaderStageFlags stages);
   ~DescriptorSetLayout();
 
   const VkDescriptorSetLayout &getHandle() const { return mHandle; }
@@ -4,10 +4,14 @@
 
 #include "Buffer.h"
 #include "CommandPool.h"
+#include "MemoryAllocator.h"
 #include "PhysicalDevice.h"
+#include "PipelineCache.h"
+#include "Queue.h"
+#include "ShaderLibrary.h"
+#include "UploadBatcher.h"
 
 class Surface;
-class Queue;
 
 class Device {
 public:
@@ -17,6 +21,7 @@ public:
     uint32_t transfer;
   };
 
+  // surface: may be null for headless rendering, where no queue needs to support presenting
   Device(const std::shared_ptr<PhysicalDevice> &physicalDevice,
          const std::shared_ptr<Surface>        &surface);
   ~Device();
@@ -28,8 +33,30 @@ public:
   [[nodiscard]] const QueueFamilyIndices &getQueueFamilyIndices() const {
     return mQueueFamilyIndices;
   }
-  [[nodiscard]] const VkQueue &getGraphicsQueue() const { return mGraphicsQueue; }
-  [[nodiscard]] VkResult       waitIdle() const { return vkDeviceWaitIdle(mHandle); }
+  [[nodiscard]] const Queue &getGraphicsQueue() const { return *mGraphicsQueue; }
+  // The graphics queue when there is no dedicated compute queue
+  [[nodiscard]] const Queue &getComputeQueue() const { return *mComputeQueue; }
+  // The graphics queue when there is no dedicated transfer queue, possibly the compute queue
+  [[nodiscard]] const Queue     &getTransferQueue() const { return *mTransferQueue; }
+  [[nodiscard]] VkResult         waitIdle() const { return vkDeviceWaitIdle(mHandle); }
+  [[nodiscard]] MemoryAllocator &getMemoryAllocator() const { return *mMemoryAllocator; }
+  [[nodiscard]] UploadBatcher   &getUploadBatcher() const { return *mUploadBatcher; }
+  // The batcher of the transfer queue for static data, e.g. geometry, which may be used once it
+  // is available. The upload batcher when there is no dedicated transfer queue.
+  [[nodiscard]] UploadBatcher &getStreamingBatcher() const {
+    return mStreamingBatcher ? *mStreamingBatcher : *mUploadBatcher;
+  }
+  [[nodiscard]] PipelineCache &getPipelineCache() const { return *mPipelineCache; }
+  [[nodiscard]] ShaderLibrary &getShaderLibrary() const { return *mShaderLibrary; }
+  [[nodiscard]] bool           hasDedicatedComputeQueue() const {
+    return mQueueFamilyIndices.compute != mQueueFamilyIndices.graphics;
+  }
+  [[nodiscard]] bool hasDedicatedTransferQueue() const {
+    return mQueueFamilyIndices.transfer != mQueueFamilyIndices.graphics;
+  }
+  // Whether vkCmdDrawIndexedIndirectCount can be used, with a non-zero first instance
+  [[nodiscard]] bool supportsDrawIndirectCount() const { return mSupportsDrawIndirectCount; }
+  [[nodiscard]] bool supportsPipelineStatistics() const { return mSupportsPipelineStatistics; }
 
   /**
    * @brief Requests a command buffer from the device's command pool
@@ -46,7 +73,7 @@ public:
    * @param free Whether the command buffer should be implicitly freed up
    * @param signalSemaphore An optional semaphore to signal when the commands have been executed
    */
-  void flushCommandBuffer(VkCommandBuffer commandBuffer, VkQueue queue, bool free = true,
+  void flushCommandBuffer(VkCommandBuffer commandBuffer, const Queue &queue, bool free = true,
                           VkSemaphore signalSemaphore = VK_NULL_HANDLE);
 
 private:
@@ -56,8 +83,23 @@ private:
   std::vector<VkQueueFamilyProperties>   mQueueFamilyProperties;
   std::vector<std::string>               mSupportedExtensions;
   QueueFamilyIndices                     mQueueFamilyIndices;
-  VkDevice                               mHandle        = VK_NULL_HANDLE;
-  VkQueue                                mGraphicsQueue = VK_NULL_HANDLE;
+  VkDevice                               mHandle                     = VK_NULL_HANDLE;
+  bool                                   mSupportsDrawIndirectCount  = false;
+  bool                                   mSupportsPipelineStatistics = false;
+  // Shared by the roles without a queue of their own
+  std::shared_ptr<Queue> mGraphicsQueue;
+  std::shared_ptr<Queue> mComputeQueue;
+  std::shared_ptr<Queue> mTransferQueue;
   // A command pool associated to the primary queue
   std::unique_ptr<CommandPool> mCommandPool;
+  // Sub-allocates the device memory of every buffer and image
+  std::unique_ptr<MemoryAllocator> mMemoryAllocator;
+  // Batches the uploads to device local memory, submitted to the graphics queue
+  std::unique_ptr<UploadBatcher> mUploadBatcher;
+  // Streams static data through the dedicated transfer queue, if any
+  std::unique_ptr<UploadBatcher> mStreamingBatcher;
+  // Every pipeline is created through it, persisted across launches
+  std::unique_ptr<PipelineCache> mPipelineCache;
+  // Shader modules shared by every pipeline
+  std::unique_ptr<ShaderLibrary> mShaderLibrary;
 };
@@ -1,10 +1,32 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
 namespace filesystem {
 
+// A read-only view of a whole file mapped into memory, pages are only read once touched
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &filename);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &)            = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  [[nodiscard]] const uint8_t *data() const { return mData; }
+  [[nodiscard]] size_t         size() const { return mSize; }
+
+private:
+  const uint8_t *mData = nullptr;
+  size_t         mSize = 0;
+#ifdef _WIN32
+  void *mFile    = nullptr;
+  void *mMapping = nullptr;
+#endif
+};
+
 std::vector<uint8_t> read(const std::string &filename);
 
 /**
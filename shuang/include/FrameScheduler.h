@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+class Device;
+
+// Paces the CPU against the GPU with a fixed number of frames in flight, independent from the
+// swapchain image count. Recording frame N+1 only waits for the GPU to retire frame
+// N+1-framesInFlight, so it overlaps with the execution of frame N.
+class FrameScheduler {
+public:
+  struct Frame {
+    VkCommandPool   primaryCommandPool   = VK_NULL_HANDLE;
+    VkCommandBuffer primaryCommandBuffer = VK_NULL_HANDLE;
+    VkFence         queueSubmittedFence  = VK_NULL_HANDLE;
+    VkSemaphore     acquiredSemaphore    = VK_NULL_HANDLE;
+    // Signaled when the queue finished executing the commands in the buffer
+    VkSemaphore releasedSemaphore = VK_NULL_HANDLE;
+    // One secondary command buffer per recording thread, each from a pool of its own, so that
+    // threads record without synchronizing
+    std::vector<VkCommandPool>   secondaryCommandPools;
+    std::vector<VkCommandBuffer> secondaryCommandBuffers;
+    // Work of the frame submitted to the compute queue, when the device has a dedicated one. The
+    // compute semaphore is signaled once it has been executed, the upload semaphore by the
+    // graphics queue once the uploads it reads have been.
+    VkCommandPool   computeCommandPool   = VK_NULL_HANDLE;
+    VkCommandBuffer computeCommandBuffer = VK_NULL_HANDLE;
+    VkSemaphore     computeSemaphore     = VK_NULL_HANDLE;
+    VkSemaphore     uploadSemaphore      = VK_NULL_HANDLE;
+  };
+
+  /**
+   * @brief Creates the command buffers and synchronization objects of the frames
+   * @param device The device
+   * @param framesInFlight The number of frames the CPU may record ahead of the GPU
+   * @param recordingThreadCount The number of secondary command buffers of each frame
+   */
+  FrameScheduler(const std::shared_ptr<Device> &device, uint32_t framesInFlight,
+                 uint32_t recordingThreadCount = 1);
+  ~FrameScheduler();
+
+  [[nodiscard]] uint32_t getFramesInFlight() const { return mFrames.size(); }
+  [[nodiscard]] uint32_t getFrameIndex() const { return mFrameIndex; }
+  [[nodiscard]] Frame   &getFrame() { return mFrames[mFrameIndex]; }
+  // Time the CPU waited for the GPU in the last beginFrame
+  [[nodiscard]] double   getWaitMilliseconds() const { return mWaitMilliseconds; }
+
+  /**
+   * @brief Waits until the GPU retired the commands last submitted with the current frame, then
+   * recycles its command pools
+   * @returns The current frame
+   */
+  Frame &beginFrame();
+
+  /**
+   * @brief Moves on to the next frame, to be called once the current one has been submitted
+   */
+  void endFrame();
+
+  /**
+   * @brief Ties an acquired swapchain image to the current frame. If there are more frames in
+   * flight than swapchain images, waits for the frame still rendering into the same image.
+   * @param imageIndex The index of the acquired swapchain image
+   */
+  void bindImage(uint32_t imageIndex);
+
+  // Forgets which frames rendered into which images, e.g. after recreating the swapchain
+  void resetImages(uint32_t imageCount);
+
+private:
+  void initFrame(Frame &frame, uint32_t recordingThreadCount);
+
+  const std::shared_ptr<Device> &mDevice;
+  std::vector<Frame>             mFrames;
+  uint32_t                       mFrameIndex       = 0;
+  double                         mWaitMilliseconds = 0.0;
+  // The fence of the frame which last rendered into each swapchain image
+  std::vector<VkFence> mImageFences;
+};
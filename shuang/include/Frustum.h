@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Camera.h"
+
+// The six planes of a view frustum, against which bounding spheres are tested several at a time:
+// 8 with AVX, 4 with SSE2 and one otherwise, depending on the target of the build
+class Frustum {
+public:
+  // Extracts the planes of the projection and view matrices of the camera
+  explicit Frustum(const Camera &camera);
+  // Extracts the planes of a projection matrix with a [0, 1] depth range, times the view matrix
+  explicit Frustum(const glm::mat4 &viewProjection);
+
+  /**
+   * @brief Tests bounding spheres stored as structure of arrays against the frustum
+   * @param x The x coordinates of the centers
+   * @param y The y coordinates of the centers
+   * @param z The z coordinates of the centers
+   * @param radius The radii, spheres of negative infinite radius are never visible
+   * @param count The number of spheres
+   * @param visible Set to whether each sphere intersects the frustum
+   * @returns The number of visible spheres
+   */
+  uint32_t cullSpheres(const float *x, const float *y, const float *z, const float *radius,
+                       size_t count, uint8_t *visible) const;
+
+  // The normalized plane of index i, e.g. to cull on the GPU
+  [[nodiscard]] glm::vec4 getPlane(int i) const { return {mA[i], mB[i], mC[i], mD[i]}; }
+
+private:
+  // Normalized planes (a, b, c, d) as structure of arrays, dot(abc, p) + d >= 0 inside
+  float mA[6];
+  float mB[6];
+  float mC[6];
+  float mD[6];
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+class Device;
+
+// Measures the GPU time of named scopes of the frames with timestamp queries, and optionally
+// counts the primitives and shader invocations within them with pipeline statistics queries.
+// Each frame in flight has query pools of its own, read back when the frame is begun again, once
+// the GPU is done with it, so that the CPU never waits for the results.
+class GpuProfiler {
+public:
+  // Pipeline statistics of a scope
+  struct Statistics {
+    uint64_t inputAssemblyPrimitives;
+    uint64_t vertexShaderInvocations;
+    uint64_t clippingPrimitives;
+    uint64_t fragmentShaderInvocations;
+  };
+
+  struct Result {
+    std::string name;
+    double      milliseconds;
+    bool        hasStatistics;
+    Statistics  statistics;
+  };
+
+  /**
+   * @brief Creates the query pools of the frames
+   * @param device The device, whose graphics queue must support timestamps
+   * @param framesInFlight The number of frames in flight
+   * @param maxScopeCount The number of scopes a frame may have
+   */
+  GpuProfiler(const std::shared_ptr<Device> &device, uint32_t framesInFlight,
+              uint32_t maxScopeCount = 64);
+  ~GpuProfiler();
+
+  /**
+   * @brief Reads back the results of the previous use of a frame, and resets its queries
+   * @param commandBuffer The first command buffer of the frame, outside of a render pass
+   * @param frameIndex The index of the frame in flight, which the GPU must be done with
+   */
+  void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+  /**
+   * @brief Begins a scope of the current frame, from any thread
+   * @param commandBuffer The command buffer, primary or secondary
+   * @param name The name of the scope
+   * @param statistics Whether to count the primitives and invocations of the draws of the scope,
+   * which must then begin and end within a single subpass, without overlapping another such scope
+   * @returns The scope, to be ended in the same command buffer, or UINT32_MAX if there are too many
+   */
+  uint32_t beginScope(VkCommandBuffer commandBuffer, std::string name, bool statistics = false);
+  void     endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+  // The results of the latest frame read back, in the order its scopes began
+  [[nodiscard]] const std::vector<Result> &getResults() const { return mResults; }
+  // GPU time of the latest frame read back, from its first scope beginning to its last one ending
+  [[nodiscard]] double getFrameMilliseconds() const { return mFrameMilliseconds; }
+
+private:
+  struct Scope {
+    std::string name;
+    bool        statistics;
+  };
+  struct Frame {
+    VkQueryPool           timestampPool  = VK_NULL_HANDLE;
+    VkQueryPool           statisticsPool = VK_NULL_HANDLE;
+    std::vector<Scope>    scopes;
+    std::atomic<uint32_t> scopeCount{0};
+  };
+
+  const std::shared_ptr<Device>       mDevice;
+  uint32_t                            mMaxScopeCount;
+  bool                                mSupportsStatistics;
+  double                              mTimestampPeriod;
+  uint64_t                            mTimestampMask;
+  std::vector<std::unique_ptr<Frame>> mFrames;
+  Frame                              *mFrame = nullptr;
+  std::vector<Result>                 mResults;
+  double                              mFrameMilliseconds = 0.0;
+};
@@ -1,3 +1,26 @@
 #pragma once
 
-class Image {};
+#include <vulkan/vulkan.hpp>
+
+#include "MemoryAllocator.h"
+
+class Device;
+
+class Image {
+public:
+  Image(const std::shared_ptr<Device> &device, VkFormat format, const VkExtent2D &extent,
+        VkImageUsageFlags     usage,
+        VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  ~Image();
+
+  [[nodiscard]] const VkImage    &getHandle() const { return mHandle; }
+  [[nodiscard]] const VkFormat   &getFormat() const { return mFormat; }
+  [[nodiscard]] const VkExtent2D &getExtent() const { return mExtent; }
+
+private:
+  const std::shared_ptr<Device> &mDevice;
+  VkImage                        mHandle = VK_NULL_HANDLE;
+  MemoryAllocation               mAllocation;
+  VkFormat                       mFormat;
+  VkExtent2D                     mExtent;
+};
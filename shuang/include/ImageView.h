@@ -1,3 +1,19 @@
 #pragma once
 
-class ImageView {};
+#include <vulkan/vulkan.hpp>
+
+class Device;
+class Image;
+
+class ImageView {
+public:
+  ImageView(const std::shared_ptr<Device> &device, const Image &image,
+            VkImageAspectFlags aspectMask);
+  ~ImageView();
+
+  [[nodiscard]] const VkImageView &getHandle() const { return mHandle; }
+
+private:
+  const std::shared_ptr<Device> &mDevice;
+  VkImageView                    mHandle = VK_NULL_HANDLE;
+};
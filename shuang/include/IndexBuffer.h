@@ -1,15 +1,47 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
 #include "Buffer.h"
 
+// Largest number of vertices addressable by 16 bit indices, 0xFFFF being the restart index
+#define MAX_SHORT_INDEXED_VERTEX_COUNT 0xFFFF
+// Separates the strips of an index buffer, truncated to the one of 16 bit indices when encoded
+#define PRIMITIVE_RESTART_INDEX 0xFFFFFFFFu
+
+// A range of an index buffer drawn with a single call, whose indices are relative to vertexOffset
+// and address vertexCount vertices from it
+struct IndexRange {
+  uint32_t firstIndex;
+  uint32_t indexCount;
+  int32_t  vertexOffset;
+  uint32_t vertexCount;
+};
+
 class IndexBuffer : public Buffer {
 public:
+  // Creates a buffer of indexCount indices of the given type
   IndexBuffer(const std::shared_ptr<Device> &device, VkBufferUsageFlags usage,
-              VkMemoryPropertyFlags properties, uint32_t indexCount, VkDeviceSize size,
-              void *data = nullptr);
+              VkMemoryPropertyFlags properties, uint32_t indexCount,
+              VkIndexType indexType = VK_INDEX_TYPE_UINT32, void *data = nullptr);
+
+  // 16 bit indices for ranges addressing at most MAX_SHORT_INDEXED_VERTEX_COUNT vertices, 32 bit
+  // ones otherwise
+  static VkIndexType selectIndexType(uint32_t vertexCount);
+  // The index type of the largest range
+  static VkIndexType selectIndexType(const std::vector<IndexRange> &ranges);
+  // The size of an index of the type
+  static uint32_t getIndexSize(VkIndexType indexType);
+  // Encodes 32 bit indices into the type, e.g. straight into staging memory, writing count *
+  // getIndexSize(indexType) bytes to dst
+  static void encode(const uint32_t *indices, size_t count, VkIndexType indexType, void *dst);
 
-  [[nodiscard]] uint32_t getIndexCount() const { return mIndexCount; }
+  [[nodiscard]] uint32_t    getIndexCount() const { return mIndexCount; }
+  [[nodiscard]] VkIndexType getIndexType() const { return mIndexType; }
 
 private:
-  uint32_t mIndexCount;
+  uint32_t    mIndexCount;
+  VkIndexType mIndexType;
 };
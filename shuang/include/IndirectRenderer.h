@@ -0,0 +1,142 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Buffer.h"
+#include "DescriptorPool.h"
+#include "DescriptorSet.h"
+#include "DescriptorSetLayout.h"
+
+class Device;
+class Frustum;
+class LodSelector;
+class Model;
+
+// GPU driven rendering of many objects: their transforms live in a storage buffer, a compute
+// shader culls them against the frustum and writes the indirect commands of the visible ones,
+// compacted per index range of their model, and each range is drawn with a single
+// vkCmdDrawIndexedIndirectCount. The CPU only does work for the objects added or moved, and per
+// range when drawing.
+//
+// Each object is drawn at a single level of detail of its model, picked by the culling as the
+// LodSelector does, hysteresis included, and kept with the object for the next frame. Levels
+// switch at once though, without the cross-fade of the scene, which would take two commands per
+// range of every object fading.
+//
+// Each frame in flight has commands of its own, so that the culling of a frame may run on the
+// compute queue while the previous one is still drawn. The buffers are shared by the graphics and
+// compute families when they differ.
+class IndirectRenderer {
+public:
+  /**
+   * @brief Creates the buffers of the objects and of their commands
+   * @param device The device, which must support draw indirect count
+   * @param maxObjectCount The number of objects the buffers have room for
+   * @param maxDrawCount The number of index ranges of distinct models the buffers have room for
+   * @param maxCommandCount The number of commands the buffers have room for, an object taking
+   * one per index range of its model, those of every level of detail included
+   * @param frameCount The number of frames in flight
+   */
+  IndirectRenderer(const std::shared_ptr<Device> &device, uint32_t maxObjectCount,
+                   uint32_t maxDrawCount, uint32_t maxCommandCount, uint32_t frameCount = 1);
+  ~IndirectRenderer();
+
+  /**
+   * @brief Adds an object, uploaded by the next update
+   * @param model The model of the object, which must outlive the renderer, and whose vertex
+   * format must be the one of the pipeline drawing the objects
+   * @param transform The model matrix of the object
+   * @param color Multiplies the vertex colors
+   * @returns The index of the object
+   */
+  uint32_t addObject(const Model &model, const glm::mat4 &transform,
+                     const glm::vec4 &color = glm::vec4(1.0f));
+  // Moves an object, uploaded by the next update
+  void setTransform(uint32_t object, const glm::mat4 &transform);
+
+  // Records the uploads of the objects added or moved since the last update into the upload
+  // batcher, to be flushed before the next frame is submitted. Returns whether there were any.
+  bool update();
+
+  // Records the culling of the objects of a frame and the selection of their levels of detail,
+  // outside of a render pass, on a graphics or compute queue
+  void cull(VkCommandBuffer commandBuffer, const Frustum &frustum, const LodSelector &lodSelector,
+            uint32_t frameIndex);
+  // Records the draws of the objects of a frame found visible, with a bound graphics pipeline of
+  // the given layout, whose set 1 is the object set. The dequantization of each model is pushed to
+  // the vertex stage at offset 0, and a level of detail fade of 1 to the fragment stage after it.
+  // The topology of the pipeline must be the one of the models.
+  void draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t frameIndex);
+
+  // The layout of the object set read by the vertex shader, a storage buffer at binding 0
+  [[nodiscard]] const VkDescriptorSetLayout &getObjectSetLayout() const {
+    return mObjectSetLayout->getHandle();
+  }
+  [[nodiscard]] const VkDescriptorSet &getObjectSet() const { return mObjectSet->getHandle(); }
+  [[nodiscard]] uint32_t               getObjectCount() const { return mObjectCount; }
+
+private:
+  // Layout of the Object struct of the shaders, padded as std430
+  struct ObjectData {
+    glm::mat4 transform;
+    glm::vec4 color;
+    uint32_t  drawIndex;
+    // Level of detail of the last frame the object was visible in, written by the culling
+    uint32_t lod;
+    uint32_t padding[2];
+  };
+  // Layout of the Draw struct of the shaders, padded as std430
+  struct DrawData {
+    glm::vec4 boundingSphere;
+    uint32_t  indexCount;
+    uint32_t  firstIndex;
+    uint32_t  commandOffset;
+    int32_t   vertexOffset;
+    uint32_t  rangeCount;
+    uint32_t  lodCount;
+    float     lodError;
+    uint32_t  padding;
+  };
+  // An index range of a model
+  struct Draw {
+    const Model *model;
+    uint32_t     range;
+  };
+
+  void setupPipeline();
+
+  const std::shared_ptr<Device> mDevice;
+  uint32_t                      mMaxObjectCount;
+  uint32_t                      mMaxDrawCount;
+  uint32_t                      mMaxCommandCount;
+  uint32_t                      mObjectCount  = 0;
+  uint32_t                      mCommandCount = 0;
+
+  // The ranges drawn, the ones of a model being consecutive from its index in mDrawIndices, and
+  // the objects of draw i being counted by mDrawObjectCounts[i]
+  std::vector<Draw>                           mDraws;
+  std::vector<uint32_t>                       mDrawObjectCounts;
+  std::unordered_map<const Model *, uint32_t> mDrawIndices;
+  // Pending uploads: the objects from index mObjectCount - mNewObjects.size(), and moves
+  std::vector<ObjectData>                     mNewObjects;
+  std::vector<std::pair<uint32_t, glm::mat4>> mMoves;
+  bool                                        mDrawsChanged = false;
+
+  std::unique_ptr<Buffer> mObjectBuffer;
+  std::unique_ptr<Buffer> mDrawBuffer;
+  // Per frame in flight
+  std::vector<std::unique_ptr<Buffer>> mDrawCommandBuffers;
+  std::vector<std::unique_ptr<Buffer>> mDrawCountBuffers;
+
+  std::shared_ptr<DescriptorPool>             mDescriptorPool;
+  std::unique_ptr<DescriptorSetLayout>        mCullSetLayout;
+  std::unique_ptr<DescriptorSetLayout>        mObjectSetLayout;
+  std::vector<std::unique_ptr<DescriptorSet>> mCullSets;
+  std::unique_ptr<DescriptorSet>              mObjectSet;
+  VkPipelineLayout                            mPipelineLayout = VK_NULL_HANDLE;
+  VkPipeline                                  mPipeline       = VK_NULL_HANDLE;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "UploadBatcher.h"
+#include "VertexBuffer.h"
+
+class Model;
+
+// Attributes of an instance, read through the instance rate vertex binding
+struct InstanceData {
+  // Relative to the model matrix of the draw
+  glm::mat4 transform;
+  // Multiplies the vertex colors
+  glm::vec4 color;
+};
+
+// Device local per-instance vertex buffer, to draw many copies of a model with a single call
+class InstanceBuffer : public VertexBuffer {
+public:
+  InstanceBuffer(const std::shared_ptr<Device> &device, const std::vector<InstanceData> &instances);
+
+  // The token of the streaming batch uploading the instances, which can be drawn once available
+  [[nodiscard]] UploadBatcher::Token getUploadToken() const { return mUploadToken; }
+
+  /**
+   * @brief Bounds every instance of a model with a sphere
+   * @param model The model drawn with the instances
+   * @param center The center of the sphere, in the space of the model matrix
+   * @param radius The radius of the sphere
+   */
+  void getBoundingSphere(const Model &model, glm::vec3 &center, float &radius) const;
+
+private:
+  UploadBatcher::Token mUploadToken = 0;
+  // Bounds of the origins of the instances, and the largest scale of their axes
+  glm::vec3 mOriginMin{0.0f};
+  glm::vec3 mOriginMax{0.0f};
+  float     mMaxScale = 0.0f;
+};
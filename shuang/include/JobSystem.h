@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs jobs on a pool of worker threads. Each worker owns a Chase-Lev deque: it pushes and pops
+// its own jobs at the bottom, without locking, while idle workers steal from the top of the
+// others. The thread which created the system owns a deque as well, and helps run jobs while it
+// waits. Other threads hand their jobs over through a locked queue.
+class JobSystem {
+public:
+  using Job = std::function<void()>;
+
+  // Counts the unfinished jobs of a group, to wait for them or to run jobs once they are done.
+  // Must be waited for before being destroyed.
+  class Counter {
+  public:
+    [[nodiscard]] bool isDone() const { return mValue.load(std::memory_order_acquire) == 0; }
+
+  private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> mValue{0};
+    // Jobs to run once the value drops to zero
+    std::mutex                             mMutex;
+    std::vector<std::pair<Job, Counter *>> mDependents;
+  };
+
+  /**
+   * @brief Starts the workers, the calling thread being the main thread of the system
+   * @param workerCount The number of worker threads, besides the main thread
+   */
+  explicit JobSystem(uint32_t workerCount);
+  // Waits for the queued jobs to finish, then joins the workers
+  ~JobSystem();
+
+  // The system shared by the engine, with a worker per hardware thread besides the thread which
+  // first calls it
+  static JobSystem &getInstance();
+
+  /**
+   * @brief Queues a job
+   * @param job The job, which must not throw
+   * @param counter Incremented now and decremented once the job is done, if any
+   * @param dependency The job is only queued once this counter is done, if any
+   */
+  void run(Job job, Counter *counter = nullptr, Counter *dependency = nullptr);
+
+  /**
+   * @brief Queues a job to run on the main thread, the next time it runs its jobs
+   * @param job The job, which must not throw
+   * @param counter Incremented now and decremented once the job is done, if any
+   */
+  void runOnMainThread(Job job, Counter *counter = nullptr);
+  // Runs the jobs queued for the main thread, to be called by the main thread, e.g. every frame
+  void runMainThreadJobs();
+
+  // Runs other jobs until the counter is done, the jobs queued for the main thread included when
+  // called from it
+  void wait(Counter &counter);
+
+  /**
+   * @brief Splits a range into jobs and waits for them, the calling thread included
+   * @param count The size of the range [0, count)
+   * @param grainSize The size of the ranges given to fn, the last one possibly smaller
+   * @param fn The function to call with each range [begin, end), which must not throw
+   */
+  void parallelFor(size_t count, size_t grainSize,
+                   const std::function<void(size_t begin, size_t end)> &fn);
+
+  // The number of threads running jobs, the main thread included
+  [[nodiscard]] uint32_t getThreadCount() const { return static_cast<uint32_t>(mDeques.size()); }
+
+private:
+  struct Task {
+    Job      job;
+    Counter *counter;
+  };
+
+  class Deque;
+
+  void  workerLoop(uint32_t index);
+  void  push(Task *task);
+  // Takes a job from the own deque of the calling thread, the shared queue or another deque
+  Task *take();
+  void  execute(Task *task);
+  void  finish(Counter &counter);
+
+  std::vector<std::unique_ptr<Deque>> mDeques;
+  std::vector<std::thread>            mWorkers;
+  std::thread::id                     mMainThreadId;
+
+  // Jobs of the threads without a deque, or which didn't fit in theirs
+  std::mutex          mSharedMutex;
+  std::vector<Task *> mSharedTasks;
+  std::atomic<bool>   mHasSharedTasks{false};
+
+  std::mutex          mMainThreadMutex;
+  std::vector<Task *> mMainThreadTasks;
+
+  // Idle workers sleep until a job is queued
+  std::atomic<int64_t>    mQueuedCount{0};
+  std::atomic<uint32_t>   mSleepingCount{0};
+  std::mutex              mSleepMutex;
+  std::condition_variable mSleepCondition;
+  std::atomic<bool>       mStopping{false};
+};
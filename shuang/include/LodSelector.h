@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+
+class Model;
+
+// Picks the levels of detail models are drawn at from their size on screen under the projection of
+// a camera: the coarsest level whose error, scaled as the bounding sphere projects, stays under
+// LOD_PIXEL_ERROR pixels. Spheres are measured from their point nearest to the camera, so that
+// instances spread across a sphere are never drawn coarser than they project. With hysteresis, a
+// coarser level must project LOD_HYSTERESIS under the threshold and the current one may project
+// as much over it, so that objects at the threshold don't switch back and forth, and levels fade
+// into each other over LOD_FADE_DURATION seconds rather than popping.
+class LodSelector {
+public:
+  // The level of detail of an object, fading in over previousLod until fade reaches 1
+  struct State {
+    uint32_t lod         = 0;
+    uint32_t previousLod = 0;
+    float    fade        = 1.0f;
+  };
+
+  LodSelector(const Camera &camera, float viewportHeight);
+
+  [[nodiscard]] const glm::vec3 &getCameraPosition() const { return mCameraPosition; }
+  // Size in pixels of a unit at a unit distance from the camera
+  [[nodiscard]] float getPixelScale() const { return mPixelScale; }
+
+  /**
+   * @brief Picks the level of detail of a model
+   * @param model The model
+   * @param center The center of the world bounding sphere
+   * @param radius The radius of the world bounding sphere
+   * @param scale The largest scale of the axes of the world transform
+   * @param currentLod The level the model is drawn at so far
+   * @returns The level to draw the model at
+   */
+  [[nodiscard]] uint32_t select(const Model &model, const glm::vec3 &center, float radius,
+                                float scale, uint32_t currentLod) const;
+  // Picks the level of an object unless it is fading, starting a fade when the level changes,
+  // and advances the fade by a time step in seconds
+  void update(State &state, const Model &model, const glm::vec3 &center, float radius, float scale,
+              float timeStep) const;
+
+private:
+  glm::vec3 mCameraPosition;
+  float     mPixelScale;
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+
+#include <vulkan/vulkan.hpp>
+
+#include "TlsfAllocator.h"
+
+class Device;
+struct MemoryBlock;
+
+enum class MemoryLifetime {
+  // Lives across frames, e.g. vertex, index and uniform buffers, render targets
+  LONG_LIVED,
+  // Freed shortly after being allocated, e.g. staging buffers
+  TRANSIENT,
+};
+
+struct MemoryAllocation {
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize   offset = 0;
+  VkDeviceSize   size   = 0;
+  // Points at offset within the persistently mapped block, null if not host visible
+  void *mapped = nullptr;
+
+  // Owned by the allocator
+  MemoryBlock          *block  = nullptr;
+  TlsfAllocator::Handle handle = TlsfAllocator::INVALID_HANDLE;
+};
+
+// Sub-allocates device memory out of large blocks per memory type, so that resources don't each
+// cost a vkAllocateMemory. Long-lived resources are placed with a TLSF allocator, transient ones
+// are bumped linearly into separate blocks which are rewound as soon as they are empty.
+class MemoryAllocator {
+public:
+  struct Statistics {
+    // Device memory allocated from the driver
+    uint32_t     blockCount = 0;
+    VkDeviceSize blockBytes = 0;
+    // Sub-allocations handed out of those blocks
+    uint32_t     allocationCount = 0;
+    VkDeviceSize allocationBytes = 0;
+  };
+
+  explicit MemoryAllocator(const Device &device);
+  ~MemoryAllocator();
+
+  /**
+   * @brief Allocates memory for a resource
+   * @param requirements The memory requirements of the resource
+   * @param properties The memory properties to search for
+   * @param lifetime How long the resource is expected to live
+   * @param optimalTiling Whether the resource is an optimally tiled image. Those are kept apart
+   * from linear resources, so that bufferImageGranularity never has to be accounted for.
+   */
+  MemoryAllocation allocate(const VkMemoryRequirements &requirements,
+                            VkMemoryPropertyFlags properties, MemoryLifetime lifetime,
+                            bool optimalTiling = false);
+  void             free(MemoryAllocation &allocation);
+
+  /**
+   * @brief Makes host writes visible to the device, only needed for non host coherent memory
+   * @param allocation The allocation written to
+   * @param offset The offset of the written range within the allocation
+   * @param size The size of the written range, VK_WHOLE_SIZE for the rest of the allocation
+   */
+  void flush(const MemoryAllocation &allocation, VkDeviceSize offset = 0,
+             VkDeviceSize size = VK_WHOLE_SIZE);
+
+  [[nodiscard]] Statistics getStatistics();
+
+private:
+  struct Pool {
+    std::vector<std::unique_ptr<MemoryBlock>> blocks;
+  };
+
+  [[nodiscard]] VkDeviceSize getBlockSize(uint32_t memoryType, MemoryLifetime lifetime) const;
+  std::unique_ptr<MemoryBlock> createBlock(uint32_t memoryType, VkDeviceSize size,
+                                           MemoryLifetime lifetime, uint32_t poolIndex);
+  void                         destroyBlock(MemoryBlock &block);
+  // Frees an empty block, unless it is the last empty one of its pool which is kept around to
+  // avoid thrashing the driver
+  void trim(MemoryBlock &emptyBlock);
+
+  const Device                             &mDevice;
+  std::vector<Pool>                         mPools;
+  std::vector<std::unique_ptr<MemoryBlock>> mDedicatedBlocks;
+  std::mutex                                mMutex;
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "FileSystem.h"
+#include "Vertex.h"
+#include "model/Mesh.h"
+
+// Versioned binary mesh container, laid out exactly as the GPU consumes it: a vertex stream in one
+// of the vertex formats, a 16 or 32 bit index stream, the index range table, the level of detail
+// table and the submesh table, each section starting on a page boundary. Loading is thus a copy
+// from the mapped file to staging memory, without any parsing or conversion. Files are little
+// endian.
+class MeshFile {
+public:
+  static constexpr uint32_t MAGIC   = 0x4853454d; // "MESH"
+  static constexpr uint32_t VERSION = 4;
+
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    // Size of a vertex, checked against the layout of the vertex format
+    uint32_t vertexSize;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t submeshCount;
+    // Offsets of the sections from the start of the file
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t submeshOffset;
+    // Bounds of the whole mesh
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    // Format of the vertex stream, and how its positions were quantized if packed
+    VertexFormat vertexFormat;
+    glm::vec3    positionOffset;
+    glm::vec3    positionScale;
+    // Size of an index, and the topology of the index stream
+    uint32_t            indexSize;
+    VkPrimitiveTopology topology;
+    uint32_t            rangeCount;
+    uint64_t            rangeOffset;
+    uint32_t            lodCount;
+    uint32_t            padding;
+    uint64_t            lodOffset;
+  };
+
+  // Maps a mesh file, throws if it isn't a well formed mesh file of this version
+  explicit MeshFile(const std::string &path);
+
+  [[nodiscard]] const Header  &getHeader() const { return mHeader; }
+  [[nodiscard]] const uint8_t *getVertices() const { return mFile.data() + mHeader.vertexOffset; }
+  [[nodiscard]] const uint8_t *getIndices() const { return mFile.data() + mHeader.indexOffset; }
+  // Sizes of the vertex and index streams in bytes
+  [[nodiscard]] VkDeviceSize getVertexStreamSize() const;
+  [[nodiscard]] VkDeviceSize getIndexStreamSize() const;
+
+  [[nodiscard]] VkIndexType             getIndexType() const;
+  [[nodiscard]] std::vector<IndexRange> getIndexRanges() const;
+  [[nodiscard]] std::vector<Lod>        getLods() const;
+  [[nodiscard]] std::vector<Submesh>    getSubmeshes() const;
+  [[nodiscard]] PositionDequantization  getDequantization() const;
+
+  /**
+   * @brief Writes a mesh file, replacing any previous file at once
+   * @param path The path to the file
+   * @param vertices The vertex stream, encoded into the given format
+   * @param vertexCount The number of vertices
+   * @param vertexFormat The format of the vertex stream
+   * @param dequantization How the positions of the vertex stream were quantized
+   * @param indices The index stream, encoded into the given type
+   * @param indexCount The number of indices
+   * @param indexType The type of the index stream
+   * @param topology The topology of the index stream
+   * @param ranges The ranges the index stream is drawn with
+   * @param lods The levels of detail, each drawn with consecutive ranges
+   * @param submeshes The submeshes, the bounds of the mesh being their union
+   */
+  static void write(const std::string &path, const void *vertices, uint32_t vertexCount,
+                    VertexFormat vertexFormat, const PositionDequantization &dequantization,
+                    const void *indices, uint32_t indexCount, VkIndexType indexType,
+                    VkPrimitiveTopology topology, const std::vector<IndexRange> &ranges,
+                    const std::vector<Lod> &lods, const std::vector<Submesh> &submeshes);
+
+private:
+  filesystem::MappedFile mFile;
+  Header                 mHeader{};
+};
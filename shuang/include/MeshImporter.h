@@ -0,0 +1,96 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <glm/glm.hpp>
+
+#include "Vertex.h"
+#include "model/Mesh.h"
+
+class Device;
+
+// Imports triangle meshes from OBJ and glTF 2.0 files (.gltf with embedded or external buffers,
+// and .glb). Files are memory mapped, and the geometry is generated in parallel straight into
+// staging memory, without any intermediate copy. Imported meshes can be converted to mesh files,
+// which load without any parsing.
+//
+// Indices are 16 bit for meshes of fewer than 65536 vertices. Larger ones are split into index
+// ranges of 16 bit indices when imported through memory, i.e. when packed, optimized, simplified,
+// converted to strips or to a mesh file, and keep 32 bit indices otherwise. Simplified levels of
+// detail are appended to the index buffer, each with as many ranges as the full level.
+class MeshImporter {
+public:
+  explicit MeshImporter(const std::shared_ptr<Device> &device);
+
+  /**
+   * @brief Imports a mesh, picking the format from the file extension
+   * @param path The path to the file, .obj, .gltf, .glb or .mesh for a MeshFile
+   * @param vertexFormat The format to encode the vertices into, mesh files keeping their own
+   * @param optimize Whether to run the MeshOptimizer over the geometry, mesh files being
+   * optimized when converted instead
+   * @param strips Whether to convert the triangle lists to strips, as for optimize
+   * @param lods Whether to generate levels of detail with the MeshSimplifier, as for optimize
+   * @returns The mesh, whose upload is recorded but not flushed
+   */
+  std::unique_ptr<Mesh> import(const std::string &path,
+                               VertexFormat       vertexFormat = VertexFormat::FLOAT,
+                               bool optimize = false, bool strips = false, bool lods = false);
+
+  /**
+   * @brief Imports an OBJ or glTF file into memory, and writes it as a mesh file
+   * @param path The path to the file to import
+   * @param meshFilePath The path to the mesh file to write
+   * @param vertexFormat The format to encode the vertices into
+   * @param optimize Whether to run the MeshOptimizer over the geometry
+   * @param strips Whether to convert the triangle lists to strips
+   * @param lods Whether to generate levels of detail with the MeshSimplifier
+   */
+  static void convert(const std::string &path, const std::string &meshFilePath,
+                      VertexFormat vertexFormat = VertexFormat::FLOAT, bool optimize = false,
+                      bool strips = false, bool lods = false);
+
+private:
+  enum class Stream { VERTEX, INDEX };
+
+  // Where the geometry is generated into, the buffers of a mesh or memory
+  class Target {
+  public:
+    virtual ~Target() = default;
+
+    virtual void create(uint32_t vertexCount, uint32_t indexCount) = 0;
+    // Fills consecutive ranges of a stream concurrently, as UploadBatcher::upload does, indices
+    // being written as 32 bit ones whatever the index type of the target
+    virtual void write(Stream stream, const std::vector<VkDeviceSize> &offsets,
+                       const std::function<void(size_t, void *)> &fill) = 0;
+    virtual void setSubmeshes(std::vector<Submesh> submeshes) = 0;
+  };
+  class MeshTarget;
+  class MemoryTarget;
+
+  // Imports an OBJ or glTF file depending on its extension
+  static void import(const std::string &path, Target &target);
+  // Only positions and vertex colors (the "v x y z r g b" extension) are imported, each position
+  // thus makes a vertex and faces index positions directly. Polygons are triangulated as fans, and
+  // the whole file makes one submesh.
+  static void importObj(const std::string &path, Target &target);
+  // Every triangle primitive of the default scene is merged into one mesh as a submesh,
+  // transformed by the world matrix of its node
+  static void importGltf(const std::string &path, Target &target);
+  // Optimizes geometry imported into memory if asked to, splits it into ranges of 16 bit indices
+  // if too large for them, then generates levels of detail and converts them to strips if asked to
+  static void prepare(MemoryTarget &target, bool optimize, bool strips, bool lods);
+  // Copies the streams of a mesh file to staging memory as they are
+  std::unique_ptr<Mesh> load(const std::string &path);
+  // Encodes geometry imported and prepared in memory into the vertex format and the index type
+  // while staging it. Packing needs the bounds of all the vertices before encoding any, and
+  // optimizing, splitting and stripping reorder all of them, thus none can be done while
+  // importing.
+  std::unique_ptr<Mesh> upload(const MemoryTarget &target, VertexFormat vertexFormat);
+
+  // Color of the vertices which don't have any, which stands out from the white clear color
+  static const glm::vec3 DEFAULT_COLOR;
+
+  const std::shared_ptr<Device> &mDevice;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Vertex.h"
+#include "model/Mesh.h"
+
+// Reorders indexed triangle lists for the GPU before they are uploaded: duplicate vertices are
+// welded, triangles are ordered for the post-transform vertex cache (Tipsify, Sander et al., "Fast
+// Triangle Reordering for Vertex Locality and Reduced Overdraw") and then by clusters for overdraw,
+// and vertices are ordered by first use for fetch locality. The image is left unchanged. Optimized
+// lists may then be split into ranges addressable by 16 bit indices, and converted to strips.
+class MeshOptimizer {
+public:
+  // Efficiency of a FIFO post-transform cache over an index buffer
+  struct Statistics {
+    // Average cache miss ratio, the vertices transformed per triangle, from 0.5 at best to 3
+    float acmr = 0.0f;
+    // Average transform to vertex ratio, the vertices transformed per vertex, from 1 at best
+    float atvr = 0.0f;
+  };
+
+  /**
+   * @brief Runs every step over a mesh, and logs the cache statistics before and after
+   * @param vertices The vertices, welded and reordered
+   * @param indices The triangle list, reordered and remapped
+   * @param submeshes The index ranges triangles stay within, the whole list if empty
+   */
+  static void optimize(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices,
+                       const std::vector<Submesh> &submeshes = {});
+
+  // Merges the vertices of identical attributes, keeping the first of each
+  static void weldVertices(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+  // Reorders the triangles of a range of a triangle list for the vertex cache
+  static void optimizeVertexCache(uint32_t *indices, size_t indexCount);
+  // Splits a range optimized for the vertex cache into clusters, which are sorted for the ones
+  // facing away from the center of the range to be drawn first, occluding the others
+  static void optimizeOverdraw(uint32_t *indices, size_t indexCount,
+                               const std::vector<Vertex> &vertices);
+  // Reorders the vertices by first use in the triangle list, dropping the unused ones
+  static void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+  /**
+   * @brief Splits a triangle list into ranges of at most maxVertexCount vertices, keeping the order
+   * of the triangles. The vertices of each range are copied after the ones of the previous range,
+   * those shared by ranges being duplicated, and the indices made relative to the range.
+   * @param vertices The vertices, laid out by range
+   * @param indices The triangle list, relative to the ranges
+   * @param maxVertexCount The number of vertices a range may address at most
+   * @returns The ranges, covering the whole list
+   */
+  static std::vector<IndexRange> splitIndexRanges(std::vector<Vertex>   &vertices,
+                                                  std::vector<uint32_t> &indices,
+                                                  uint32_t               maxVertexCount);
+  /**
+   * @brief Converts the triangle lists of ranges into strips ended by PRIMITIVE_RESTART_INDEX,
+   * each triangle keeping its winding
+   * @param indices The triangle lists, replaced by the strips
+   * @param ranges The ranges, which are remapped to their strips
+   * @param submeshes The submeshes, which are remapped as well, no strip crossing their bounds
+   */
+  static void generateStrips(std::vector<uint32_t> &indices, std::vector<IndexRange> &ranges,
+                             std::vector<Submesh> &submeshes);
+
+  // Simulates the vertex cache over a triangle list
+  static Statistics analyzeVertexCache(const uint32_t *indices, size_t indexCount,
+                                       size_t vertexCount);
+};
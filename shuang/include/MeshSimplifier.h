@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Vertex.h"
+#include "model/Model.h"
+
+// Simplifies indexed triangle lists by edge collapses ordered by quadric error (Garland and
+// Heckbert, "Surface Simplification Using Quadric Error Metrics"). Vertices collapse onto one of
+// their neighbors rather than onto new positions, so that every level of detail indexes the
+// vertices of the full one, and all of them share a single vertex buffer. Borders only collapse
+// along themselves, and vertices sharing their position with others, e.g. along the seams of
+// colors, stay in place.
+class MeshSimplifier {
+public:
+  /**
+   * @brief Simplifies a triangle list down to a number of indices, or as close to it as collapses
+   * allow without flipping triangles
+   * @param vertices The vertices the list indexes from 0
+   * @param vertexCount The number of vertices
+   * @param indices The triangle list
+   * @param indexCount The number of indices
+   * @param targetIndexCount The number of indices to simplify down to
+   * @param error Set to the error of the simplified surface, as a distance to the input, if not
+   * null
+   * @returns The simplified triangle list, indexing the same vertices
+   */
+  static std::vector<uint32_t> simplify(const Vertex *vertices, size_t vertexCount,
+                                        const uint32_t *indices, size_t indexCount,
+                                        size_t targetIndexCount, float *error = nullptr);
+
+  /**
+   * @brief Generates a chain of levels of detail, each about half of the previous one, until
+   * simplifying stops paying off. Every range is simplified on its own, thus each level has as
+   * many ranges as the full one, addressing the same vertices.
+   * @param vertices The vertices, which are left unchanged
+   * @param indices The triangle lists of the ranges, which the lists of the levels are appended to
+   * @param ranges The ranges of the full level, which the ranges of the levels are appended to
+   * @returns The levels of detail, the first being the full one
+   */
+  static std::vector<Lod> generateLods(const std::vector<Vertex> &vertices,
+                                       std::vector<uint32_t>     &indices,
+                                       std::vector<IndexRange>   &ranges);
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace parallel {
+
+/**
+ * @brief Runs a function over a range of indices across the threads of the job system, the calling
+ * thread included. Indices are handed out one at a time, so items should be coarse.
+ * @param count The number of indices
+ * @param fn The function to call with each index in [0, count)
+ * @throws The first exception thrown by fn, once every thread is done
+ */
+void forEach(size_t count, const std::function<void(size_t)> &fn);
+
+} // namespace parallel
@@ -16,7 +16,6 @@ public:
   [[nodiscard]] const VkPipelineLayout &getLayout() const { return mLayout; }
 
 private:
-  VkShaderModule createShaderModule(const char *path);
   static VkVertexInputBindingDescription
   createVertexInputBindingDescription(uint32_t binding, uint32_t stride,
                                       VkVertexInputRate inputRate);
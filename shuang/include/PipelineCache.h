@@ -0,0 +1,59 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+
+#include <vulkan/vulkan.hpp>
+
+class Device;
+
+// A VkPipelineCache persisted to disk across launches, so that pipelines are only compiled once
+// per driver. Also records how long each pipeline took to create, to measure the time it saves.
+class PipelineCache {
+public:
+  struct Record {
+    std::string name;
+    double      milliseconds = 0.0;
+  };
+
+  /**
+   * @brief Creates the cache, seeded with the content of the cache file if it was written by the
+   * same driver on the same device
+   * @param device The device
+   * @param path The path of the cache file, which doesn't have to exist
+   */
+  PipelineCache(const Device &device, std::string path);
+  // Writes the cache back to its file
+  ~PipelineCache();
+
+  [[nodiscard]] const VkPipelineCache &getHandle() const { return mHandle; }
+
+  /**
+   * @brief Creates a graphics pipeline through the cache, and records its creation time
+   * @param createInfo The description of the pipeline
+   * @param name The name of the pipeline in the records
+   * @returns The pipeline
+   */
+  VkPipeline createGraphicsPipeline(const VkGraphicsPipelineCreateInfo &createInfo,
+                                    const char                         *name);
+  // Same as createGraphicsPipeline, for a compute pipeline
+  VkPipeline createComputePipeline(const VkComputePipelineCreateInfo &createInfo, const char *name);
+
+  // Writes the cache to its file through a temporary one, so that a crash never leaves it torn
+  void save();
+
+  [[nodiscard]] std::vector<Record> getRecords();
+
+private:
+  // Whether the data starts with a header matching the physical device
+  [[nodiscard]] bool isCompatible(const std::vector<uint8_t> &data) const;
+  // Records the creation time of a pipeline, started at the given time
+  void record(const char *name, std::chrono::steady_clock::time_point startTime);
+
+  const Device       &mDevice;
+  std::string         mPath;
+  VkPipelineCache     mHandle = VK_NULL_HANDLE;
+  std::vector<Record> mRecords;
+  std::mutex          mMutex;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Records the CPU time of named scopes of the threads, and the beginning of the frames, to be
+// exported as a Chrome trace, viewed in chrome://tracing or Perfetto. Each thread records into a
+// buffer of its own without locking, which stops recording once full. Compiled out unless built
+// with SHUANG_PROFILING, the macros below expanding to nothing then.
+class Profiler {
+public:
+  // Records the time from its construction to its destruction under the name, a string literal
+  class Zone {
+  public:
+    explicit Zone(const char *name) : mName{name}, mBegin{now()} {}
+    ~Zone() { getInstance().record(mName, mBegin, now()); }
+
+    Zone(const Zone &)            = delete;
+    Zone &operator=(const Zone &) = delete;
+
+  private:
+    const char *mName;
+    int64_t     mBegin;
+  };
+
+  // The profiler shared by the threads, never destroyed so that they may record until they leave
+  static Profiler &getInstance();
+
+  // Nanoseconds since an arbitrary point, the same for all the threads
+  static int64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  void record(const char *name, int64_t begin, int64_t end);
+  // Marks the beginning of a frame, on the timeline of all the threads
+  void markFrame(uint64_t frameNumber);
+  // Names the calling thread in the trace
+  void setThreadName(std::string name);
+
+  /**
+   * @brief Writes what the threads have recorded so far as a Chrome trace, which they may keep on
+   * recording meanwhile
+   * @param path The path of the JSON file
+   */
+  void writeChromeTrace(const std::string &path);
+
+private:
+  struct Event {
+    const char *name;
+    int64_t     begin;
+    // The end of a zone, or the number of a frame whose name is null
+    int64_t     value;
+  };
+  // Written by its thread only, read by the others up to the count
+  struct ThreadBuffer {
+    uint32_t                 threadId;
+    std::string              name;
+    std::unique_ptr<Event[]> events;
+    std::atomic<uint32_t>    count{0};
+    std::atomic<uint32_t>    droppedCount{0};
+  };
+
+  Profiler() = default;
+
+  void          push(const Event &event);
+  ThreadBuffer &getThreadBuffer();
+
+  // Threads register their buffer on their first event
+  std::mutex                                 mMutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> mThreadBuffers;
+};
+
+#ifdef SHUANG_PROFILING
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// Records the rest of the enclosing block under the name, a string literal
+#define PROFILE_SCOPE(name) Profiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+#define PROFILE_FRAME(frameNumber) Profiler::getInstance().markFrame(frameNumber)
+#define PROFILE_THREAD(name) Profiler::getInstance().setThreadName(name)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_FRAME(frameNumber)
+#define PROFILE_THREAD(name)
+#endif
@@ -1,15 +1,60 @@
 #pragma once
 
+#include <mutex>
+#include <vector>
+
 #include <vulkan/vulkan.hpp>
 
+class Device;
+
+// A queue of the device. Submissions are serialized, so that several threads may submit to the
+// same queue, e.g. the uploads of a loading thread along the frames.
 class Queue {
 public:
-  bool                           isSupportPresent() const { return false; }
-  const VkQueueFamilyProperties &getProperties() const { return mProperties; }
+  // A semaphore to wait for before the given stages of the submitted commands
+  struct Wait {
+    VkSemaphore          semaphore;
+    VkPipelineStageFlags stageMask;
+  };
+
+  /**
+   * @brief Retrieves a queue created along with the device
+   * @param device The device
+   * @param familyIndex The family of the queue
+   * @param index The index of the queue within its family
+   * @param properties The properties of the family
+   * @param supportPresent Whether the queue can present to the surface of the device
+   */
+  Queue(const Device &device, uint32_t familyIndex, uint32_t index,
+        const VkQueueFamilyProperties &properties, bool supportPresent);
+
+  [[nodiscard]] const VkQueue                 &getHandle() const { return mHandle; }
+  [[nodiscard]] uint32_t                       getFamilyIndex() const { return mFamilyIndex; }
+  [[nodiscard]] const VkQueueFamilyProperties &getProperties() const { return mProperties; }
+  [[nodiscard]] bool                           isSupportPresent() const { return mSupportPresent; }
+
+  /**
+   * @brief Submits command buffers in a single batch
+   * @param commandBuffers The command buffers, possibly none to only wait and signal
+   * @param waits The semaphores to wait for
+   * @param signalSemaphores The semaphores to signal once the commands have been executed
+   * @param fence The fence to signal once the commands have been executed, if any
+   * @returns The result of vkQueueSubmit
+   */
+  VkResult submit(const std::vector<VkCommandBuffer> &commandBuffers,
+                  const std::vector<Wait>            &waits            = {},
+                  const std::vector<VkSemaphore>     &signalSemaphores = {},
+                  VkFence                             fence            = VK_NULL_HANDLE) const;
+
+  // Presents swapchain images, the queue must support presenting
+  VkResult present(const VkPresentInfoKHR &presentInfo) const;
 
-  VkResult waitIdle() const { return vkQueueWaitIdle(mHandle); }
+  VkResult waitIdle() const;
 
 private:
-  VkQueue                 mHandle;
+  VkQueue                 mHandle = VK_NULL_HANDLE;
+  uint32_t                mFamilyIndex;
   VkQueueFamilyProperties mProperties;
+  bool                    mSupportPresent;
+  mutable std::mutex      mMutex;
 };
@@ -6,7 +6,9 @@ class Device;
 
 class RenderPass {
 public:
-  RenderPass(const std::shared_ptr<Device> &device, VkFormat imageFormat, VkFormat depthFormat);
+  // finalLayout: the layout the color attachment is transitioned into when the render pass ends
+  RenderPass(const std::shared_ptr<Device> &device, VkFormat imageFormat, VkFormat depthFormat,
+             VkImageLayout finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
   ~RenderPass();
 
   [[nodiscard]] const VkRenderPass &getHandle() const { return mHandle; }
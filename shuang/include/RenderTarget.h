@@ -1,3 +1,33 @@
 #pragma once
 
-class RenderTarget {};
+#include <vulkan/vulkan.hpp>
+
+#include "Image.h"
+#include "ImageView.h"
+
+class Device;
+class RenderPass;
+
+// Device-local color and depth images rendered into offscreen, i.e. without any surface
+class RenderTarget {
+public:
+  RenderTarget(const std::shared_ptr<Device> &device, const VkExtent2D &extent,
+               VkFormat colorFormat, VkFormat depthFormat);
+  ~RenderTarget();
+
+  [[nodiscard]] const VkExtent2D    &getExtent() const { return mExtent; }
+  [[nodiscard]] const Image         &getColorImage() const { return *mColorImage; }
+  [[nodiscard]] const Image         &getDepthImage() const { return *mDepthImage; }
+  [[nodiscard]] const VkFramebuffer &getFramebuffer() const { return mFramebuffer; }
+
+  void createFramebuffer(const std::shared_ptr<RenderPass> &renderPass);
+
+private:
+  const std::shared_ptr<Device> &mDevice;
+  VkExtent2D                     mExtent;
+  std::unique_ptr<Image>         mColorImage;
+  std::unique_ptr<ImageView>     mColorImageView;
+  std::unique_ptr<Image>         mDepthImage;
+  std::unique_ptr<ImageView>     mDepthImageView;
+  VkFramebuffer                  mFramebuffer = VK_NULL_HANDLE;
+};
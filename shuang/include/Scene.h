@@ -1,3 +1,123 @@
 #pragma once
 
-class Scene {};
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "LodSelector.h"
+
+class Frustum;
+class InstanceBuffer;
+class Model;
+
+// Hierarchy of nodes with local and world transforms, stored as structure of arrays in breadth
+// first order: nodes are sorted by depth, and the children of consecutive nodes are consecutive.
+// Changing a local transform marks the node dirty, and update() only recomputes the world
+// transforms of the dirty subtrees, one level after the other with each level split across
+// threads. The world bounding spheres of the models are kept as structure of arrays as well, to be
+// culled several at a time, along with the level of detail each model is drawn at.
+class Scene {
+public:
+  // Identifies a node for the life of the scene, unlike its position in the arrays
+  using NodeId = uint32_t;
+
+  static constexpr NodeId INVALID_NODE = UINT32_MAX;
+
+  struct CullStatistics {
+    uint32_t visibleCount;
+    // Number of nodes with a model
+    uint32_t totalCount;
+  };
+
+  /**
+   * @brief Adds a node, whose world transform is computed by the next update
+   * @param parent The parent node, INVALID_NODE for a root
+   * @param localTransform The transform relative to the parent
+   * @param model The model drawn with the world transform of the node, if any, which must
+   * outlive the scene
+   * @param instances The instances the model is drawn with, if any, which must outlive the scene
+   * @returns The id of the node
+   */
+  NodeId addNode(NodeId parent, const glm::mat4 &localTransform, const Model *model = nullptr,
+                 const InstanceBuffer *instances = nullptr);
+
+  void setLocalTransform(NodeId node, const glm::mat4 &localTransform);
+
+  [[nodiscard]] const glm::mat4 &getLocalTransform(NodeId node) const;
+  // As of the last update
+  [[nodiscard]] const glm::mat4 &getWorldTransform(NodeId node) const;
+  [[nodiscard]] uint32_t         getNodeCount() const { return static_cast<uint32_t>(mIds.size()); }
+
+  // Recomputes the world transforms of the dirty nodes and their descendants
+  void update();
+
+  // Tests the bounding spheres of the models against a frustum, as of the last update
+  CullStatistics cull(const Frustum &frustum);
+  // Picks the levels of detail of the models from their bounding spheres as of the last update,
+  // and advances their fades by a time step in seconds
+  void updateLods(const LodSelector &selector, float timeStep);
+
+  // Calls fn with every model of the scene, its world transform and its instances or nullptr, in
+  // depth order
+  template <typename Fn> void forEachModel(Fn &&fn) const {
+    for (size_t i = 0; i < mModels.size(); ++i) {
+      if (mModels[i]) {
+        fn(*mModels[i], mWorldTransforms[i], mInstances[i]);
+      }
+    }
+  }
+
+  // Same as forEachModel, only for the models found visible by the last cull, along with their
+  // level of detail
+  template <typename Fn> void forEachVisibleModel(Fn &&fn) const {
+    for (size_t i = 0; i < mModels.size(); ++i) {
+      if (mVisible[i]) {
+        fn(*mModels[i], mWorldTransforms[i], mInstances[i], mLodStates[i]);
+      }
+    }
+  }
+
+private:
+  // A range of node indices
+  struct Range {
+    uint32_t begin;
+    uint32_t end;
+  };
+
+  // Sorts the nodes in breadth first order after nodes were added, leaving every root dirty
+  void sort();
+  // Computes the world transforms of the given nodes of a level
+  void updateLevel(const std::vector<Range> &ranges);
+  // Marks the node at the given index dirty
+  void markDirty(uint32_t index);
+
+  // Indexed by node index, the parent of roots being UINT32_MAX
+  std::vector<glm::mat4>              mLocalTransforms;
+  std::vector<glm::mat4>              mWorldTransforms;
+  std::vector<uint32_t>               mParents;
+  std::vector<const Model *>          mModels;
+  std::vector<const InstanceBuffer *> mInstances;
+  std::vector<NodeId>                 mIds;
+  std::vector<uint8_t>                mDirty;
+  std::vector<uint8_t>                mVisible;
+  // World bounding spheres, around every instance of the model if any, of negative infinite
+  // radius without a model so that they are never visible
+  std::vector<float> mBoundingSphereX;
+  std::vector<float> mBoundingSphereY;
+  std::vector<float> mBoundingSphereZ;
+  std::vector<float> mBoundingSphereRadii;
+  // Shared by every instance of the model, as the sphere is
+  std::vector<LodSelector::State> mLodStates;
+  // The children of the nodes [i, j) are the nodes [mChildBegins[i], mChildBegins[j])
+  std::vector<uint32_t> mChildBegins;
+  // The nodes of depth d are [mLevelBegins[d], mLevelBegins[d + 1])
+  std::vector<uint32_t> mLevelBegins;
+  // Indexed by node id
+  std::vector<uint32_t> mIndices;
+
+  std::vector<uint32_t> mDirtyIndices;
+  uint32_t              mModelCount = 0;
+  // Nodes were added since the last sort
+  bool mUnsorted = false;
+};
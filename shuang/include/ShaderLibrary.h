@@ -0,0 +1,61 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+class Device;
+
+// Loads SPIR-V shaders by memory mapping them, and shares a single VkShaderModule among every
+// pipeline using the same code. Modules stay alive until the library is destroyed, so that
+// pipeline variants created later don't load them again.
+class ShaderLibrary {
+public:
+  struct Statistics {
+    // Files actually read, i.e. not found by path
+    uint32_t fileCount   = 0;
+    uint32_t moduleCount = 0;
+    uint64_t bytesRead   = 0;
+    // Time spent reading files, hashing and creating modules
+    double milliseconds = 0.0;
+  };
+
+  explicit ShaderLibrary(const Device &device);
+  ~ShaderLibrary();
+
+  /**
+   * @brief Gets the shader module of a SPIR-V file, loading it on first use
+   * @param path The path to the SPIR-V file
+   * @returns The shader module, owned by the library
+   */
+  VkShaderModule load(const std::string &path);
+
+  /**
+   * @brief Gets the shader module of SPIR-V code, creating it unless the same code was loaded
+   * already
+   * @param code The SPIR-V code
+   * @param size The size of the code in bytes
+   * @returns The shader module, owned by the library
+   */
+  VkShaderModule load(const uint32_t *code, size_t size);
+
+  [[nodiscard]] Statistics getStatistics();
+
+private:
+  // A module along with a copy of its code, compared against on hash matches
+  struct Module {
+    std::vector<uint32_t> code;
+    VkShaderModule        handle;
+  };
+
+  VkShaderModule getModule(const uint32_t *code, size_t size);
+
+  const Device                                   &mDevice;
+  std::unordered_map<std::string, VkShaderModule> mModulesByPath;
+  std::unordered_multimap<uint64_t, Module>       mModulesByHash;
+  Statistics                                      mStatistics;
+  std::mutex                                      mMutex;
+};
@@ -3,20 +3,13 @@
 class Device;
 class Surface;
 class RenderPass;
+class Image;
+class ImageView;
 
 #include <vulkan/vulkan.hpp>
 
 class Swapchain {
 public:
-  struct Frame {
-    VkCommandPool   primaryCommandPool   = VK_NULL_HANDLE;
-    VkCommandBuffer primaryCommandBuffer = VK_NULL_HANDLE;
-    VkFence         queueSubmittedFence  = VK_NULL_HANDLE;
-    VkSemaphore     acquiredSemaphore    = VK_NULL_HANDLE;
-    // Signaled when the queue finished executing the commands in the buffer
-    VkSemaphore releasedSemaphore = VK_NULL_HANDLE;
-  };
-
   Swapchain(const std::shared_ptr<Device> &device, const std::shared_ptr<Surface> &surface);
   ~Swapchain();
 
@@ -27,15 +20,18 @@ public:
   const std::vector<VkImage>     &getImages() const { return mImages; }
   const std::vector<VkImageView> &getImageViews() const { return mImageViews; }
   const VkExtent2D               &getImageExtent() const { return mImageExtent; }
-  std::vector<Frame>             &getFrames() { return mFrames; }
   std::vector<VkFramebuffer>     &getFramebuffers() { return mFramebuffers; }
 
-  void     createFramebuffers(const std::shared_ptr<RenderPass> &renderPass);
-  void     createDepthStencil();
-  VkResult acquireNextImage(uint32_t &imageIndex);
+  void createFramebuffers(const std::shared_ptr<RenderPass> &renderPass);
+  void createDepthStencil();
+  /**
+   * @brief Acquires the next presentable image
+   * @param acquiredSemaphore The semaphore to signal once the image is ready to be rendered to
+   * @param imageIndex The index of the acquired image
+   */
+  VkResult acquireNextImage(VkSemaphore acquiredSemaphore, uint32_t &imageIndex);
 
 private:
-  void initFrame(Frame &frame);
   void cleanupFramebuffers();
 
   const std::shared_ptr<Device> &mDevice = nullptr;
@@ -46,14 +42,9 @@ private:
   uint32_t                       mImageCount;
   std::vector<VkImage>           mImages;
   std::vector<VkImageView>       mImageViews;
-  std::vector<Frame>             mFrames;
-  std::vector<VkSemaphore>       mSemaphorePool;
   // Framebuffers for each image view
   std::vector<VkFramebuffer> mFramebuffers;
 
-  struct {
-    VkImage        image;
-    VkDeviceMemory memory;
-    VkImageView    view;
-  } mDepthStencil;
+  std::unique_ptr<Image>     mDepthStencilImage;
+  std::unique_ptr<ImageView> mDepthStencilImageView;
 };
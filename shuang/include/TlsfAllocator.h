@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Two-Level Segregated Fit allocator over an abstract range of offsets, e.g. a VkDeviceMemory
+// block. Allocation and free are O(1): free ranges are binned by size class through two levels of
+// bitmaps, and physically adjacent free ranges are merged immediately.
+class TlsfAllocator {
+public:
+  using Handle = uint32_t;
+
+  static constexpr Handle INVALID_HANDLE = UINT32_MAX;
+
+  explicit TlsfAllocator(uint64_t size);
+
+  /**
+   * @brief Allocates a range of offsets
+   * @param size The size of the range
+   * @param alignment The alignment of the range start, must be a power of two
+   * @returns A handle to the range, INVALID_HANDLE if there is no room left
+   */
+  Handle allocate(uint64_t size, uint64_t alignment = 1);
+  void   free(Handle handle);
+
+  [[nodiscard]] uint64_t getOffset(Handle handle) const { return mBlocks[handle].offset; }
+  [[nodiscard]] uint64_t getSize() const { return mSize; }
+  [[nodiscard]] uint64_t getUsedSize() const { return mUsedSize; }
+  [[nodiscard]] uint32_t getAllocationCount() const { return mAllocationCount; }
+  [[nodiscard]] bool     isEmpty() const { return mAllocationCount == 0; }
+
+private:
+  // Second level subdivisions of each power of two, as log2
+  static constexpr uint32_t SL_INDEX_LOG2  = 5;
+  static constexpr uint32_t SL_INDEX_COUNT = 1u << SL_INDEX_LOG2;
+  static constexpr uint32_t FL_INDEX_COUNT = 64 - SL_INDEX_LOG2 + 1;
+
+  struct Block {
+    uint64_t offset   = 0;
+    uint64_t size     = 0;
+    Handle   prevPhys = INVALID_HANDLE;
+    Handle   nextPhys = INVALID_HANDLE;
+    Handle   prevFree = INVALID_HANDLE;
+    Handle   nextFree = INVALID_HANDLE;
+    bool     free     = false;
+  };
+
+  static void mapping(uint64_t size, uint32_t &fl, uint32_t &sl);
+  Handle      findFreeBlock(uint64_t size);
+  void        insertFreeBlock(Handle handle);
+  void        removeFreeBlock(Handle handle);
+  Handle      createBlock(uint64_t offset, uint64_t size);
+  void        destroyBlock(Handle handle);
+  // Splits the tail past size off the given block into a new free block
+  void split(Handle handle, uint64_t size);
+  // Merges the given block with its next physical neighbor, which must be free
+  void merge(Handle handle, Handle next);
+
+  uint64_t            mSize;
+  uint64_t            mUsedSize        = 0;
+  uint32_t            mAllocationCount = 0;
+  std::vector<Block>  mBlocks;
+  std::vector<Handle> mUnusedBlocks;
+  uint64_t            mFlBitmap = 0;
+  uint32_t            mSlBitmaps[FL_INDEX_COUNT]{};
+  Handle              mFreeLists[FL_INDEX_COUNT][SL_INDEX_COUNT];
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+
+#include "Buffer.h"
+
+// Persistently mapped ring of uniform and storage data, sliced per frame in flight. Per-draw data
+// is bump allocated into the slice of the current frame and bound with dynamic offsets, so that
+// the CPU never writes what the GPU may still be reading, nor maps memory on the hot path.
+class UniformRing : public Buffer {
+public:
+  UniformRing(const std::shared_ptr<Device> &device, VkDeviceSize frameSize,
+              uint32_t framesInFlight);
+
+  /**
+   * @brief Rewinds to the slice of a frame, to be called once the GPU is done with it
+   * @param frameIndex The index of the frame in flight
+   */
+  void beginFrame(uint32_t frameIndex);
+
+  /**
+   * @brief Bump allocates data in the slice of the current frame, from any thread
+   * @param size The size of the data
+   * @param offset The dynamic offset of the data within the ring
+   * @returns Where to write the data to, valid until the frame is retired
+   */
+  void *allocate(VkDeviceSize size, uint32_t &offset);
+
+  /**
+   * @brief Copies data into the slice of the current frame
+   * @param data The data to copy
+   * @returns The dynamic offset to bind the data with
+   */
+  template <typename T> uint32_t push(const T &data) {
+    uint32_t offset;
+    allocate(sizeof(T), offset);
+    copy(&data, sizeof(T), offset);
+    return offset;
+  }
+
+  // Both the uniform and the storage buffer offset alignment
+  [[nodiscard]] VkDeviceSize getAlignment() const { return mAlignment; }
+
+private:
+  VkDeviceSize mFrameSize;
+  VkDeviceSize mAlignment;
+  std::atomic<VkDeviceSize> mHead = 0;
+  VkDeviceSize              mEnd  = 0;
+};
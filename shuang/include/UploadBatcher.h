@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#include <vulkan/vulkan.hpp>
+
+#include "MemoryAllocator.h"
+
+class Buffer;
+class Device;
+class Image;
+class Queue;
+
+// Streams data to device local buffers and images through a persistently mapped staging ring.
+// Uploads are recorded into a single command buffer until flushed, so that many of them cost one
+// submission. Completion is tracked with tokens that can be polled instead of blocked on.
+//
+// When the queue belongs to another family than the graphics one, e.g. a dedicated transfer
+// queue, the ownership of the uploaded ranges is released by the copies and acquired by the
+// graphics queue, which waits for a semaphore signaled by them. The handover is only submitted
+// once the copies are done, by flush and wait, so that rendering never waits for the copies.
+class UploadBatcher {
+public:
+  // Identifies the batch an upload was recorded into, batches complete in submission order
+  using Token = uint64_t;
+
+  /**
+   * @brief Creates the staging ring and the command pools
+   * @param device The device
+   * @param ringSize The size of the staging ring
+   * @param queue The queue the copies are submitted to
+   */
+  UploadBatcher(const Device &device, VkDeviceSize ringSize, const Queue &queue);
+  ~UploadBatcher();
+
+  /**
+   * @brief Reserves staging memory to be copied into a buffer with the next flush
+   * @param dst The buffer to copy into
+   * @param size The size of the data, at most the size of the ring
+   * @param dstOffset The offset within the buffer to copy to
+   * @param token The token of the batch the copy is recorded into
+   * @returns Where to write the data to, before any other call to the batcher since it may
+   * submit the copy
+   */
+  void *stage(const Buffer &dst, VkDeviceSize size, VkDeviceSize dstOffset, Token &token);
+
+  /**
+   * @brief Uploads data into a buffer, split into several copies if larger than the ring
+   * @param dst The buffer to copy into
+   * @param data The data to upload
+   * @param size The size of the data
+   * @param dstOffset The offset within the buffer to copy to
+   * @returns The token of the batch the upload completes with
+   */
+  Token upload(const Buffer &dst, const void *data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+
+  /**
+   * @brief Uploads consecutive ranges of a buffer, generated in parallel straight into staging
+   * memory. Ranges are staged in groups of up to half the ring, each group being submitted before
+   * the next one is generated, so that the copy of a group overlaps with generating the next.
+   * @param dst The buffer to copy into
+   * @param offsets The offsets of the ranges within the buffer, followed by the end of the last
+   * one. A single range must fit in the ring.
+   * @param fill Writes the range of the given index to the given staging memory, called
+   * concurrently for different ranges
+   * @returns The token of the batch the last range completes with
+   */
+  Token upload(const Buffer &dst, const std::vector<VkDeviceSize> &offsets,
+               const std::function<void(size_t, void *)> &fill);
+
+  /**
+   * @brief Uploads the color texels of an image, which must fit in the ring as a whole
+   * @param dst The image to copy into, created with VK_IMAGE_USAGE_TRANSFER_DST_BIT
+   * @param data The tightly packed texels
+   * @param size The size of the texels
+   * @param layout The layout to leave the image in
+   * @returns The token of the batch the upload completes with
+   */
+  Token upload(const Image &dst, const void *data, VkDeviceSize size, VkImageLayout layout);
+
+  /**
+   * @brief Submits the uploads recorded so far, if any, and hands the batches whose copies are
+   * done over to the graphics queue. Must be synchronized with the other submissions to the
+   * graphics queue, e.g. called by the thread rendering the frames.
+   * @returns The token of the last submitted batch
+   */
+  Token flush();
+
+  // Whether the copies of the batch of the given token have been executed by the GPU, never blocks
+  [[nodiscard]] bool isComplete(Token token);
+
+  // Whether the submissions to the graphics queue made from now on observe the data of the batch
+  // of the given token, never blocks
+  [[nodiscard]] bool isAvailable(Token token) const {
+    return token <= mAvailableToken.load(std::memory_order_acquire);
+  }
+
+  // Blocks until the batch of the given token has been executed by the GPU, flushing it if
+  // needed, then hands it over to the graphics queue as flush does
+  void wait(Token token);
+
+private:
+  struct Batch {
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VkFence         fence         = VK_NULL_HANDLE;
+    Token           token         = 0;
+    // Bytes of the ring consumed by the batch, including alignment and wrap around padding
+    VkDeviceSize ringBytes = 0;
+    // Queue family ownership transfers of the uploaded ranges, when releasing them
+    VkCommandBuffer                    acquireCommandBuffer = VK_NULL_HANDLE;
+    VkSemaphore                        semaphore            = VK_NULL_HANDLE;
+    std::vector<VkBufferMemoryBarrier> bufferBarriers;
+    std::vector<VkImageMemoryBarrier>  imageBarriers;
+  };
+
+  // Reserves size bytes of the ring, submitting and waiting for older batches while it is full
+  VkDeviceSize allocate(VkDeviceSize size);
+  // The batch being recorded, begun on the first upload after a flush
+  Batch &getRecordingBatch();
+  // Releases a range of a buffer copied by the batch to the graphics queue, if needed
+  void release(Batch &batch, const Buffer &dst, VkDeviceSize offset, VkDeviceSize size);
+  void submit();
+  // Recycles the batches the GPU is done copying, and their part of the ring
+  void retire(bool wait);
+  // Submits the acquisitions of the copied batches to the graphics queue, and recycles the
+  // batches whose acquisition has been executed
+  void handOver();
+  // Puts a batch the GPU is done with back into the free ones
+  void recycle(Batch &batch);
+
+  const Device &mDevice;
+  const Queue  &mQueue;
+  // Whether the queue belongs to another family than the graphics one
+  bool              mReleasing;
+  VkBuffer          mRing = VK_NULL_HANDLE;
+  MemoryAllocation  mRingAllocation;
+  VkDeviceSize      mRingSize;
+  VkDeviceSize      mRingHead           = 0;
+  VkDeviceSize      mRingUsed           = 0;
+  VkCommandPool     mCommandPool        = VK_NULL_HANDLE;
+  VkCommandPool     mAcquireCommandPool = VK_NULL_HANDLE;
+  Batch             mRecording;
+  std::deque<Batch> mInFlight;
+  // Batches copied but not handed over yet, then being acquired by the graphics queue
+  std::deque<Batch>  mCopied;
+  std::deque<Batch>  mAcquiring;
+  std::vector<Batch> mFreeBatches;
+  Token              mNextToken      = 1;
+  Token              mCompletedToken = 0;
+  std::atomic<Token> mAvailableToken{0};
+  std::mutex         mMutex;
+};
@@ -1,8 +1,41 @@
 #pragma once
 
+#include <cstdint>
+
 #include <glm/glm.hpp>
 
 struct Vertex {
   glm::vec3 position;
   glm::vec3 color;
 };
+
+// Layouts of the vertex buffers. Models are built from Vertex, and encoded into their layout when
+// uploaded.
+enum class VertexFormat : uint32_t {
+  // Vertex as it is, 24 bytes
+  FLOAT,
+  // PackedVertex, 12 bytes
+  PACKED,
+};
+
+// Positions quantized to 16 bit snorm relative to the bounds of the model, and 8 bit unorm colors.
+// The fourth position component only pads the format, 3 component 16 bit formats being optional
+// for vertex buffers.
+struct PackedVertex {
+  int16_t position[4];
+  uint8_t color[4];
+};
+
+// Transforms the positions read from a vertex buffer back to model space, as position * scale +
+// offset. Pushed to the vertex shaders, laid out as their push constants.
+struct PositionDequantization {
+  glm::vec4 offset{0.0f};
+  glm::vec4 scale{1.0f};
+};
+
+// Pushed to the vertex shaders along with every draw of a model, laid out as their push constants.
+// The push constants of the fragment shaders follow.
+struct DrawPushConstants {
+  PositionDequantization dequantization;
+  glm::mat4              model{1.0f};
+};
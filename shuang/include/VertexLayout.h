@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "Vertex.h"
+
+// Describes where the attributes of a vertex format lie in a vertex buffer, to generate the vertex
+// input state of the pipelines drawing it, and encodes vertices into the format
+class VertexLayout {
+public:
+  struct Attribute {
+    uint32_t location;
+    VkFormat format;
+    uint32_t offset;
+  };
+
+  // The layout of a format
+  static const VertexLayout &get(VertexFormat format);
+
+  [[nodiscard]] VertexFormat                  getFormat() const { return mFormat; }
+  [[nodiscard]] uint32_t                      getStride() const { return mStride; }
+  [[nodiscard]] const std::vector<Attribute> &getAttributes() const { return mAttributes; }
+
+  // The vertex rate binding of the layout at the given binding index
+  [[nodiscard]] VkVertexInputBindingDescription getBindingDescription(uint32_t binding) const;
+  // Appends the attributes of the layout read from the given binding index
+  void appendAttributeDescriptions(
+      uint32_t binding, std::vector<VkVertexInputAttributeDescription> &attributes) const;
+
+  /**
+   * @brief Computes the dequantization of the positions of vertices encoded into the layout
+   * @param vertices The vertices
+   * @param count The number of vertices
+   * @returns The transform mapping [-1, 1] to the bounds of the vertices on each axis, or the
+   * identity for layouts storing floats
+   */
+  [[nodiscard]] PositionDequantization computeDequantization(const Vertex *vertices,
+                                                             size_t        count) const;
+
+  /**
+   * @brief Encodes vertices into the layout, e.g. straight into staging memory
+   * @param vertices The vertices
+   * @param count The number of vertices
+   * @param dequantization The dequantization of the positions, from computeDequantization
+   * @param dst Where to write count * stride bytes to
+   */
+  void encode(const Vertex *vertices, size_t count, const PositionDequantization &dequantization,
+              void *dst) const;
+
+private:
+  VertexLayout(VertexFormat format, uint32_t stride, std::vector<Attribute> attributes);
+
+  VertexFormat           mFormat;
+  uint32_t               mStride;
+  std::vector<Attribute> mAttributes;
+};
@@ -4,21 +4,27 @@
 
 struct GLFWwindow;
 class Application;
+enum class KeyCode;
 
 class Window {
 public:
   Window(const Application *exampleBase, int width, int height, const char *title);
   ~Window();
 
+  // Maps a GLFW key to its code, UNKNOWN if the key isn't handled
+  static KeyCode mapKeyCode(int key);
+
   bool shouldClose();
   void close();
   void pollEvents();
 
-  VkSurfaceKHR                    createSurface(VkInstance instance) const;
-  [[nodiscard]] const VkExtent2D &getExtent() const { return mExtent; }
-  [[nodiscard]] double            getTime() const;
-  void                            setFocused(bool focused) { mFocused = focused; }
-  [[nodiscard]] bool              getFocused() const { return mFocused; }
+  // Instance extensions needed to create a surface for this window on the current platform
+  [[nodiscard]] std::vector<const char *> getRequiredInstanceExtensions() const;
+  VkSurfaceKHR                            createSurface(VkInstance instance) const;
+  [[nodiscard]] const VkExtent2D         &getExtent() const { return mExtent; }
+  [[nodiscard]] double                    getTime() const;
+  void                                    setFocused(bool focused) { mFocused = focused; }
+  [[nodiscard]] bool                      getFocused() const { return mFocused; }
 
 private:
   VkExtent2D  mExtent{};
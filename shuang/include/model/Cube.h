@@ -4,6 +4,9 @@
 
 class Cube : public Model {
 public:
-  explicit Cube(const std::shared_ptr<Device> &device);
-  ~Cube();
+  explicit Cube(const std::shared_ptr<Device> &device, VertexFormat format = VertexFormat::FLOAT);
+  ~Cube() override;
+
+  // Generates a cube of side 2 centered on the origin, with a color per vertex of each triangle
+  static void generate(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
 };
@@ -5,5 +5,9 @@
 class Grid : public Model {
 public:
   explicit Grid(const std::shared_ptr<Device> &device, int halfSize = 1);
-  ~Grid();
+  ~Grid() override;
+
+  // Generates the lines of a grid spanning [-halfSize, halfSize] on x and z, as line list indices
+  static void generate(int halfSize, std::vector<Vertex> &vertices,
+                       std::vector<uint32_t> &indices);
 };
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Model.h"
+
+// A range of the index buffer, e.g. a glTF primitive, along with the bounds of its vertices. The
+// index ranges of the full level of detail lie within it.
+struct Submesh {
+  uint32_t  firstIndex;
+  uint32_t  indexCount;
+  glm::vec3 boundsMin;
+  glm::vec3 boundsMax;
+};
+
+// Geometry loaded from a file, the buffers are created empty to be uploaded to by the loader. The
+// index buffer is a single range of a triangle list, at a single level of detail, until set
+// otherwise.
+class Mesh : public Model {
+public:
+  Mesh(const std::shared_ptr<Device> &device, uint32_t vertexCount, uint32_t indexCount,
+       VertexFormat vertexFormat = VertexFormat::FLOAT,
+       VkIndexType indexType = VK_INDEX_TYPE_UINT32);
+  ~Mesh() override;
+
+  void setUploadToken(UploadBatcher::Token token) { mUploadToken = token; }
+  // Sets how the positions uploaded to the vertex buffer were quantized, if packed
+  void setDequantization(const PositionDequantization &dequantization) {
+    mDequantization = dequantization;
+  }
+  // Sets the ranges the index buffer is drawn with, e.g. after a split for 16 bit indices, which
+  // make a single level of detail until set otherwise
+  void setIndexRanges(std::vector<IndexRange> ranges);
+  // Sets the levels of detail, whose ranges must be set already
+  void setLods(std::vector<Lod> lods) { mLods = std::move(lods); }
+  void setTopology(VkPrimitiveTopology topology) { mTopology = topology; }
+  // Sets the submeshes, the bounds of the mesh being their union
+  void setSubmeshes(std::vector<Submesh> submeshes);
+
+  [[nodiscard]] const std::vector<Submesh> &getSubmeshes() const { return mSubmeshes; }
+
+private:
+  std::vector<Submesh> mSubmeshes;
+};
@@ -1,24 +1,80 @@
 #pragma once
 
 #include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
 
 #include "IndexBuffer.h"
+#include "UploadBatcher.h"
+#include "Vertex.h"
 #include "VertexBuffer.h"
 
 class Device;
 
+// A level of detail of a model, drawn with consecutive index ranges of its index buffer. Levels
+// share the vertex buffer and are ordered from the full detail, level 0 being the whole model, the
+// ranges of each level following the ones of the previous level.
+struct Lod {
+  uint32_t firstRange;
+  uint32_t rangeCount;
+  // Estimated distance from the surface of the level to the one of the full detail, in model space
+  float error;
+};
+
 class Model {
 public:
   explicit Model(const std::shared_ptr<Device> &device);
-  ~Model();
+  virtual ~Model();
 
   [[nodiscard]] const std::unique_ptr<VertexBuffer> &getVertexBuffer() const {
     return mVertexBuffer;
   }
   [[nodiscard]] const std::unique_ptr<IndexBuffer> &getIndexBuffer() const { return mIndexBuffer; }
+  // The ranges of the index buffer, each drawn with a call of its own
+  [[nodiscard]] const std::vector<IndexRange> &getIndexRanges() const { return mIndexRanges; }
+  // Levels of detail, each drawn with its own ranges of the index buffer, at least the full one
+  [[nodiscard]] const std::vector<Lod> &getLods() const { return mLods; }
+  // Topology of the index buffer, strips being separated by PRIMITIVE_RESTART_INDEX
+  [[nodiscard]] VkPrimitiveTopology getTopology() const { return mTopology; }
+  // The token of the streaming batch uploading the geometry, which can be drawn once available
+  [[nodiscard]] UploadBatcher::Token getUploadToken() const { return mUploadToken; }
+  // Layout of the vertex buffer, which the pipelines drawing the model must be created with
+  [[nodiscard]] VertexFormat getVertexFormat() const { return mVertexFormat; }
+  // Pushed to the vertex shaders along with every draw of the model
+  [[nodiscard]] const PositionDequantization &getDequantization() const { return mDequantization; }
+
+  // Bounding box and sphere in model space
+  [[nodiscard]] const glm::vec3 &getBoundsMin() const { return mBoundsMin; }
+  [[nodiscard]] const glm::vec3 &getBoundsMax() const { return mBoundsMax; }
+  [[nodiscard]] const glm::vec3 &getBoundingSphereCenter() const { return mBoundingSphereCenter; }
+  [[nodiscard]] float            getBoundingSphereRadius() const { return mBoundingSphereRadius; }
 
 protected:
+  // Computes the bounds from the vertices, the sphere being centered on the box
+  void setBounds(const std::vector<Vertex> &vertices);
+  // Sets the bounding box, the sphere being the one around the box
+  void setBounds(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax);
+  // Sets the bounds from the vertices, and creates the vertex buffer, encoding the vertices into
+  // the given layout straight into staging memory, which they must fit in at once
+  void createVertexBuffer(const std::vector<Vertex> &vertices, VertexFormat format);
+  // Creates the index buffer as a single range, of 16 bit indices if the vertices allow, encoding
+  // the indices straight into staging memory. The upload token is the one of the index buffer.
+  void createIndexBuffer(const std::vector<uint32_t> &indices, uint32_t vertexCount);
+
   const std::shared_ptr<Device> mDevice       = nullptr;
   std::unique_ptr<VertexBuffer> mVertexBuffer = nullptr;
   std::unique_ptr<IndexBuffer>  mIndexBuffer  = nullptr;
+  UploadBatcher::Token          mUploadToken  = 0;
+  VertexFormat                  mVertexFormat = VertexFormat::FLOAT;
+  PositionDequantization        mDequantization;
+  std::vector<IndexRange>       mIndexRanges;
+  std::vector<Lod>              mLods;
+  VkPrimitiveTopology           mTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+private:
+  glm::vec3 mBoundsMin{0.0f};
+  glm::vec3 mBoundsMax{0.0f};
+  glm::vec3 mBoundingSphereCenter{0.0f};
+  float     mBoundingSphereRadius = 0.0f;
 };
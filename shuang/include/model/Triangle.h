@@ -5,5 +5,5 @@
 class Triangle : public Model {
 public:
   explicit Triangle(const std::shared_ptr<Device> &device);
-  ~Triangle();
+  ~Triangle() override;
 };
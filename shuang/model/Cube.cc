@@ -1,11 +1,26 @@
 #include "model/Cube.h"
 #include "Device.h"
 #include "Log.h"
+#include "MeshOptimizer.h"
 #include "Vertex.h"
 
-Cube::Cube(const std::shared_ptr<Device> &device) : Model(device) {
+Cube::Cube(const std::shared_ptr<Device> &device, VertexFormat format) : Model(device) {
+  std::vector<Vertex>   vertices;
+  std::vector<uint32_t> indices;
+  generate(vertices, indices);
+  MeshOptimizer::optimize(vertices, indices);
+
   // Vertex buffer
-  const std::vector<Vertex> vertices = {
+  createVertexBuffer(vertices, format);
+
+  // Index buffer
+  createIndexBuffer(indices, static_cast<uint32_t>(vertices.size()));
+}
+
+Cube::~Cube() { log_func; }
+
+void Cube::generate(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+  vertices = {
       {{-1.0f, -1.0f, -1.0f}, {0.583f, 0.771f, 0.014f}},
       {{-1.0f, -1.0f, 1.0f}, {0.609f, 0.115f, 0.436f}},
       {{-1.0f, 1.0f, 1.0f}, {0.327f, 0.483f, 0.844f}},
@@ -43,33 +58,10 @@ Cube::Cube(const std::shared_ptr<Device> &device) : Model(device) {
       {{-1.0f, 1.0f, 1.0f}, {0.820f, 0.883f, 0.371f}},
       {{1.0f, -1.0f, 1.0f}, {0.982f, 0.099f, 0.879f}},
   };
-  auto size = vertices.size() * sizeof(Vertex);
 
-  auto buf      = std::make_shared<Buffer>(device, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                      size, (void *)vertices.data());
-  mVertexBuffer = std::make_unique<VertexBuffer>(device, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                                                 vertices.size(), sizeof(Vertex));
-  mVertexBuffer->copy(buf, device->getGraphicsQueue());
-
-  // Index buffer
-  const std::vector<uint32_t> indices = {0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11,
-                                         12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23,
-                                         24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35};
-  size                                = indices.size() * sizeof(uint32_t);
-
-  buf.reset();
-  buf = std::make_shared<Buffer>(mDevice, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                 size, (void *)indices.data());
-
-  mIndexBuffer =
-      std::make_unique<IndexBuffer>(mDevice, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indices.size(), size);
-  mIndexBuffer->copy(buf, mDevice->getGraphicsQueue());
+  // Every triangle has vertices of its own
+  indices.resize(vertices.size());
+  for (uint32_t i = 0; i < indices.size(); ++i) {
+    indices[i] = i;
+  }
 }
-
-Cube::~Cube() { log_func; }
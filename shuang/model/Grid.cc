@@ -4,8 +4,23 @@
 #include "Vertex.h"
 
 Grid::Grid(const std::shared_ptr<Device> &device, int halfSize) : Model(device) {
+  std::vector<Vertex>   vertices;
+  std::vector<uint32_t> indices;
+  generate(halfSize, vertices, indices);
+
   // Vertex buffer
-  std::vector<Vertex> vertices{};
+  createVertexBuffer(vertices, VertexFormat::FLOAT);
+
+  // Index buffer
+  createIndexBuffer(indices, static_cast<uint32_t>(vertices.size()));
+  mTopology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+}
+
+Grid::~Grid() { log_func; }
+
+void Grid::generate(int halfSize, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+  vertices.clear();
+  vertices.reserve(4 * (2 * halfSize + 1));
   for (int i = -halfSize; i <= halfSize; ++i) {
     // column
     vertices.push_back({.position = glm::vec3(i, 0, -halfSize), .color = glm::vec3(0, 0, 0)});
@@ -14,37 +29,13 @@ Grid::Grid(const std::shared_ptr<Device> &device, int halfSize) : Model(device)
     vertices.push_back({.position = glm::vec3(-halfSize, 0, i), .color = glm::vec3(0, 0, 0)});
     vertices.push_back({.position = glm::vec3(halfSize, 0, i), .color = glm::vec3(0, 0, 0)});
   }
-  auto size = vertices.size() * sizeof(Vertex);
 
-  auto buf      = std::make_shared<Buffer>(device, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                      size, (void *)vertices.data());
-  mVertexBuffer = std::make_unique<VertexBuffer>(device, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                                                 vertices.size(), sizeof(Vertex));
-  mVertexBuffer->copy(buf, device->getGraphicsQueue());
-
-  // Index buffer
-  std::vector<uint32_t> indices{};
+  indices.clear();
+  indices.reserve(4 * (2 * halfSize + 1));
   for (int i = 0; i < 2 * halfSize + 1; ++i) {
     indices.push_back(i * 4);
     indices.push_back(i * 4 + 1);
     indices.push_back(i * 4 + 2);
     indices.push_back(i * 4 + 3);
   }
-  size = indices.size() * sizeof(uint32_t);
-
-  buf.reset();
-  buf = std::make_shared<Buffer>(mDevice, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                 size, (void *)indices.data());
-
-  mIndexBuffer =
-      std::make_unique<IndexBuffer>(mDevice, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indices.size(), size);
-  mIndexBuffer->copy(buf, mDevice->getGraphicsQueue());
 }
-
-Grid::~Grid() { log_func; }
@@ -0,0 +1,40 @@
+#include "model/Mesh.h"
+#include "Device.h"
+#include "Log.h"
+#include "VertexLayout.h"
+
+Mesh::Mesh(const std::shared_ptr<Device> &device, uint32_t vertexCount, uint32_t indexCount,
+           VertexFormat vertexFormat, VkIndexType indexType)
+    : Model(device) {
+  mVertexFormat = vertexFormat;
+  mIndexRanges  = {{0, indexCount, 0, vertexCount}};
+  mLods         = {{0, 1, 0.0f}};
+  mVertexBuffer = std::make_unique<VertexBuffer>(device, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexCount,
+                                                 VertexLayout::get(vertexFormat).getStride());
+  mIndexBuffer  = std::make_unique<IndexBuffer>(device, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexCount,
+                                                indexType);
+}
+
+Mesh::~Mesh() { log_func; }
+
+void Mesh::setIndexRanges(std::vector<IndexRange> ranges) {
+  mIndexRanges = std::move(ranges);
+  mLods        = {{0, static_cast<uint32_t>(mIndexRanges.size()), 0.0f}};
+}
+
+void Mesh::setSubmeshes(std::vector<Submesh> submeshes) {
+  mSubmeshes = std::move(submeshes);
+  if (mSubmeshes.empty()) {
+    return;
+  }
+
+  auto boundsMin = mSubmeshes[0].boundsMin;
+  auto boundsMax = mSubmeshes[0].boundsMax;
+  for (const auto &submesh : mSubmeshes) {
+    boundsMin = glm::min(boundsMin, submesh.boundsMin);
+    boundsMax = glm::max(boundsMax, submesh.boundsMax);
+  }
+  setBounds(boundsMin, boundsMax);
+}
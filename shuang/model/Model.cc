@@ -1,7 +1,64 @@
 #include "model/Model.h"
 #include "Device.h"
 #include "Log.h"
+#include "VertexLayout.h"
+
+#include <cfloat>
 
 Model::Model(const std::shared_ptr<Device> &device) : mDevice{device} {}
 
 Model::~Model() { log_func; }
+
+void Model::setBounds(const std::vector<Vertex> &vertices) {
+  glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+  for (const auto &vertex : vertices) {
+    boundsMin = glm::min(boundsMin, vertex.position);
+    boundsMax = glm::max(boundsMax, vertex.position);
+  }
+  setBounds(boundsMin, boundsMax);
+
+  // The vertices give a tighter radius than the corners of the box
+  float radius = 0.0f;
+  for (const auto &vertex : vertices) {
+    radius = std::max(radius, glm::distance(mBoundingSphereCenter, vertex.position));
+  }
+  mBoundingSphereRadius = radius;
+}
+
+void Model::setBounds(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax) {
+  mBoundsMin            = boundsMin;
+  mBoundsMax            = boundsMax;
+  mBoundingSphereCenter = (boundsMin + boundsMax) * 0.5f;
+  mBoundingSphereRadius = glm::distance(boundsMin, boundsMax) * 0.5f;
+}
+
+void Model::createVertexBuffer(const std::vector<Vertex> &vertices, VertexFormat format) {
+  setBounds(vertices);
+
+  const auto &layout = VertexLayout::get(format);
+  mVertexFormat      = format;
+  mDequantization    = layout.computeDequantization(vertices.data(), vertices.size());
+  mVertexBuffer      = std::make_unique<VertexBuffer>(mDevice, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                      vertices.size(), layout.getStride());
+  std::vector<VkDeviceSize> offsets{0, VkDeviceSize{vertices.size()} * layout.getStride()};
+  mDevice->getStreamingBatcher().upload(*mVertexBuffer, offsets, [&](size_t, void *data) {
+    layout.encode(vertices.data(), vertices.size(), mDequantization, data);
+  });
+}
+
+void Model::createIndexBuffer(const std::vector<uint32_t> &indices, uint32_t vertexCount) {
+  auto indexCount = static_cast<uint32_t>(indices.size());
+  auto indexType  = IndexBuffer::selectIndexType(vertexCount);
+  mIndexRanges    = {{0, indexCount, 0, vertexCount}};
+  mLods           = {{0, 1, 0.0f}};
+  mIndexBuffer    = std::make_unique<IndexBuffer>(mDevice, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexCount,
+                                                  indexType);
+  std::vector<VkDeviceSize> offsets{
+      0, VkDeviceSize{indexCount} * IndexBuffer::getIndexSize(indexType)};
+  mUploadToken =
+      mDevice->getStreamingBatcher().upload(*mIndexBuffer, offsets, [&](size_t, void *data) {
+        IndexBuffer::encode(indices.data(), indices.size(), indexType, data);
+      });
+}